@@ -0,0 +1,543 @@
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#include "harness.hpp"
+#include "solver.hpp"
+#include "format.hpp"
+#include "multigrid.hpp"
+#include "distributed.hpp"
+#include "ensemble.hpp"
+#include "render.hpp"
+#include "probe.hpp"
+
+// benchmark suite:
+//   tdma  - TDMA::solve and BatchedTDMA::solve across line lengths, then a single
+//           prefactorized system with TDMA (into a contiguous and a strided
+//           line) and PartitionedTDMA (one thread)
+//   step  - Problem::step() across mesh sizes and execution modes
+//   dump  - a frame of the field: text formatting (Model79::dump and FieldFormatter)
+//           and the native rendering into a GIF frame and a PNG written to /dev/null
+//   e2e   - headless run: a step followed by a formatted frame written to /dev/null,
+//           or by a binary sample of a few probes (a point, a line profile, a rectangle)
+//   multigrid - solve of the stationary problem from the initial field, the number
+//               of cycles (shown with each case) should not grow with the mesh
+//   precision - Problem::step() with the double, mixed (float field, double
+//               elimination) and float modes, prefactorized; each case also shows
+//               the largest deviation (K) from the double field after a full run
+//   scaling - DistributedProblem::step() on 1, 2, 4, ... processes up to
+//             --max-ranks (the strips of the plate, see include/distributed.hpp)
+//   order - full runs over CONVERGENCE_TIME on the 100x50 mesh with the LOD and
+//           the ADI splitting and 20 to 320 steps; each case shows the rms
+//           deviation (K) from an ADI run of CONVERGENCE_REFERENCE steps and the
+//           order p it falls with the step (1 for LOD, 2 for ADI); the bench exits
+//           with a failure if the ADI p drops below MIN_ADI_ORDER from n=80 on
+//   ensemble - a step of ENSEMBLE_SIZE models of the same plate (two distinct
+//              diffusivities): a prefactorized Problem per member stepped one
+//              after another against Ensemble::step()
+//   wavefront - Problem::step() with the two sweeps one after another (prefactorized)
+//               against the sweeps pipelined over the tiles of the field, on one
+//               thread and on all the cores. Its GB/s is modeled from the field size
+//               like the one of step, not measured: the DRAM traffic the tiles save
+//               needs the hardware cache-miss counters, which the harness does not read
+// ns/node is the time per equation (tdma), per mesh node and step (step, dump, e2e,
+// precision, scaling, wavefront; of every member for ensemble), per mesh node and solve (multigrid)
+// or per mesh node and step of the run (order).
+// GB/s is the effective bandwidth: the bytes of the diagonals (tdma),
+// of the field read and written by both sweeps (step, e2e, precision, scaling,
+// order, ensemble, wavefront) or of the text and the images (dump), it is not estimated for multigrid
+constexpr std::string_view usage =
+    "Usage: bench [options]\n"
+    "  --suite=<name>[,<name>...]  tdma, step, dump, e2e, multigrid, precision,\n"
+    "                              scaling, order, ensemble, wavefront (all by default)\n"
+    "  --max-x=<uint>              largest mesh to run, in x nodes (default 2000)\n"
+    "  --max-ranks=<uint>          most processes of the scaling suite (default: the cores)\n"
+    "  --json=<path>               also write the results as JSON\n"
+    "  --quick                     fewer repetitions, for smoke testing\n";
+
+constexpr size_t ENSEMBLE_SIZE = 16;
+constexpr double CONVERGENCE_TIME = 1.0;
+constexpr size_t CONVERGENCE_REFERENCE = 10240;
+// the first halvings of the step are not in the asymptotic range yet
+constexpr size_t CONVERGENCE_REFINED = 80;
+constexpr double MIN_ADI_ORDER = 1.8;
+constexpr size_t LENGTHS[] = {16, 64, 256, 1024, 4096, 16384, 65536};
+// doubles between the equations of the strided TDMA case
+constexpr size_t STRIDED_WIDTH = 8;
+// Model79 geometry is defined for meshes with twice as many x nodes as y nodes
+constexpr size_t MESHES[][2] = {{100, 50}, {200, 100}, {500, 250}, {1000, 500}, {2000, 1000}, {4000, 2000}};
+
+static std::string mesh_name(const size_t x_nodes, const size_t y_nodes) {
+    return std::to_string(x_nodes) + 'x' + std::to_string(y_nodes);
+}
+
+static model::Model79 make_model(const size_t x_nodes, const size_t y_nodes) {
+    return model::Model79(15e-3, 10.0 / x_nodes, 5.0 / y_nodes, 1.0, x_nodes, y_nodes);
+}
+
+// diagonally dominant system of the kind the sweeps produce
+static solver::tridiagonal_mx_extended make_system(const size_t n) {
+    solver::tridiagonal_mx_extended mx;
+    mx[0].assign(n, -1.0);
+    mx[1].assign(n, 4.0);
+    mx[2].assign(n, -1.0);
+    mx[3].assign(n, 1.0);
+    mx[0][0] = 0.0;
+    mx[2][n - 1] = 0.0;
+    return mx;
+}
+
+static void bench_tdma(const bench::Settings & s, std::vector<bench::Result> & results) {
+    for (const size_t n: LENGTHS) {
+        // a, b, c, d are read, c* and d* written and read back, x written
+        const double bytes_per_eq = 9 * sizeof(double);
+        {
+            const auto mx = make_system(n);
+            solver::TDMA tdma(n);
+            solver::diagonal x(n);
+            results.push_back(bench::measure("tdma", "scalar n=" + std::to_string(n), n, n * bytes_per_eq, s,
+                [&] { tdma.solve(mx, x); }));
+            bench::print_row(std::cout, results.back());
+        }
+        {
+            const size_t width = solver::BatchedTDMA::native_width();
+            const auto mx = make_system(n * width);
+            solver::BatchedTDMA tdma(n, width);
+            solver::diagonal x(n * width);
+            results.push_back(bench::measure(
+                "tdma", "batched x" + std::to_string(width) + " n=" + std::to_string(n),
+                n * width, n * width * bytes_per_eq, s,
+                [&] { tdma.solve(mx, x); }));
+            bench::print_row(std::cout, results.back());
+        }
+        // the same single system prefactorized: Thomas, and split over the
+        // lanes of one thread (gather, interleaved solve, substitution)
+        {
+            const auto mx = make_system(n);
+            solver::diagonal c_star(n), inv_pivot(n), x(n);
+            solver::TDMA::factorize(mx, c_star.data(), inv_pivot.data());
+            results.push_back(bench::measure("tdma", "factorized n=" + std::to_string(n), n, n * 6 * sizeof(double), s,
+                [&] { solver::TDMA::solve_factorized(n, mx[0].data(), c_star.data(), inv_pivot.data(), mx[3].data(), x.data()); }));
+            bench::print_row(std::cout, results.back());
+
+            // the solution written down a column of a field a cache line
+            // wide, as the y-sweep of the Problem does in place
+            solver::diagonal field(n * STRIDED_WIDTH);
+            const util::strided_span<double> column(field.data(), n, STRIDED_WIDTH);
+            results.push_back(bench::measure(
+                "tdma", "factorized stride=" + std::to_string(STRIDED_WIDTH) + " n=" + std::to_string(n),
+                n, n * 6 * sizeof(double), s,
+                [&] { solver::TDMA::solve_factorized(mx[0].data(), c_star.data(), inv_pivot.data(), {mx[3].data(), n}, column); }));
+            bench::print_row(std::cout, results.back());
+
+            const size_t width = solver::BatchedTDMA::native_width();
+            solver::PartitionedTDMA partitioned(n, mx[0].data(), mx[1].data(), mx[2].data(), 1, width);
+            results.push_back(bench::measure(
+                "tdma", "partitioned x" + std::to_string(width) + " n=" + std::to_string(n),
+                n, n * 11 * sizeof(double), s,
+                [&] {
+                    partitioned.eliminate(0, mx[3].data());
+                    partitioned.reduce(mx[3].data());
+                    partitioned.substitute(0, x.data());
+                }));
+            bench::print_row(std::cout, results.back());
+        }
+    }
+}
+
+static void bench_step(const bench::Settings & s, const size_t max_x, std::vector<bench::Result> & results) {
+    struct Variant {
+        const char * name;
+        solver::ProblemOptions opts;
+    };
+    const Variant variants[] = {
+        {"lines", {solver::LINE_BY_LINE, 1, false, false}},
+        {"lines+prefactorize", {solver::LINE_BY_LINE, 1, true, false}},
+        {"lines+transpose-y", {solver::LINE_BY_LINE, 1, true, true}},
+        {"batched", {solver::BATCHED, 1, false, false}},
+        {"batched+prefactorize", {solver::BATCHED, 1, true, false}},
+    };
+    for (const auto & mesh: MESHES) {
+        const size_t x_nodes = mesh[0], y_nodes = mesh[1];
+        if (x_nodes > max_x) break;
+        const double nodes = static_cast<double>(x_nodes * y_nodes);
+        for (const auto & v: variants) {
+            auto m = make_model(x_nodes, y_nodes);
+            solver::BasicProblem<model::Model79> problem(m, std::numeric_limits<size_t>::max(), v.opts);
+            results.push_back(bench::measure(
+                "step", mesh_name(x_nodes, y_nodes) + ' ' + v.name,
+                nodes, 4 * nodes * sizeof(double), s,
+                [&] { problem.step(); }));
+            bench::print_row(std::cout, results.back());
+        }
+    }
+}
+
+static void bench_dump(const bench::Settings & s, const size_t max_x, std::vector<bench::Result> & results) {
+    for (const auto & mesh: MESHES) {
+        const size_t x_nodes = mesh[0], y_nodes = mesh[1];
+        if (x_nodes > max_x) break;
+        const double nodes = static_cast<double>(x_nodes * y_nodes);
+
+        // a developed field rather than the initial zeros
+        auto m = make_model(x_nodes, y_nodes);
+        solver::BasicProblem<model::Model79> problem(m, std::numeric_limits<size_t>::max());
+        for (size_t i = 0; i < 10; ++i) problem.step();
+
+        std::ostringstream os;
+        os << m;
+        const double text_bytes = static_cast<double>(os.str().size());
+        results.push_back(bench::measure(
+            "dump", mesh_name(x_nodes, y_nodes) + " ostream", nodes, text_bytes, s,
+            [&] { os.str(std::string()); os << m; }));
+        bench::print_row(std::cout, results.back());
+
+        plt::FieldFormatter text;
+        results.push_back(bench::measure(
+            "dump", mesh_name(x_nodes, y_nodes) + " to_chars", nodes, text_bytes, s,
+            [&] { text.clear(); text.append(m.field(), m.x_dim()); }));
+        bench::print_row(std::cout, results.back());
+
+        // scaled as main renders it, GB/s is of the encoded images
+        const plt::Palette palette = plt::default_palette();
+        const plt::ColorRange range = plt::value_range(m.field());
+        const size_t scale = std::max<size_t>(1, 800 / x_nodes);
+        plt::Framebuffer frame;
+        plt::rasterize(m.field(), m.x_dim(), range, scale, frame);
+        plt::GifEncoder gif("/dev/null", palette, 2);
+        const double gif_bytes = static_cast<double>(gif.append(frame));
+        results.push_back(bench::measure(
+            "dump", mesh_name(x_nodes, y_nodes) + " gif", nodes, gif_bytes, s,
+            [&] { plt::rasterize(m.field(), m.x_dim(), range, scale, frame); gif.append(frame); }));
+        bench::print_row(std::cout, results.back());
+
+        const double png_bytes = static_cast<double>(plt::write_png("/dev/null", frame, palette));
+        results.push_back(bench::measure(
+            "dump", mesh_name(x_nodes, y_nodes) + " png", nodes, png_bytes, s,
+            [&] { plt::rasterize(m.field(), m.x_dim(), range, scale, frame); plt::write_png("/dev/null", frame, palette); }));
+        bench::print_row(std::cout, results.back());
+    }
+}
+
+static void bench_e2e(const bench::Settings & s, const size_t max_x, std::vector<bench::Result> & results) {
+    FILE * sink = std::fopen("/dev/null", "w");
+    if (sink == nullptr) throw std::runtime_error("failed to open /dev/null");
+    for (const auto & mesh: MESHES) {
+        const size_t x_nodes = mesh[0], y_nodes = mesh[1];
+        if (x_nodes > max_x) break;
+        const double nodes = static_cast<double>(x_nodes * y_nodes);
+
+        auto m = make_model(x_nodes, y_nodes);
+        solver::ProblemOptions opts;
+        opts.prefactorize = true;
+        solver::BasicProblem<model::Model79> problem(m, std::numeric_limits<size_t>::max(), opts);
+        plt::FieldFormatter text;
+        results.push_back(bench::measure(
+            "e2e", mesh_name(x_nodes, y_nodes) + " step+frame", nodes, 4 * nodes * sizeof(double), s,
+            [&] {
+                problem.step();
+                text.clear();
+                text.append(m.field(), m.x_dim());
+                text.write(sink);
+            }));
+        bench::print_row(std::cout, results.back());
+
+        const std::vector<io::ProbeSpec> specs = {
+            {"point", io::PROBE_POINT, 7.0, 2.5},
+            {"profile", io::PROBE_LINE, 0.0, 2.5, 9.0, 2.5, 32},
+            {"rect", io::PROBE_RECTANGLE, 0.5, 0.5, 1.5, 1.0}};
+        io::ProbeWriter probes("/dev/null", io::ProbeSet(specs, x_nodes, y_nodes, m.parameters(), m.conditions()));
+        results.push_back(bench::measure(
+            "e2e", mesh_name(x_nodes, y_nodes) + " step+probes", nodes, 4 * nodes * sizeof(double), s,
+            [&] {
+                problem.step();
+                probes.append(problem.steps_done(), 0.0, m.field());
+            }));
+        bench::print_row(std::cout, results.back());
+    }
+    std::fclose(sink);
+}
+
+static void bench_multigrid(const bench::Settings & s, const size_t max_x, std::vector<bench::Result> & results) {
+    const std::pair<const char *, solver::cycle_type> cycles[] = {{"w-cycle", solver::W_CYCLE}, {"v-cycle", solver::V_CYCLE}};
+    for (const auto & mesh: MESHES) {
+        const size_t x_nodes = mesh[0], y_nodes = mesh[1];
+        if (x_nodes > max_x) break;
+        const double nodes = static_cast<double>(x_nodes * y_nodes);
+        for (const auto & [name, cycle]: cycles) {
+            auto m = make_model(x_nodes, y_nodes);
+            solver::MultigridOptions opts;
+            opts.cycle = cycle;
+            solver::Multigrid multigrid(m, opts);
+            size_t n_cycles = 0;
+            results.push_back(bench::measure(
+                "multigrid", mesh_name(x_nodes, y_nodes) + ' ' + name, nodes, 0, s,
+                [&] {
+                    m.reset();
+                    n_cycles = multigrid.solve().cycles;
+                }));
+            results.back().name += " (" + std::to_string(n_cycles) + " cycles)";
+            bench::print_row(std::cout, results.back());
+        }
+    }
+}
+
+// the default run of the solver: 15 units of time in 1000 steps
+constexpr size_t FULL_RUN = 1000;
+
+// times a step of Model (the double Model79 or the float Model79f)
+// eliminated in Real and returns the field after a full run
+template <typename Model, typename Real>
+static std::vector<double> bench_precision_case(
+    const bench::Settings & s, const size_t x_nodes, const size_t y_nodes,
+    const std::string & name, const solver::ProblemOptions & opts, std::vector<bench::Result> & results
+) {
+    const double nodes = static_cast<double>(x_nodes * y_nodes);
+    Model m(15e-3, 10.0 / x_nodes, 5.0 / y_nodes, 1.0, x_nodes, y_nodes);
+    solver::BasicProblem<Model, Real> problem(m, std::numeric_limits<size_t>::max(), opts);
+    results.push_back(bench::measure(
+        "precision", mesh_name(x_nodes, y_nodes) + ' ' + name,
+        nodes, 4 * nodes * sizeof(typename Model::value_type), s,
+        [&] { problem.step(); }));
+
+    m.reset();
+    for (size_t i = 0; i < FULL_RUN; ++i) problem.step();
+    return {m.field().begin(), m.field().end()};
+}
+
+static void bench_precision(const bench::Settings & s, const size_t max_x, std::vector<bench::Result> & results) {
+    struct Variant {
+        const char * name;
+        solver::ProblemOptions opts;
+    };
+    const Variant variants[] = {
+        {"lines", {solver::LINE_BY_LINE, 1, true, false}},
+        {"batched", {solver::BATCHED, 1, true, false}},
+    };
+    for (const auto & mesh: MESHES) {
+        const size_t x_nodes = mesh[0], y_nodes = mesh[1];
+        if (x_nodes > max_x) break;
+        for (const auto & v: variants) {
+            const std::string name = v.name;
+            const std::vector<double> baseline = bench_precision_case<model::Model79, double>(
+                s, x_nodes, y_nodes, "double " + name, v.opts, results);
+            bench::print_row(std::cout, results.back());
+
+            const auto report = [&](const std::vector<double> & field) {
+                double deviation = 0.0;
+                for (size_t i = 0; i < field.size(); ++i) {
+                    deviation = std::max(deviation, std::abs(field[i] - baseline[i]));
+                }
+                std::ostringstream os;
+                os << " (" << std::setprecision(1) << std::scientific << deviation << ')';
+                results.back().name += os.str();
+                bench::print_row(std::cout, results.back());
+            };
+            report(bench_precision_case<model::Model79f, double>(s, x_nodes, y_nodes, "mixed " + name, v.opts, results));
+            report(bench_precision_case<model::Model79f, float>(s, x_nodes, y_nodes, "float " + name, v.opts, results));
+        }
+    }
+}
+
+static void bench_scaling(
+    const bench::Settings & s, const size_t max_x, const size_t max_ranks, std::vector<bench::Result> & results
+) {
+    std::vector<size_t> rank_counts;
+    for (size_t n = 1; n < max_ranks; n *= 2) rank_counts.push_back(n);
+    rank_counts.push_back(max_ranks);
+    for (const auto & mesh: MESHES) {
+        const size_t x_nodes = mesh[0], y_nodes = mesh[1];
+        if (x_nodes > max_x) break;
+        const double nodes = static_cast<double>(x_nodes * y_nodes);
+        for (const size_t n_ranks: rank_counts) {
+            if (y_nodes < 2 * n_ranks) break;
+            auto m = make_model(x_nodes, y_nodes);
+            // the other ranks step whenever the measured one does
+            comm::ProcessGroup group(n_ranks, [&](comm::Communicator & c) {
+                solver::DistributedProblem problem(m, c, std::numeric_limits<size_t>::max());
+                problem.follow();
+                return EXIT_SUCCESS;
+            });
+            solver::DistributedProblem problem(m, group.communicator(), std::numeric_limits<size_t>::max());
+            results.push_back(bench::measure(
+                "scaling", mesh_name(x_nodes, y_nodes) + " ranks=" + std::to_string(n_ranks),
+                nodes, 4 * nodes * sizeof(double), s,
+                [&] { problem.step(); }));
+            problem.finish();
+            group.join();
+            bench::print_row(std::cout, results.back());
+        }
+    }
+}
+
+// returns false if the ADI splitting has lost its second order
+static bool bench_order(const bench::Settings & s, std::vector<bench::Result> & results) {
+    const size_t x_nodes = MESHES[0][0], y_nodes = MESHES[0][1];
+    const double nodes = static_cast<double>(x_nodes * y_nodes);
+    const auto run = [&](model::Model79 & m, const size_t n_steps) {
+        m.reset();
+        solver::ProblemOptions opts;
+        opts.prefactorize = true;
+        solver::BasicProblem<model::Model79> problem(m, n_steps, opts);
+        for (size_t i = 0; i < n_steps; ++i) problem.step();
+    };
+    const auto make = [&](const model::splitting scheme, const size_t n_steps) {
+        model::Model79 m(CONVERGENCE_TIME / n_steps, 10.0 / x_nodes, 5.0 / y_nodes, 1.0, x_nodes, y_nodes);
+        m.set_scheme(scheme);
+        return m;
+    };
+
+    auto reference = make(model::PEACEMAN_RACHFORD, CONVERGENCE_REFERENCE);
+    run(reference, CONVERGENCE_REFERENCE);
+    const std::pair<const char *, model::splitting> schemes[] = {
+        {"lod", model::LOCALLY_ONE_DIMENSIONAL}, {"adi", model::PEACEMAN_RACHFORD}};
+    bool second_order = true;
+    for (const auto & [name, scheme]: schemes) {
+        double previous = 0.0;
+        for (size_t n_steps = 20; n_steps <= 320; n_steps *= 2) {
+            auto m = make(scheme, n_steps);
+            results.push_back(bench::measure(
+                "order", mesh_name(x_nodes, y_nodes) + ' ' + name + " n=" + std::to_string(n_steps),
+                nodes * n_steps, 4 * nodes * n_steps * sizeof(double), s,
+                [&] { run(m, n_steps); }));
+
+            double sum_squares = 0.0;
+            for (size_t i = 0; i < m.field().size(); ++i) {
+                const double delta = m.field()[i] - reference.field()[i];
+                sum_squares += delta * delta;
+            }
+            const double error = std::sqrt(sum_squares / m.field().size());
+            std::ostringstream os;
+            os << " (" << std::setprecision(1) << std::scientific << error;
+            if (previous > 0.0) {
+                const double p = std::log2(previous / error);
+                os << " p=" << std::fixed << std::setprecision(2) << p;
+                if (scheme == model::PEACEMAN_RACHFORD and n_steps >= CONVERGENCE_REFINED and not (p >= MIN_ADI_ORDER)) {
+                    os << " BELOW " << MIN_ADI_ORDER;
+                    second_order = false;
+                }
+            }
+            os << ')';
+            previous = error;
+            results.back().name += os.str();
+            bench::print_row(std::cout, results.back());
+        }
+    }
+    if (not second_order) std::cerr << "ADI splitting converges slower than order " << MIN_ADI_ORDER << '\n';
+    return second_order;
+}
+
+static void bench_ensemble(const bench::Settings & s, const size_t max_x, std::vector<bench::Result> & results) {
+    for (const auto & mesh: MESHES) {
+        const size_t x_nodes = mesh[0], y_nodes = mesh[1];
+        if (x_nodes > max_x) break;
+        const double nodes = static_cast<double>(ENSEMBLE_SIZE * x_nodes * y_nodes);
+        const std::string name = mesh_name(x_nodes, y_nodes) + " x" + std::to_string(ENSEMBLE_SIZE);
+
+        const auto prototype = make_model(x_nodes, y_nodes);
+        std::vector<model::Model79> members(ENSEMBLE_SIZE, prototype);
+        std::vector<model::Model79 *> pointers;
+        for (size_t k = 0; k < ENSEMBLE_SIZE; ++k) {
+            const model::Parameters p = prototype.parameters();
+            members[k].set_parameters(p.dt, p.dx, p.dy, k % 2 ? 0.5 : 1.0);
+            members[k].set_boundary_temperatures({40.0 + k, 80.0});
+            pointers.push_back(&members[k]);
+        }
+
+        solver::ProblemOptions opts;
+        opts.prefactorize = true;
+        std::vector<std::unique_ptr<solver::BasicProblem<model::Model79>>> problems;
+        for (model::Model79 & m: members) {
+            problems.push_back(std::make_unique<solver::BasicProblem<model::Model79>>(m, std::numeric_limits<size_t>::max(), opts));
+        }
+        results.push_back(bench::measure(
+            "ensemble", name + " sequential", nodes, 4 * nodes * sizeof(double), s,
+            [&] { for (auto & p: problems) p->step(); }));
+        bench::print_row(std::cout, results.back());
+
+        solver::Ensemble ensemble(pointers, std::numeric_limits<size_t>::max());
+        results.push_back(bench::measure(
+            "ensemble", name + " ensemble", nodes, 4 * nodes * sizeof(double), s,
+            [&] { ensemble.step(); }));
+        bench::print_row(std::cout, results.back());
+    }
+}
+
+static void bench_wavefront(const bench::Settings & s, const size_t max_x, std::vector<bench::Result> & results) {
+    std::vector<size_t> threads = {1};
+    if (std::thread::hardware_concurrency() > 1) threads.push_back(std::thread::hardware_concurrency());
+    for (const auto & mesh: MESHES) {
+        const size_t x_nodes = mesh[0], y_nodes = mesh[1];
+        if (x_nodes > max_x) break;
+        const double nodes = static_cast<double>(x_nodes * y_nodes);
+        for (const size_t n_threads: threads) {
+            for (const bool wavefront: {false, true}) {
+                solver::ProblemOptions opts;
+                opts.n_threads = n_threads;
+                opts.prefactorize = true;
+                opts.wavefront = wavefront;
+                auto m = make_model(x_nodes, y_nodes);
+                solver::BasicProblem<model::Model79> problem(m, std::numeric_limits<size_t>::max(), opts);
+                const std::string name = mesh_name(x_nodes, y_nodes) + (wavefront ? " wavefront" : " two-pass")
+                    + " threads=" + std::to_string(n_threads);
+                results.push_back(bench::measure(
+                    "wavefront", name, nodes, 4 * nodes * sizeof(double), s,
+                    [&] { problem.step(); }));
+                bench::print_row(std::cout, results.back());
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bench::Settings settings;
+    size_t max_x = 2000;
+    size_t max_ranks = std::max(1u, std::thread::hardware_concurrency());
+    std::string suites = "tdma,step,dump,e2e,multigrid,precision,scaling,order,ensemble,wavefront";
+    std::string json_path;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--suite=", 0) == 0) suites = arg.substr(8);
+        else if (arg.rfind("--max-x=", 0) == 0) max_x = std::stoul(arg.substr(8));
+        else if (arg.rfind("--max-ranks=", 0) == 0) max_ranks = std::max<size_t>(1, std::stoul(arg.substr(12)));
+        else if (arg.rfind("--json=", 0) == 0) json_path = arg.substr(7);
+        else if (arg == "--quick") settings = {0.05, 3, 1};
+        else {
+            std::cout << usage;
+            return EXIT_FAILURE;
+        }
+    }
+    const auto enabled = [&](const std::string & suite) {
+        return (',' + suites + ',').find(',' + suite + ',') != std::string::npos;
+    };
+
+    std::vector<bench::Result> results;
+    bool passed = true;
+    bench::print_header(std::cout);
+    if (enabled("tdma")) bench_tdma(settings, results);
+    if (enabled("step")) bench_step(settings, max_x, results);
+    if (enabled("dump")) bench_dump(settings, max_x, results);
+    if (enabled("e2e")) bench_e2e(settings, max_x, results);
+    if (enabled("multigrid")) bench_multigrid(settings, max_x, results);
+    if (enabled("precision")) bench_precision(settings, max_x, results);
+    if (enabled("scaling")) bench_scaling(settings, max_x, max_ranks, results);
+    if (enabled("order")) passed = bench_order(settings, results);
+    if (enabled("ensemble")) bench_ensemble(settings, max_x, results);
+    if (enabled("wavefront")) bench_wavefront(settings, max_x, results);
+
+    if (not json_path.empty()) {
+        std::ofstream json(json_path);
+        if (not json) {
+            std::cerr << "Failed to open " << json_path << '\n';
+            return EXIT_FAILURE;
+        }
+        bench::write_json(json, results);
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// minimal benchmarking harness shared by the bench executables:
+// a case is run repeatedly until both the minimal number of
+// repetitions and the minimal time are reached, each repetition
+// being timed on its own so that the spread can be reported
+namespace bench {
+    struct Settings {
+        double min_seconds = 0.5;
+        size_t min_reps = 5;
+        size_t warmup_reps = 1;
+    };
+
+    struct Result {
+        std::string suite;
+        std::string name;
+        // work done by one repetition: number of nodes (or equations)
+        // processed and an estimate of the bytes moved to/from memory
+        double units = 0;
+        double bytes = 0;
+        size_t reps = 0;
+        // seconds per repetition
+        double mean = 0;
+        double stddev = 0;
+        double min = 0;
+        double max = 0;
+
+        double ns_per_unit() const { return mean * 1e9 / units; }
+        double gb_per_second() const { return bytes / mean * 1e-9; }
+        // relative standard deviation, %
+        double spread() const { return mean > 0 ? 100 * stddev / mean : 0; }
+    };
+
+    using clock = std::chrono::steady_clock;
+
+    template <typename Work>
+    Result measure(
+        const std::string & suite, const std::string & name,
+        const double units, const double bytes,
+        const Settings & settings, Work && work
+    ) {
+        for (size_t i = 0; i < settings.warmup_reps; ++i) work();
+
+        std::vector<double> times;
+        const auto start = clock::now();
+        while (times.size() < settings.min_reps
+               or std::chrono::duration<double>(clock::now() - start).count() < settings.min_seconds) {
+            const auto t0 = clock::now();
+            work();
+            times.push_back(std::chrono::duration<double>(clock::now() - t0).count());
+        }
+
+        Result r;
+        r.suite = suite;
+        r.name = name;
+        r.units = units;
+        r.bytes = bytes;
+        r.reps = times.size();
+        for (const double t: times) r.mean += t;
+        r.mean /= times.size();
+        for (const double t: times) r.stddev += (t - r.mean) * (t - r.mean);
+        r.stddev = times.size() > 1 ? std::sqrt(r.stddev / (times.size() - 1)) : 0.0;
+        r.min = *std::min_element(times.begin(), times.end());
+        r.max = *std::max_element(times.begin(), times.end());
+        return r;
+    }
+
+    inline void print_header(std::ostream & os) {
+        os  << std::left << std::setw(10) << "suite"
+            << std::setw(34) << "case" << std::right
+            << std::setw(8) << "reps"
+            << std::setw(14) << "mean us"
+            << std::setw(10) << "+-%"
+            << std::setw(12) << "ns/node"
+            << std::setw(10) << "GB/s" << '\n';
+    }
+
+    inline void print_row(std::ostream & os, const Result & r) {
+        os  << std::left << std::setw(10) << r.suite
+            << std::setw(34) << r.name << std::right
+            << std::setw(8) << r.reps
+            << std::fixed
+            << std::setprecision(1) << std::setw(14) << r.mean * 1e6
+            << std::setprecision(1) << std::setw(10) << r.spread()
+            << std::setprecision(3) << std::setw(12) << r.ns_per_unit()
+            << std::setprecision(2) << std::setw(10) << r.gb_per_second()
+            << std::defaultfloat << std::endl;
+    }
+
+    // machine-readable report, one object per case
+    inline void write_json(std::ostream & os, const std::vector<Result> & results) {
+        os << "{\n  \"results\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result & r = results[i];
+            os  << (i ? ",\n" : "\n")
+                << "    {\"suite\": \"" << r.suite << "\", \"case\": \"" << r.name << "\""
+                << std::setprecision(9)
+                << ", \"reps\": " << r.reps
+                << ", \"mean_s\": " << r.mean
+                << ", \"stddev_s\": " << r.stddev
+                << ", \"min_s\": " << r.min
+                << ", \"max_s\": " << r.max
+                << ", \"units\": " << r.units
+                << ", \"bytes\": " << r.bytes
+                << ", \"ns_per_unit\": " << r.ns_per_unit()
+                << ", \"gb_per_s\": " << r.gb_per_second() << "}";
+        }
+        os << "\n  ]\n}\n";
+    }
+}
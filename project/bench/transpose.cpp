@@ -0,0 +1,76 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+
+#include "solver.hpp"
+
+// compares the strided y-sweep with the tile-transposed one
+// (both in the prefactorized LINE_BY_LINE mode) on meshes
+// from 200x100 up to 8000x4000 nodes
+constexpr std::string_view usage = "Usage: bench_transpose [<max x_nodes:uint>]\n";
+
+constexpr size_t MESHES[][2] = {
+    {200, 100}, {500, 250}, {1000, 500}, {2000, 1000}, {4000, 2000}, {8000, 4000}};
+constexpr double MIN_SECONDS = 0.5;
+constexpr size_t MIN_STEPS = 3;
+
+// average wall time of a step in seconds
+static double time_steps(const size_t x_nodes, const size_t y_nodes, const solver::ProblemOptions & opts) {
+    model::Model79 m(15e-3, 10.0 / x_nodes, 5.0 / y_nodes, 1.0, x_nodes, y_nodes);
+    solver::BasicProblem<model::Model79> problem(m, std::numeric_limits<size_t>::max(), opts);
+    problem.step();  // warm up
+
+    using clock = std::chrono::steady_clock;
+    size_t steps = 0;
+    const auto start = clock::now();
+    double elapsed = 0;
+    while (steps < MIN_STEPS or elapsed < MIN_SECONDS) {
+        problem.step();
+        ++steps;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    return elapsed / steps;
+}
+
+int main(int argc, char* argv[]) {
+    size_t max_x = MESHES[std::size(MESHES) - 1][0];
+    if (argc > 2) {
+        std::cout << usage;
+        return EXIT_FAILURE;
+    }
+    if (argc == 2) max_x = std::stoul(argv[1]);
+
+    solver::ProblemOptions strided;
+    strided.prefactorize = true;
+    solver::ProblemOptions transposed = strided;
+    transposed.transpose_y = true;
+
+    std::cout
+        << std::setw(12) << "mesh"
+        << std::setw(16) << "strided ms"
+        << std::setw(16) << "transposed ms"
+        << std::setw(16) << "strided ns/n"
+        << std::setw(16) << "transp. ns/n"
+        << std::setw(10) << "speedup" << '\n';
+
+    for (const auto & mesh: MESHES) {
+        const size_t x_nodes = mesh[0], y_nodes = mesh[1];
+        if (x_nodes > max_x) break;
+        const double nodes = static_cast<double>(x_nodes * y_nodes);
+        const double t_strided = time_steps(x_nodes, y_nodes, strided);
+        const double t_transposed = time_steps(x_nodes, y_nodes, transposed);
+
+        std::cout
+            << std::setw(12) << std::to_string(x_nodes) + 'x' + std::to_string(y_nodes)
+            << std::fixed << std::setprecision(3)
+            << std::setw(16) << t_strided * 1e3
+            << std::setw(16) << t_transposed * 1e3
+            << std::setw(16) << t_strided * 1e9 / nodes
+            << std::setw(16) << t_transposed * 1e9 / nodes
+            << std::setw(10) << t_strided / t_transposed << '\n';
+    }
+    return EXIT_SUCCESS;
+}
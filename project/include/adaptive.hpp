@@ -0,0 +1,84 @@
+#pragma once
+
+#include "solver.hpp"
+
+namespace solver {
+    // SteadyStateMonitor measures how fast the field still changes:
+    // the max and the root mean square of (T_new - T_old) / dt
+    // over the nodes, the field is at equilibrium once both are small
+    class SteadyStateMonitor {
+    private:
+        std::vector<double> previous;
+        double max_rate = 0.0;
+        double rms_rate = 0.0;
+    public:
+        // remembers the field the next update() is compared with
+        void reset(util::strided_span<const double> field);
+        // compares the field with the previous one, dt apart
+        void update(util::strided_span<const double> field, const double dt);
+        double max_residual() const { return max_rate; }
+        double rms_residual() const { return rms_rate; }
+    };
+
+    struct AdaptiveOptions {
+        // bounds of the time step
+        double dt_min = 0.0;
+        double dt_max = 0.0;
+        // largest local error allowed per step, root mean square over the nodes:
+        // the splitting error of a few nodes next to the corners of the plate
+        // is O(dt) and would hold the max norm at tiny steps for the whole run
+        double tolerance = 0.1;
+        // the new step is the ideal one times safety, and
+        // it changes by a factor from [max_shrink, max_growth]
+        double safety = 0.9;
+        double max_growth = 2.0;
+        double max_shrink = 0.2;
+    };
+
+    // AdaptiveStepper advances Model79 with a variable time step.
+    // The local error is estimated by step doubling: a step of dt is
+    // compared with two steps of dt / 2 and the difference is taken
+    // as the error of the latter (an overestimate for either splitting).
+    // The step is accepted (the two half-steps are kept) if the error is
+    // below the tolerance and retried with a smaller dt otherwise; dt
+    // then changes by (tolerance / error)^(1 / (p + 1)) for the next step,
+    // p being the order of the splitting (1 for LOD, 2 for ADI).
+    // Each attempt costs three solver steps, which the much larger steps
+    // later in the transient more than pay for. The full step and the
+    // half-steps each change the model parameters, so the problem must
+    // not cache factorizations (prefactorize, transpose_y, wavefront):
+    // they would be remade twice per attempt and save nothing. The split
+    // sweeps (ProblemOptions::split) cannot do without theirs and pay
+    // for two partition factorizations per attempt
+    class AdaptiveStepper {
+    private:
+        model::Model79 & m;
+        const AdaptiveOptions opts;
+        BasicProblem<model::Model79> problem;
+        double dt;
+        double t = 0.0;
+        size_t n_accepted = 0;
+        size_t n_rejected = 0;
+        double last_error = 0.0;
+        // the field at the start of an attempt and after the full step
+        std::vector<double> start;
+        std::vector<double> full;
+    private:
+        void set_dt(const double new_dt);
+    public:
+        AdaptiveStepper(
+            model::Model79 & model, const double initial_dt,
+            const AdaptiveOptions & opts, const ProblemOptions & problem_opts = {});
+        // advances the model by one accepted step no longer than
+        // max_dt, returns the step actually taken
+        double step(const double max_dt);
+        // continues the count of a restarted run
+        void resume(const double time, const size_t steps) { t = time; n_accepted = steps; }
+        double time() const { return t; }
+        // step the next call starts with
+        double next_dt() const { return dt; }
+        size_t accepted() const { return n_accepted; }
+        size_t rejected() const { return n_rejected; }
+        double error() const { return last_error; }
+    };
+}
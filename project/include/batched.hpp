@@ -0,0 +1,77 @@
+#pragma once
+
+#include "shared.hpp"
+
+namespace solver {
+    // Real is the precision the SLEs are eliminated in,
+    // double unless stated otherwise (see BasicProblem)
+    template <typename Real>
+    using basic_diagonal = std::vector<Real>;
+    template <typename Real>
+    using basic_tridiagonal_mx = std::array<basic_diagonal<Real>, 4>;
+    using diagonal = basic_diagonal<double>;
+    using tridiagonal_mx_extended = basic_tridiagonal_mx<double>;
+
+    // BatchedTDMA solves a batch of independent tridiagonal SLEs
+    // of the same length at once. The systems are stored interleaved
+    // (structure-of-arrays): i-th coefficient of the l-th system
+    // is located at [i * width + l], thus a single SIMD register
+    // holds the same row of `width` different systems and the
+    // forward/backward sweeps advance all of them simultaneously.
+    // Depending on the CPU, AVX-512 (8 double or 16 float lanes),
+    // AVX2 (4 or 8 lanes) or a portable scalar kernel is picked at runtime.
+    // Instantiated for double and float in batched.cpp
+    template <typename Real>
+    class BasicBatchedTDMA {
+    public:
+        using kernel = void (*)(
+            const Real * a, const Real * b, const Real * c, const Real * d,
+            Real * c_star, Real * d_star, Real * storage,
+            const size_t length, const size_t width);
+        using factorized_kernel = void (*)(
+            const Real * a, const Real * c_star, const Real * inv_pivot, const Real * d,
+            Real * storage, const size_t length, const size_t width);
+    private:
+        size_t length = 0;
+        size_t width = 0;
+        kernel solve_kernel = nullptr;
+        factorized_kernel factorized_solve_kernel = nullptr;
+        factorized_kernel shared_solve_kernel = nullptr;
+        basic_diagonal<Real> c_star;
+        basic_diagonal<Real> d_star;
+    public:
+        BasicBatchedTDMA() = default;
+        BasicBatchedTDMA(const size_t diagonal_length, const size_t width = native_width());
+        ~BasicBatchedTDMA() = default;
+        // SLE diagonals and the storage are expected to hold
+        // diagonal_length * width interleaved values
+        void solve(const basic_tridiagonal_mx<Real> & SLE, basic_diagonal<Real> & storage);
+        // solves rows [first, last) of every system only, leaving the rest of
+        // the storage as is. Same as the full solve if the rows first and
+        // last - 1 do not couple to the outside (they are {0, 1, 0} or the ends)
+        void solve(const basic_tridiagonal_mx<Real> & SLE, basic_diagonal<Real> & storage, const size_t first, const size_t last);
+        // interleaved counterparts of TDMA::factorize() and TDMA::solve_factorized(),
+        // c_star and inv_pivot hold diagonal_length * width values
+        void factorize(const basic_tridiagonal_mx<Real> & SLE, Real * c_star, Real * inv_pivot) const;
+        void solve_factorized(
+            const Real * a, const Real * c_star, const Real * inv_pivot,
+            const basic_diagonal<Real> & d, basic_diagonal<Real> & storage) const;
+        void solve_factorized(
+            const Real * a, const Real * c_star, const Real * inv_pivot,
+            const basic_diagonal<Real> & d, basic_diagonal<Real> & storage,
+            const size_t first, const size_t last) const;
+        // rows [first, last) of every lane against a single matrix: a, c_star
+        // and inv_pivot are one TDMA::factorize() of diagonal_length values
+        // (not interleaved), e.g. the same line of several models with equal
+        // coefficients. Every lane equals TDMA::solve_factorized() bit by bit
+        void solve_shared(
+            const Real * a, const Real * c_star, const Real * inv_pivot,
+            const basic_diagonal<Real> & d, basic_diagonal<Real> & storage,
+            const size_t first, const size_t last) const;
+        size_t lanes() const { return width; }
+        // number of Reals in the widest SIMD register available
+        static size_t native_width();
+    };
+
+    using BatchedTDMA = BasicBatchedTDMA<double>;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "model.hpp"
+
+namespace io {
+    // state needed to resume a run: the field after the given
+    // timestep and the parameters it has been computed with
+    struct Checkpoint {
+        size_t step = 0;
+        double time = 0.0;
+        size_t width = 0;
+        size_t height = 0;
+        model::Parameters parameters{};
+        std::vector<double> values;
+    };
+
+    // reads and validates (header and checksum) a checkpoint file
+    Checkpoint read_checkpoint(const std::string & path);
+    // writes the checkpoint atomically: to a temporary file
+    // in the same directory first, which then replaces path
+    void write_checkpoint(const std::string & path, const Checkpoint & c);
+
+    // CheckpointWriter writes checkpoints on a background thread.
+    // submit() only copies the field into a spare buffer and returns;
+    // should the writer still be busy with an older checkpoint by then,
+    // a checkpoint that has not been started yet is replaced by the new one,
+    // so the solver never waits for the disk
+    class CheckpointWriter {
+    public:
+        explicit CheckpointWriter(const std::string & path);
+        ~CheckpointWriter();
+        CheckpointWriter(const CheckpointWriter &) = delete;
+        CheckpointWriter & operator=(const CheckpointWriter &) = delete;
+        void submit(
+            const size_t step, const double time,
+            const size_t width, const size_t height,
+            const model::Parameters & parameters,
+            util::strided_span<const double> field);
+        // blocks until the last submitted checkpoint is on disk,
+        // rethrows the error of a failed write if there was one
+        void flush();
+        size_t written() const { return n_written; }
+        size_t superseded() const { return n_superseded; }
+    private:
+        const std::string path;
+        // pending is filled by submit(), the writer swaps it with
+        // its own buffer, so the field is copied once per checkpoint
+        Checkpoint pending;
+        Checkpoint in_flight;
+        bool has_pending = false;
+        bool busy = false;
+        bool stopped = false;
+        size_t n_written = 0;
+        size_t n_superseded = 0;
+        std::exception_ptr error;
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::thread writer;
+    private:
+        void writer_loop();
+    };
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <sys/types.h>
+
+#include "shared.hpp"
+
+namespace comm {
+    // Communicator is the message layer between the ranks of a
+    // distributed run: blocking point-to-point transfers of doubles,
+    // messages from one rank to another arrive in the order they were
+    // sent, and both sides must agree on the length of each one.
+    // The solver only talks through this interface, so an MPI
+    // implementation (MPI_Send/MPI_Recv on MPI_COMM_WORLD) can take
+    // the place of the shared memory one
+    class Communicator {
+    public:
+        virtual ~Communicator() = default;
+        virtual size_t rank() const = 0;
+        virtual size_t size() const = 0;
+        virtual void send(const size_t dest, const double * data, const size_t n) = 0;
+        virtual void recv(const size_t source, double * data, const size_t n) = 0;
+    };
+
+    struct Mailboxes;
+
+    // ProcessGroup runs a distributed job on local processes. The
+    // constructor forks n_ranks - 1 processes, each of them runs
+    // worker() with its Communicator and exits with the returned status
+    // (the forked ranks start with a copy-on-write copy of the memory
+    // of the caller, so they see everything set up before). The caller
+    // is the rank 0 and goes on with communicator().
+    // The ranks talk through a POSIX shared memory segment mapped
+    // before the fork, one single-slot channel per ordered pair of ranks
+    // guarded by process-shared semaphores; longer messages go through
+    // the slot in chunks. A rank which fails (worker() throws or returns
+    // nonzero) marks the segment; a rank blocked on a transfer checks
+    // for that and for exited processes a few times per second, and
+    // throws instead of waiting forever
+    class ProcessGroup {
+    public:
+        using job = std::function<int(Communicator & comm)>;
+    private:
+        Mailboxes * mailboxes = nullptr;
+        size_t mapped_size = 0;
+        std::vector<pid_t> workers;
+        std::unique_ptr<Communicator> root;
+    private:
+        // stops the workers still running and unmaps the segment
+        void release();
+    public:
+        ProcessGroup() = delete;
+        ProcessGroup(const ProcessGroup &) = delete;
+        ProcessGroup & operator=(const ProcessGroup &) = delete;
+        ProcessGroup(const size_t n_ranks, const job & worker);
+        // marks the segment as failed if join() has not been called,
+        // so that the workers do not wait for the rank 0 forever
+        ~ProcessGroup();
+        Communicator & communicator() { return *root; }
+        // waits for the workers to exit, throws if any of them failed
+        void join();
+    };
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "comm.hpp"
+#include "model.hpp"
+#include "solver.hpp"
+
+namespace solver {
+    // DistributedProblem is the share of a Problem one rank of a
+    // comm::ProcessGroup steps: the plate is cut into strips of rows, one
+    // per rank. The x-sweep is local to the strips. A column crosses
+    // all of them and is solved by the partition method: the last row of
+    // every strip but the last one is a separator, each rank eliminates
+    // the rows between two separators on its own, which leaves them as
+    // y + p * S_above + q * S_below, and the separators make up a reduced
+    // tridiagonal system of n_ranks - 1 equations per column (the Schur
+    // complement of the strips) that the rank 0 solves. p, q and the
+    // reduced matrices only depend on the coefficients and are computed
+    // by the constructor, so the model parameters must be set by then;
+    // per step a rank exchanges a value per column with the neighbour
+    // above and two with the rank 0. The solution is the one of the
+    // serial Problem up to the rounding (the elimination order differs).
+    // Every rank keeps a whole model but only updates the rows of its strip
+    // (the forked ranks share the rest with the rank 0 copy-on-write);
+    // gather() collects the strips in the model of the rank 0.
+    // The rank 0 drives the run: its step() and gather() have every rank
+    // do the same, the other ranks call follow() and return from it
+    // once the rank 0 calls finish(). Only the LOD splitting is supported
+    class DistributedProblem {
+    private:
+        enum command {
+            STOP,
+            STEP,
+            GATHER
+        };
+    private:
+        size_t current_step = 0;
+        const size_t n_iters = 0;
+        model::Model79 & m;
+        comm::Communicator & comm;
+        // the strip is [first_row, last_row), the rows before
+        // separator_row are eliminated locally (separator_row == last_row
+        // on the last rank, which has no separator)
+        size_t first_row = 0;
+        size_t last_row = 0;
+        size_t separator_row = 0;
+        Factorization rows;
+        // interior of every column, interior_size() equations each,
+        // its responses to the separators above (p) and below (q)
+        // and the solution for the RHS alone (y_local)
+        Factorization cols;
+        diagonal p;
+        diagonal q;
+        diagonal y_local;
+        // equation of the separator of every column: couplings to the
+        // interior rows above and below it, diagonal, and the RHS once
+        // the interiors are eliminated
+        diagonal separator_a;
+        diagonal separator_b;
+        diagonal separator_c;
+        diagonal separator_d;
+        // reduced systems (rank 0 only), n_ranks - 1 equations per column
+        Factorization reduced;
+        diagonal reduced_d;
+        // separators above and below the strip, per column
+        diagonal s_above;
+        diagonal s_below;
+        diagonal line;
+        diagonal message;
+        bool finished = false;
+    private:
+        size_t interior_size() const { return separator_row - first_row; }
+        bool has_separator() const { return separator_row < last_row; }
+        void setup();
+        void reduce_setup();
+        void broadcast(const command c);
+        void local_step();
+        void local_gather();
+        void solve_reduced();
+    public:
+        DistributedProblem() = delete;
+        DistributedProblem(const DistributedProblem &) = delete;
+        DistributedProblem & operator=(const DistributedProblem &) = delete;
+        DistributedProblem(model::Model79 & model, comm::Communicator & comm, const size_t n_iters);
+        // rows [first, last) of the plate go to the rank r of n,
+        // at least 2 rows per rank
+        static Segment strip(const size_t y_dim, const size_t r, const size_t n);
+        // rank 0 only
+        void step();
+        void gather();
+        void finish();
+        // other ranks: performs the commands of the rank 0 until finish()
+        void follow();
+        size_t steps_done() const { return current_step; }
+        void resume_at(const size_t step);
+        size_t rank() const { return comm.rank(); }
+    };
+}
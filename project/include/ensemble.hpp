@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory>
+
+#include "model.hpp"
+#include "batched.hpp"
+#include "partitioned.hpp"
+#include "pool.hpp"
+
+namespace solver {
+    // Ensemble steps K models of the same plate (a parameter sweep: the
+    // diffusivity, the boundary temperatures, the initial fields) in one
+    // process, each step of it is a Problem::step() of every member. The
+    // members are grouped by their parameters and splitting: the members of
+    // a group have the same matrices, so the group keeps a single
+    // factorization of every row and column, and the line of
+    // BatchedTDMA::native_width() members at a time is solved in the lanes
+    // of a batch against it (see BatchedTDMA::solve_shared()). The lines
+    // are only solved over their active segments, as in Problem. The result
+    // of every member is the one of its own prefactorized LINE_BY_LINE
+    // Problem bit by bit.
+    // The members are owned by the caller and must share the mesh; the
+    // groups are rebuilt once the parameters of a member have been changed
+    class Ensemble {
+    private:
+        using Members = std::vector<model::Model79 *>;
+        // members with equal parameters
+        struct Group {
+            std::vector<size_t> members;
+            Factorization rows;
+            Factorization cols;
+            Segments segments_x;
+            Segments segments_y;
+        };
+        // one instance per thread
+        struct Workspace {
+            BatchedTDMA batched_x;
+            BatchedTDMA batched_y;
+            // interleaved RHS and solution of a batch
+            diagonal d_x;
+            diagonal f_x;
+            diagonal d_y;
+            diagonal f_y;
+            tridiagonal_mx_extended mx_x;
+            tridiagonal_mx_extended mx_y;
+            Workspace(const size_t x_dim, const size_t y_dim, const size_t width);
+        };
+    private:
+        size_t current_step = 0;
+        const size_t n_iters = 0;
+        Members members;
+        // member revisions the groups were made for
+        std::vector<size_t> revisions;
+        std::vector<Group> groups;
+        std::vector<Workspace> workspaces;
+        std::unique_ptr<ThreadPool> pool;
+    private:
+        size_t x_dim() const { return members.front()->x_dim(); }
+        size_t y_dim() const { return members.front()->y_dim(); }
+        bool stale() const;
+        void regroup();
+        void factorize(Group & g);
+        // runs sweep(workspace, first, last) for the per-thread chunks of n lines
+        template <typename Sweep>
+        void for_each_chunk(const size_t n, const Sweep & sweep);
+        void solve_rows(Workspace & ws, const Group & g, const size_t y_first, const size_t y_last);
+        void solve_cols(Workspace & ws, const Group & g, const size_t x_first, const size_t x_last);
+    public:
+        Ensemble() = delete;
+        Ensemble(const Ensemble &) = delete;
+        Ensemble & operator=(const Ensemble &) = delete;
+        Ensemble(const Members & members, const size_t n_iters, const size_t n_threads = 1);
+        void step();
+        size_t steps_done() const { return current_step; }
+        size_t size() const { return members.size(); }
+        size_t n_groups() const { return groups.size(); }
+        model::Model79 & member(const size_t k) { return *members[k]; }
+        const model::Model79 & member(const size_t k) const { return *members[k]; }
+    };
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <charconv>
+#include <string_view>
+
+#include "shared.hpp"
+
+namespace plt {
+    // how the values of the field are printed: GENERAL matches
+    // the default std::ostream output (%g) with precision significant
+    // digits, FIXED prints precision digits after the decimal point,
+    // which is enough for temperatures of a known range
+    enum number_style {
+        GENERAL,
+        FIXED
+    };
+
+    struct NumberFormat {
+        number_style style = GENERAL;
+        int precision = 6;
+    };
+
+    // FieldFormatter renders fields as text into a byte buffer
+    // which is kept between frames: once it has grown to the size
+    // of a frame no more allocations take place. Values are printed
+    // with std::to_chars, with the same text as operator<< would
+    // give for the default NumberFormat
+    class FieldFormatter {
+    private:
+        NumberFormat fmt;
+        std::vector<char> buffer;
+        size_t used = 0;
+    private:
+        // makes room for at least n more bytes
+        void reserve(const size_t n);
+        void append_value(const double value);
+    public:
+        FieldFormatter(const NumberFormat & fmt = {});
+        void clear() { used = 0; }
+        void append(std::string_view text);
+        // rows of width values separated by spaces, one row per line
+        void append(util::strided_span<const double> field, const size_t width);
+        std::string_view view() const { return {buffer.data(), used}; }
+        // writes the whole buffer with a single fwrite
+        void write(FILE * stream) const;
+    };
+}
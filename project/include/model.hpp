@@ -9,7 +9,8 @@ namespace model {
     using tridiag_coefs = std::array<double, 3>;
     using boundary_coefs = std::array<double, 2>;
 
-    enum condition {
+    // stored one byte per node in the grid
+    enum condition : uint8_t {
         NO_CONDITION,
         BOUNDARY_1TYPE,
         BOUNDARY_2TYPE_X,
@@ -25,6 +26,43 @@ namespace model {
         HORIZONTAL
     };
 
+    // how a time step is split into the x- and the y-sweep: locally
+    // one-dimensional (either sweep is implicit over the whole dt, first
+    // order in time) or the Peaceman-Rachford ADI (either sweep is a half
+    // of dt, implicit along its lines and explicit across them, second
+    // order; same as the Douglas scheme for this problem)
+    enum splitting {
+        LOCALLY_ONE_DIMENSIONAL,
+        PEACEMAN_RACHFORD
+    };
+
+    // time step, mesh steps and the thermal diffusivity
+    struct Parameters {
+        double dt;
+        double dx;
+        double dy;
+        double a;
+    };
+
+    // values of Dirichlet's BC nodes: the floor and the ceiling
+    // (with the inclined side) of the plate
+    struct BoundaryTemperatures {
+        double floor = T_FLOOR;
+        double ceiling = T_CEIL;
+    };
+
+    // equation of the stationary problem (dT/dt = 0) at a node:
+    // coefficients of the node itself and of its neighbours along
+    // x (west = x - 1, east = x + 1) and y (north = y - 1, south = y + 1)
+    struct StationaryRow {
+        double center;
+        double west;
+        double east;
+        double north;
+        double south;
+        double rhs;
+    };
+
     // model instance should provide sets of coefficients
     // for each grid point in horizontal and vertical directions
     // to apply the Thompson's tridiagonal matrix algorithm
@@ -32,10 +70,14 @@ namespace model {
     // and a_1, a_2
     // the heat PDE is defined as follows:
     // \frac{\partial{T}}{\partial{t}} = a_1 * \frac{\partial^2{T}}{\partial^2{x}} + a_2 * \frac{\partial^2{T}}{\partial^2{y}}
-    class IModel {
+    // Real is the type the field is stored in, the coefficients
+    // and the lines passed through the interface are always double
+    template <typename Real>
+    class BasicIModel {
     protected:
         virtual void dump(std::ostream & os) const = 0;
     public:
+        using value_type = Real;
         virtual void set_current_value(const size_t x, const size_t y, const double value) = 0;
         virtual double get_RHS_coefs_x(const size_t x, const size_t y) const = 0;
         virtual double get_RHS_coefs_y(const size_t x, const size_t y) const = 0;
@@ -45,52 +87,165 @@ namespace model {
         virtual boundary_coefs get_y_last_coefs(const size_t y) const = 0;
         virtual boundary_coefs get_x_first_coefs(const size_t x) const = 0;
         virtual boundary_coefs get_y_first_coefs(const size_t x) const = 0;
+        // bulk counterparts of the methods above, one call per line instead of
+        // several per node: fill the SLE (diagonals a, b, c and the RHS d)
+        // of row y (column x) or only its RHS, and store a solved line back.
+        // Only the equations [first, last) of the line are touched, i-th
+        // equation goes to [i * stride] so that both plain and
+        // interleaved (see solver::BatchedTDMA) layouts can be filled.
+        // An equation {0, 1, 0} pins its node to the RHS, which is the value
+        // of the node: the node never changes, and the solvers may leave it
+        // out along with its neighbours that are pinned as well (see
+        // solver::BasicProblem). Which equations are pinned only depends on the geometry;
+        // the nodes of the 1st type and the outer ones always have pinned equations
+        virtual void fill_x_line(
+            const size_t y, const size_t first, const size_t last,
+            double * a, double * b, double * c, double * d, const size_t stride) const = 0;
+        virtual void fill_y_line(
+            const size_t x, const size_t first, const size_t last,
+            double * a, double * b, double * c, double * d, const size_t stride) const = 0;
+        virtual void fill_x_rhs(const size_t y, const size_t first, const size_t last, double * d, const size_t stride) const = 0;
+        virtual void fill_y_rhs(const size_t x, const size_t first, const size_t last, double * d, const size_t stride) const = 0;
+        virtual void scatter_x_line(const size_t y, const size_t first, const size_t last, const double * f, const size_t stride) = 0;
+        virtual void scatter_y_line(const size_t x, const size_t first, const size_t last, const double * f, const size_t stride) = 0;
+        // column block variants for the transposed y-sweep: columns [x_first, x_last)
+        // are stored column-major, column x at [(x - x_first) * ld], the field
+        // is transposed tile by tile so that its rows are read contiguously
+        virtual void fill_y_rhs_block(const size_t x_first, const size_t x_last, double * d, const size_t ld) const = 0;
+        virtual void scatter_y_block(const size_t x_first, const size_t x_last, const double * f, const size_t ld) = 0;
+        // the RHS of the y equations of the tile of rows [y_first, y_last) and
+        // columns [x_first, x_last), row-major: node (x, y) at [y * ld + x]
+        // (the field itself with ld = x_dim(), for the tiled sweeps)
+        virtual void fill_y_rhs_tile(
+            const size_t y_first, const size_t y_last,
+            const size_t x_first, const size_t x_last, double * d, const size_t ld) const = 0;
+        // the RHS of the ADI sweeps carry the explicit operator across the
+        // lines, which reads the neighbouring lines: prepare_rhs() evaluates
+        // it for the rows [y_first, y_last) of the sweep in direction d
+        // (HORIZONTAL is the x-sweep). A solver calls it for every row before
+        // the sweep overwrites any of them; it does nothing for the LOD splitting
+        virtual void prepare_rhs(const direction d, const size_t y_first, const size_t y_last) = 0;
+        // the y-sweep of the ADI moves the nodes whose x equation is a
+        // condition (but the y one is not) off the condition, which the
+        // x-sweep of the next step imposes again. restore_conditions()
+        // imposes it right after the step instead (rows [y_first, y_last)),
+        // otherwise these nodes lag O(dt) behind. Nothing for the LOD splitting
+        virtual void restore_conditions(const size_t y_first, const size_t y_last) = 0;
+        virtual splitting scheme() const = 0;
         virtual size_t x_dim() const = 0;
         virtual size_t y_dim() const = 0;
-        friend std::ostream & operator<<(std::ostream & os, const IModel & m) {
+        // the whole field, row after row (y_dim rows of x_dim values)
+        virtual util::strided_span<const Real> field() const = 0;
+        // writable views of row y and column x of the field, no copies involved.
+        // A solver eliminating in the precision of the field may fill the RHS
+        // of a line right into it (the d of fill_x_rhs() and fill_y_rhs()
+        // may point into the line: the RHS of a node only reads the node
+        // itself) and solve it in place; the pinned equations then solve
+        // to the values they started from, the conditions hold as they are
+        virtual util::strided_span<Real> row(const size_t y) = 0;
+        virtual util::strided_span<Real> col(const size_t x) = 0;
+        // the tridiagonal coefficients only depend on the geometry and the
+        // parameters, never on the field. revision() is bumped each time
+        // they change so that the solvers caching factorizations can tell
+        virtual size_t revision() const = 0;
+        friend std::ostream & operator<<(std::ostream & os, const BasicIModel & m) {
             m.dump(os);
             return os;
         }
     };
 
+    using IModel = BasicIModel<double>;
+
     // Model79 implements IModel interface and stands for my particular problem setup
     // thus such methods as is_inner and is_border are present to deduce
     // the geometry. This is not the most elegant approach, however...
-    class Model79: public IModel {
+    // The class is final so that calls through Model79 & are devirtualized.
+    // Real is the type of the field (double for Model79, float for
+    // Model79f), the bulk methods additionally come as templates over
+    // the type of the lines, so that a solver may eliminate in
+    // either precision; both are instantiated in model.cpp
+    template <typename Real>
+    class BasicModel79 final: public BasicIModel<Real> {
     protected:
         void dump(std::ostream & os) const override;
     private:
-        // holds boundary condition type if present
-        // and the default temperature value in case of
-        // Dirichlet's BC (T = const)
-        struct Node {
-            condition condition_type = NO_CONDITION;
-            double current_value = 0;
-            double initial_value = 0;
-        };
-        // Grid entity contains matrix of condition flags
-        // for ease boundary condition detection
+        // Grid entity keeps one contiguous row-major array per field:
+        // the temperature the solver streams through, the condition
+        // flags for ease boundary condition detection and, sparsely,
+        // the default temperature values of Dirichlet's BC nodes (T = const)
         struct Grid {
             const size_t width;
             const size_t height;
-            std::vector<std::vector<Node>> nodes;
+            util::aligned_vector<Real> values;
+            // RHS of the ADI sweeps (empty for the LOD splitting)
+            util::aligned_vector<Real> rhs;
+            std::vector<condition> conditions;
+            // (node index, true if on the floor) pairs sorted by index,
+            // the values come from the boundary temperatures
+            std::vector<std::pair<size_t, bool>> fixed;
+            // ADI only: whether the x (bit 0) and y (bit 1) equations of a
+            // node are diffusion ones, and the sorted x-conditions of the
+            // nodes the y-sweep moves (see restore_conditions())
+            std::vector<uint8_t> diffusion;
+            std::vector<size_t> relaxed;
             Grid(const size_t width, const size_t height):
                 width(width), height(height),
-                nodes(height, std::vector<Node>(width)) {};
+                values(width * height, 0),
+                conditions(width * height, NO_CONDITION) {};
             ~Grid() = default;
+            size_t index(const size_t x, const size_t y) const { return y * width + x; }
+            condition at(const size_t x, const size_t y) const { return conditions[index(x, y)]; }
+            condition & at(const size_t x, const size_t y) { return conditions[index(x, y)]; }
         };
     private:
-        const double dt;
-        const double dx;
-        const double dy;
-        const double a;
+        double dt;
+        double dx;
+        double dy;
+        double a;
+        size_t coefs_revision = 0;
+        splitting time_splitting = LOCALLY_ONE_DIMENSIONAL;
+        BoundaryTemperatures temperatures;
         const std::pair<size_t, size_t> dims;
         Grid grid;
     private:
         void throw_on_bounds(const size_t x, const size_t y) const;
         void grid_set_up();  // init grid with required flags + default values
         bool is_inner(const size_t x, const size_t y) const;
+        // fills grid.diffusion and grid.relaxed for the current coefficients
+        void classify();
+        // share of a * dt the sweeps take implicitly
+        double implicit_weight() const { return time_splitting == PEACEMAN_RACHFORD ? 0.5 : 1.0; }
+        // value of the node a diffusion equation starts from
+        Real node_rhs(const size_t i) const { return time_splitting == PEACEMAN_RACHFORD ? grid.rhs[i] : grid.values[i]; }
+        // per-node kernels without bounds checks
+        double rhs_x(const size_t x, const size_t y) const;
+        double rhs_y(const size_t x, const size_t y) const;
+        tridiag_coefs x_coefs(const size_t x, const size_t y) const;
+        tridiag_coefs y_coefs(const size_t x, const size_t y) const;
+        template <typename T>
+        void load_values(util::strided_span<const T> values);
     public:
+        // views into the temperature field, no copies involved
+        util::strided_span<Real> row(const size_t y) override;
+        util::strided_span<Real> col(const size_t x) override;
+        util::strided_span<const Real> row(const size_t y) const;
+        util::strided_span<const Real> col(const size_t x) const;
+        util::strided_span<const Real> field() const override { return {grid.values.data(), grid.values.size()}; }
+        // condition of every node, laid out as the field
+        util::strided_span<const condition> conditions() const { return {grid.conditions.data(), grid.conditions.size()}; }
+        Parameters parameters() const { return {dt, dx, dy, a}; }
+        BoundaryTemperatures boundary_temperatures() const { return temperatures; }
+        // restores the initial field: zero everywhere
+        // but the nodes with fixed values
+        void reset();
+        // replaces the field, e.g. with the one of a checkpoint,
+        // values of the other precision are converted
+        void load_field(util::strided_span<const double> values);
+        void load_field(util::strided_span<const float> values);
+        // the stationary problem with the same boundary conditions
+        // as the time steps, see solver::Multigrid
+        StationaryRow stationary_row(const size_t x, const size_t y) const;
+
         virtual void set_current_value(const size_t x, const size_t y, const double value) override;
         double get_RHS_coefs_x(const size_t x, const size_t y) const override;
         double get_RHS_coefs_y(const size_t x, const size_t y) const override;
@@ -100,22 +255,75 @@ namespace model {
         boundary_coefs get_y_last_coefs(const size_t y) const override;
         boundary_coefs get_x_first_coefs(const size_t x) const override;
         boundary_coefs get_y_first_coefs(const size_t x) const override;
+        void fill_x_line(
+            const size_t y, const size_t first, const size_t last,
+            double * a, double * b, double * c, double * d, const size_t stride) const override;
+        void fill_y_line(
+            const size_t x, const size_t first, const size_t last,
+            double * a, double * b, double * c, double * d, const size_t stride) const override;
+        void fill_x_rhs(const size_t y, const size_t first, const size_t last, double * d, const size_t stride) const override;
+        void fill_y_rhs(const size_t x, const size_t first, const size_t last, double * d, const size_t stride) const override;
+        void scatter_x_line(const size_t y, const size_t first, const size_t last, const double * f, const size_t stride) override;
+        void scatter_y_line(const size_t x, const size_t first, const size_t last, const double * f, const size_t stride) override;
+        void fill_y_rhs_block(const size_t x_first, const size_t x_last, double * d, const size_t ld) const override;
+        void scatter_y_block(const size_t x_first, const size_t x_last, const double * f, const size_t ld) override;
+        void fill_y_rhs_tile(
+            const size_t y_first, const size_t y_last,
+            const size_t x_first, const size_t x_last, double * d, const size_t ld) const override;
+        // the bulk methods above for the lines of any precision
+        // (the double overrides forward to the double instances)
+        template <typename T>
+        void fill_x_line(const size_t y, const size_t first, const size_t last, T * a, T * b, T * c, T * d, const size_t stride) const;
+        template <typename T>
+        void fill_y_line(const size_t x, const size_t first, const size_t last, T * a, T * b, T * c, T * d, const size_t stride) const;
+        template <typename T>
+        void fill_x_rhs(const size_t y, const size_t first, const size_t last, T * d, const size_t stride) const;
+        template <typename T>
+        void fill_y_rhs(const size_t x, const size_t first, const size_t last, T * d, const size_t stride) const;
+        template <typename T>
+        void scatter_x_line(const size_t y, const size_t first, const size_t last, const T * f, const size_t stride);
+        template <typename T>
+        void scatter_y_line(const size_t x, const size_t first, const size_t last, const T * f, const size_t stride);
+        template <typename T>
+        void fill_y_rhs_block(const size_t x_first, const size_t x_last, T * d, const size_t ld) const;
+        template <typename T>
+        void scatter_y_block(const size_t x_first, const size_t x_last, const T * f, const size_t ld);
+        template <typename T>
+        void fill_y_rhs_tile(
+            const size_t y_first, const size_t y_last,
+            const size_t x_first, const size_t x_last, T * d, const size_t ld) const;
         size_t x_dim() const override { return dims.first; }
         size_t y_dim() const override { return dims.second; }
+        size_t revision() const override { return coefs_revision; }
+        void set_parameters(const double dt, const double dx, const double dy, const double a);
+        // changes the coefficients, thus bumps the revision as well
+        void set_scheme(const splitting s);
+        splitting scheme() const override { return time_splitting; }
+        void prepare_rhs(const direction d, const size_t y_first, const size_t y_last) override;
+        void restore_conditions(const size_t y_first, const size_t y_last) override;
+        // assigns the new values to the fixed nodes of the field right away,
+        // the coefficients (and the revision) stay as they are
+        void set_boundary_temperatures(const BoundaryTemperatures & t);
 
-        ~Model79() = default;
-        Model79() = delete;
-        Model79(
+        ~BasicModel79() = default;
+        BasicModel79() = delete;
+        BasicModel79(
             const double dt,
             const double dx,
             const double dy,
             const double a,
             const size_t x_nodes,
-            const size_t y_nodes) :
+            const size_t y_nodes,
+            const BoundaryTemperatures & t = {}) :
             dt(dt), dx(dx), dy(dy), a(a),
+            temperatures(t),
             dims(std::make_pair(x_nodes, y_nodes)),
             grid(x_nodes, y_nodes) { grid_set_up(); };
-
-        friend void pprint_grid(const Model79 & m, std::ostream & out);
     };
+
+    using Model79 = BasicModel79<double>;
+    using Model79f = BasicModel79<float>;
+
+    // prints the condition of every node
+    void pprint_grid(const Model79 & m, std::ostream & out);
 }
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <memory>
+
+#include "model.hpp"
+#include "batched.hpp"
+#include "pool.hpp"
+
+namespace solver {
+    // a V-cycle visits each coarse grid once, a W-cycle twice. Both cost
+    // O(N) per cycle; on this geometry the W-cycle reduces the residual
+    // ~30 times per cycle on any mesh, while the V-cycle slows down
+    // (x10 per cycle at 100x50, x4 at 2000x1000) as the coarse grids
+    // lose the detail of the boundaries
+    enum cycle_type {
+        V_CYCLE,
+        W_CYCLE
+    };
+
+    struct MultigridOptions {
+        cycle_type cycle = W_CYCLE;
+        // smoothing steps before and after the coarse grid correction,
+        // a step is a zebra sweep over the rows and then over the columns
+        size_t pre_smoothing = 1;
+        size_t post_smoothing = 1;
+        // the solve stops once the residual has dropped that many
+        // times below the one of the initial field
+        double tolerance = 1e-10;
+        size_t max_cycles = 100;
+        // the zebra colours are spread over that many threads
+        size_t n_threads = 1;
+    };
+
+    struct MultigridStats {
+        size_t cycles = 0;
+        // root mean square of the residual over the unknowns
+        double initial_residual = 0.0;
+        double residual = 0.0;
+        bool converged = false;
+        // average residual reduction per cycle
+        double convergence_factor() const;
+    };
+
+    // Multigrid solves the stationary problem of Model79 (see
+    // Model79::stationary_row) directly instead of marching in time.
+    // The grids are halved down to a few nodes across: a coarse node
+    // sits on every other fine node and corrections are interpolated
+    // bilinearly. Nodes with fixed values (1st type and outer ones) are
+    // no unknowns and the mask is restricted by injection: a coarse node
+    // is an unknown if the fine node it sits on is, so the hole and the
+    // inclined side are carried down to the coarse grids. The coarse operators are
+    // Galerkin products R A P (R = P^T) of the fine one, which keeps the
+    // 2nd and 3rd type conditions in force on every grid without
+    // rediscretizing them, at the price of 9-point stencils.
+    // The smoother is the zebra line Gauss-Seidel: the even rows are
+    // solved with TDMA for the values of the odd ones, then the odd rows,
+    // then the same for the columns; the line matrices never change, so
+    // they are factorized once. Every cycle costs O(N) and reduces the
+    // error by a factor independent of the mesh size
+    class Multigrid {
+    private:
+        struct Level {
+            size_t width = 0;
+            size_t height = 0;
+            // 3x3 stencil of every node, entry k is the coefficient of
+            // the node (x + k % 3 - 1, y + k / 3 - 1), laid out as the field
+            // (one array of stencils rather than nine arrays the sweeps
+            // would stream through at once)
+            std::vector<std::array<double, 9>> stencil;
+            // whether the node is an unknown (fixed value or correction otherwise)
+            std::vector<uint8_t> unknown;
+            diagonal u;
+            diagonal f;
+            diagonal r;
+            // factorized rows and columns (sub-diagonal, c^* and
+            // reciprocal pivots), laid out line after line
+            diagonal row_a;
+            diagonal row_c_star;
+            diagonal row_inv_pivot;
+            diagonal col_a;
+            diagonal col_c_star;
+            diagonal col_inv_pivot;
+            size_t index(const size_t x, const size_t y) const { return y * width + x; }
+            size_t size() const { return width * height; }
+        };
+    private:
+        model::Model79 & m;
+        const MultigridOptions opts;
+        std::vector<Level> levels;
+        // LU factorization of the coarsest operator, row-major
+        diagonal coarse_lu;
+        std::vector<size_t> coarse_pivots;
+        // per-thread scratch of the line solves
+        std::vector<diagonal> scratch;
+        std::unique_ptr<ThreadPool> pool;
+        // model revision the operators were built for
+        size_t built_revision = 0;
+    private:
+        static size_t parents(const Level & coarse, const size_t x, const size_t y, size_t index[4], double weight[4]);
+        void build();
+        void build_fine(Level & fine) const;
+        static void build_coarse(const Level & fine, Level & coarse);
+        static void factorize_lines(Level & l);
+        void factorize_coarsest();
+        // runs task(scratch, j) for j < count, spread over the threads
+        template <typename Task>
+        void for_each_task(const size_t count, const Task & task);
+        void smooth(Level & l, const size_t steps);
+        void solve_rows(Level & l, const size_t parity);
+        void solve_cols(Level & l, const size_t parity);
+        static void residual(Level & l);
+        static void restrict_residual(const Level & fine, Level & coarse);
+        static void prolongate(const Level & coarse, Level & fine);
+        void solve_coarsest(Level & l) const;
+        void cycle(const size_t depth);
+        double residual_norm();
+    public:
+        Multigrid(model::Model79 & model, const MultigridOptions & opts = {});
+        // solves the stationary problem starting from the current
+        // field of the model and stores the solution in the model
+        MultigridStats solve();
+        size_t n_levels() const { return levels.size(); }
+        size_t level_width(const size_t depth) const { return levels.at(depth).width; }
+        size_t level_height(const size_t depth) const { return levels.at(depth).height; }
+    };
+}
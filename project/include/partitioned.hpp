@@ -0,0 +1,111 @@
+#pragma once
+
+#include "batched.hpp"
+
+namespace solver {
+    // contiguous run of the equations [first, last) of a line
+    struct Segment {
+        size_t first;
+        size_t last;
+    };
+
+    // factorization of every line matrix: sub-diagonal, c^* and
+    // reciprocal pivots, laid out line after line
+    template <typename Real>
+    struct BasicFactorization {
+        basic_diagonal<Real> a;
+        basic_diagonal<Real> c_star;
+        basic_diagonal<Real> inv_pivot;
+    };
+
+    using Factorization = BasicFactorization<double>;
+
+    // active segments of every line, compiled once from the coefficients:
+    // line l owns segments[offsets[l] .. offsets[l + 1]). A segment is a
+    // run of the equations that are not pinned ({0, 1, 0}) together with
+    // the pinned equations bounding it, a pinned equation either bounds a
+    // segment or lies outside of all of them
+    struct Segments {
+        std::vector<Segment> segments;
+        std::vector<size_t> offsets;
+        const Segment * begin(const size_t line) const { return segments.data() + offsets[line]; }
+        const Segment * end(const size_t line) const { return segments.data() + offsets[line + 1]; }
+        // the equations from the first segment of the lines
+        // [first_line, last_line) to the last one of any of them
+        Segment hull(const size_t first_line, const size_t last_line) const;
+        // appends the segments of the next line, the n equations of mx
+        // (instantiated for double and float in partitioned.cpp)
+        template <typename Real>
+        void add_line(const basic_tridiagonal_mx<Real> & mx, const size_t n);
+    };
+
+    // PartitionedTDMA solves a single long system with several threads
+    // and SIMD lanes (a SPIKE-like partitioned Thomas algorithm). The
+    // system is cut into groups * width partitions; the last equation of
+    // every partition but the last one is a separator. The interiors
+    // (the rest of the partitions) are eliminated independently, width of
+    // them at once in the lanes of a BatchedTDMA, which leaves every
+    // interior as y + p * S_above + q * S_below; the separators then make
+    // up a reduced tridiagonal system of groups * width - 1 equations.
+    // A solve is three phases: eliminate() of every group (one thread
+    // per group), reduce() on a single thread, substitute() of every
+    // group. The matrix is factorized (and p, q computed) once by the
+    // constructor, the phases only sweep the RHS. The result equals the
+    // one of TDMA up to the rounding; a single partition (groups = width
+    // = 1) is TDMA::solve_factorized() exactly.
+    // Instantiated for double and float in partitioned.cpp
+    template <typename Real>
+    class BasicPartitionedTDMA {
+    private:
+        // partitions [first, first + width), interleaved by lanes:
+        // row i of the lane l at [i * width + l], the interiors shorter
+        // than length are padded with identity equations
+        struct Group {
+            size_t first = 0;
+            size_t length = 0;
+            basic_diagonal<Real> a;
+            basic_diagonal<Real> c_star;
+            basic_diagonal<Real> inv_pivot;
+            basic_diagonal<Real> p;
+            basic_diagonal<Real> q;
+            basic_diagonal<Real> y;
+            BasicBatchedTDMA<Real> batched;
+        };
+    private:
+        size_t width = 1;
+        // partition k is [bounds[k], bounds[k + 1])
+        std::vector<size_t> bounds;
+        std::vector<Group> parts;
+        // couplings of the separators to the interiors
+        // and the factorized reduced system
+        basic_diagonal<Real> separator_a;
+        basic_diagonal<Real> separator_c;
+        basic_diagonal<Real> reduced_a;
+        basic_diagonal<Real> reduced_c_star;
+        basic_diagonal<Real> reduced_inv_pivot;
+        basic_diagonal<Real> separators;
+    private:
+        size_t n_partitions() const { return bounds.size() - 1; }
+        // interior equations of the partition k
+        Segment interior(const size_t k) const;
+        const Real & at(const basic_diagonal<Real> Group::* field, const size_t k, const size_t i) const;
+    public:
+        BasicPartitionedTDMA() = default;
+        // factorizes the N equations at a, b & c, the system must have
+        // 2 equations per partition at least (if there are several)
+        BasicPartitionedTDMA(
+            const size_t N, const Real * a, const Real * b, const Real * c,
+            const size_t groups, const size_t width);
+        size_t groups() const { return parts.size(); }
+        // equations of the system the group g reads and writes
+        Segment span(const size_t g) const;
+        // the phases of a solve for the RHS d, the solution goes to
+        // x. eliminate() and substitute() of different groups may run
+        // concurrently, d and x are the whole system
+        void eliminate(const size_t g, const Real * d);
+        void reduce(const Real * d);
+        void substitute(const size_t g, Real * x) const;
+    };
+
+    using PartitionedTDMA = BasicPartitionedTDMA<double>;
+}
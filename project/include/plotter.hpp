@@ -1,15 +1,84 @@
 #pragma once
 
 #include <cctype>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
-#include "shared.hpp"
+#include "format.hpp"
 
 namespace plt {
-    class GNUPlotWriter {
+    // what the asynchronous writer does with a new frame
+    // when all of its snapshot buffers are still queued
+    enum backpressure {
+        BLOCK_ON_FULL,
+        DROP_ON_FULL
+    };
+
+    // FrameWriter is a sink of the frames of a run. submit() writes a frame
+    // right away or, in the async mode, copies the field into one of
+    // n_buffers snapshots (allocated once, at the first frame) and returns,
+    // a dedicated thread writes the queued frames. The implementations only
+    // provide write_frame(). A frame the thread fails to write stops it, the
+    // error is rethrown by every submit(), drain() and stop() from then on
+    class FrameWriter {
+    public:
+        FrameWriter(const FrameWriter &) = delete;
+        FrameWriter & operator=(const FrameWriter &) = delete;
+        virtual ~FrameWriter();
+        // writes or queues a field of rows of width values.
+        // Returns false if the frame has been dropped
+        bool submit(util::strided_span<const double> field, const size_t width);
+        // blocks until every queued frame is written
+        void drain();
+        size_t dropped_frames() const { return dropped; }
+    protected:
+        FrameWriter() = default;
+        FrameWriter(const size_t n_buffers, const backpressure policy);
+        bool asynchronous() const { return async; }
+        // writes the frames queued so far and joins the writer thread,
+        // the destructors of the implementations call it first (and
+        // drop the error of the writer, submit() or drain() reports it)
+        void stop();
+        virtual void write_frame(util::strided_span<const double> field, const size_t width) = 0;
+    private:
+        // a copy of the field waiting to be written
+        struct Snapshot {
+            std::vector<double> values;
+            size_t width = 0;
+        };
+    private:
+        // async mode state: snapshots form a ring, frames
+        // [written, submitted) are queued for the writer
+        const bool async = false;
+        const backpressure policy = BLOCK_ON_FULL;
+        std::vector<Snapshot> snapshots;
+        size_t submitted = 0;
+        size_t written = 0;
+        size_t dropped = 0;
+        bool stopped = false;
+        std::exception_ptr error;
+        std::mutex lock;
+        std::condition_variable queued;
+        std::condition_variable freed;
+        std::thread writer;
+    private:
+        void writer_loop();
+        void rethrow_error() const;
+    };
+
+    // pipes the frames to a gnuplot subprocess as matrix text
+    class GNUPlotWriter final : public FrameWriter {
     public:
-        GNUPlotWriter(const std::string & config);
-        ~GNUPlotWriter();
+        GNUPlotWriter(const std::string & config, const NumberFormat & fmt = {});
+        // asynchronous writer, the queued frames are formatted on its thread
+        GNUPlotWriter(
+            const std::string & config, const size_t n_buffers, const backpressure policy,
+            const NumberFormat & fmt = {});
+        ~GNUPlotWriter() override;
+        // synchronous interface, not available in the async mode
         std::ostream & reciever() { return payload_buffer; }
         void flush_buffer();
         constexpr static std::string_view basic_gif_config = 
@@ -36,9 +105,12 @@ namespace plt {
     private:
         FILE * pipe = nullptr;
         std::stringstream payload_buffer;
+        // frames are formatted here by submit(), or by the writer thread in the async mode
+        FieldFormatter frame_text;
         // explicitly prohibit writing anything to the terminal
         constexpr static std::string_view command = "gnuplot 2> /dev/null";
     private:
         void throw_on_bad_pipe();
+        void write_frame(util::strided_span<const double> field, const size_t width) override;
     };
 }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "shared.hpp"
+
+namespace solver {
+    // ThreadPool keeps its workers alive for the whole run
+    // so that no threads are spawned per step. The only operation
+    // is run(): every thread of the pool (the calling thread
+    // included, it is the thread 0) executes the job once, and
+    // the call returns after all of them are done, thus
+    // run() doubles as a barrier
+    class ThreadPool {
+    public:
+        using job = std::function<void(const size_t thread_id)>;
+    private:
+        std::vector<std::thread> workers;
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable done;
+        const job * current_job = nullptr;
+        size_t generation = 0;
+        size_t pending = 0;
+        bool stopped = false;
+        std::exception_ptr error;
+    private:
+        void worker_loop(const size_t thread_id);
+        void execute(const size_t thread_id);
+    public:
+        ThreadPool() = delete;
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool & operator=(const ThreadPool &) = delete;
+        ThreadPool(const size_t n_threads);
+        ~ThreadPool();
+        void run(const job & j);
+        size_t size() const { return workers.size() + 1; }
+    };
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+#include "model.hpp"
+
+namespace io {
+    enum probe_shape {
+        PROBE_POINT,
+        PROBE_LINE,
+        PROBE_RECTANGLE
+    };
+
+    // probe in the physical coordinates of the plate: x along the rows,
+    // y along the columns, the node (i, j) is at (i * dx, j * dy), so that
+    // y grows from the ceiling (the row 0) to the floor
+    struct ProbeSpec {
+        std::string name;
+        probe_shape shape = PROBE_POINT;
+        double x0 = 0.0;
+        double y0 = 0.0;
+        // the other end of a line, the opposite corner of a rectangle
+        double x1 = 0.0;
+        double y1 = 0.0;
+        // points along a line, both ends included (0 for one per mesh step)
+        size_t samples = 0;
+    };
+
+    // reads the probes of a file, one per line ('#' starts a comment):
+    //   point <name> <x> <y>
+    //   line <name> <x0> <y0> <x1> <y1> [<samples>]
+    //   rect <name> <x0> <y0> <x1> <y1>
+    // (a line takes 1 to 2^20 samples), anything after a probe is an error
+    std::vector<ProbeSpec> read_probes(const std::string & path);
+
+    // ProbeSet resolves the probes to the nodes of the mesh once, a sample
+    // of the field is then O(probes). Every probe gives one or more
+    // channels: a point one (interpolated bilinearly between the nodes
+    // around it), a line one per point along it, a rectangle the mean, the
+    // smallest and the largest value of the nodes inside. The outer nodes
+    // are left out of the interpolation; a point surrounded by them only
+    // (in the hole, past the inclined side) reads as NaN. A probe outside
+    // the mesh or a rectangle with no nodes is an error
+    class ProbeSet {
+    private:
+        enum reduction {
+            WEIGHTED_SUM,
+            MINIMUM,
+            MAXIMUM
+        };
+        struct Tap {
+            size_t index;
+            double weight;
+        };
+        // channel c reduces the taps [first, last)
+        struct Channel {
+            reduction op;
+            size_t first;
+            size_t last;
+        };
+    private:
+        size_t n_nodes = 0;
+        std::vector<std::string> channel_names;
+        std::vector<Channel> channels;
+        std::vector<Tap> taps;
+    private:
+        void add_point(const std::string & name, const double fx, const double fy,
+            const size_t width, const size_t height, util::strided_span<const model::condition> mask);
+        template <typename T>
+        void sample_values(util::strided_span<const T> field, double * out) const;
+    public:
+        ProbeSet(
+            const std::vector<ProbeSpec> & specs,
+            const size_t width, const size_t height,
+            const model::Parameters & parameters,
+            util::strided_span<const model::condition> mask);
+        size_t size() const { return channels.size(); }
+        // "name" of a point, "name[k]" of the points of a line,
+        // "name.mean", "name.min" and "name.max" of a rectangle
+        const std::vector<std::string> & names() const { return channel_names; }
+        // writes size() values of the field (of either precision) to out
+        void sample(util::strided_span<const double> field, double * out) const;
+        void sample(util::strided_span<const float> field, double * out) const;
+    };
+
+    // ProbeWriter appends a sample of the probes after a step to a time
+    // series: CSV (*.csv: a header of "step,time" and the channel names,
+    // a row per sample) or binary:
+    //
+    //   [magic "FDMPROB1"][uint32 version][uint32 byte order mark]
+    //   [uint64 channels][uint64 bytes of names][names, '\0'-terminated, padded to 8]
+    //   [uint64 step][double time][channels doubles]   <- a record per sample
+    //
+    // in the native byte order; the records follow until the end of the file
+    class ProbeWriter {
+    private:
+        const ProbeSet probes;
+        const bool csv;
+        FILE * file = nullptr;
+        std::vector<double> values;
+        std::vector<char> line;
+        size_t n_samples = 0;
+    private:
+        void write_header();
+        void write_sample(const size_t step, const double time);
+    public:
+        ProbeWriter(const std::string & path, const ProbeSet & probes);
+        ~ProbeWriter();
+        ProbeWriter(const ProbeWriter &) = delete;
+        ProbeWriter & operator=(const ProbeWriter &) = delete;
+        void append(const size_t step, const double time, util::strided_span<const double> field);
+        void append(const size_t step, const double time, util::strided_span<const float> field);
+        size_t samples() const { return n_samples; }
+        // hands the buffered records over to the system
+        void flush();
+    };
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+
+#include "shared.hpp"
+
+// Hot-path instrumentation. The solver, the plotter and the snapshot
+// store time their phases with PROF_SCOPE() and bump counters with
+// PROF_COUNT(). Both macros expand to nothing unless the project is
+// configured with -DFDM_PROFILE=ON, so a regular build pays nothing.
+// Every thread accumulates into its own slot (no atomics, no locks
+// on the hot path), the slots are summed up by report()
+namespace prof {
+    enum phase {
+        STEP,
+        FACTORIZE,
+        ASSEMBLE_X,
+        ASSEMBLE_Y,
+        SOLVE_X,
+        SOLVE_Y,
+        SCATTER_X,
+        SCATTER_Y,
+        FORMAT,
+        PIPE,
+        RENDER,
+        ENCODE,
+        SNAPSHOT,
+        SMOOTH,
+        TRANSFER,
+        COARSE_SOLVE,
+        EXCHANGE,
+        N_PHASES
+    };
+
+    enum counter {
+        STEPS,
+        LINES_SOLVED,
+        EQUATIONS_SOLVED,
+        NODES_UPDATED,
+        FRAMES_WRITTEN,
+        FRAMES_DROPPED,
+        BYTES_WRITTEN,
+        CYCLES,
+        N_COUNTERS
+    };
+
+    // whether the instrumentation has been compiled in
+    bool enabled();
+    // summary of all threads as a table (with a row per
+    // thread for each phase if per_thread is set) or as JSON
+    void report(std::ostream & os, const bool per_thread = false);
+    void report_json(std::ostream & os);
+
+#ifdef FDM_PROFILE
+    struct ThreadStats {
+        uint64_t ns[N_PHASES] = {};
+        uint64_t calls[N_PHASES] = {};
+        uint64_t counters[N_COUNTERS] = {};
+    };
+
+    ThreadStats & register_thread();
+    inline thread_local ThreadStats * slot = nullptr;
+    // slot of the calling thread, registered at the first use
+    inline ThreadStats & local() { return slot != nullptr ? *slot : register_thread(); }
+
+    class ScopedTimer {
+    private:
+        const phase p;
+        const std::chrono::steady_clock::time_point start;
+    public:
+        explicit ScopedTimer(const phase p): p(p), start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            ThreadStats & s = local();
+            s.ns[p] += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            ++s.calls[p];
+        }
+    };
+#endif
+}
+
+#ifdef FDM_PROFILE
+#define PROF_CONCAT_IMPL(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT_IMPL(a, b)
+#define PROF_SCOPE(p) const ::prof::ScopedTimer PROF_CONCAT(prof_timer_, __LINE__)(::prof::p)
+#define PROF_COUNT(c, n) (::prof::local().counters[::prof::c] += (n))
+#else
+#define PROF_SCOPE(p) ((void) 0)
+#define PROF_COUNT(c, n) ((void) 0)
+#endif
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include "plotter.hpp"
+
+// Native renderer: the field is mapped through a palette into an indexed
+// framebuffer, which is encoded as an animated GIF (LZW) or a PNG still
+// (stored deflate blocks) without any external tool or library
+namespace plt {
+    struct Color {
+        uint8_t r;
+        uint8_t g;
+        uint8_t b;
+    };
+
+    constexpr size_t PALETTE_SIZE = 256;
+    using Palette = std::array<Color, PALETTE_SIZE>;
+
+    // gnuplot's "set palette color" (rgbformulae 7, 5, 15),
+    // the low end is black and the high end yellow
+    Palette default_palette();
+
+    // values spread over the palette, the ones outside are clamped
+    struct ColorRange {
+        double min = 0.0;
+        double max = 0.0;
+        bool empty() const { return not (min < max); }
+    };
+
+    // smallest and largest value of the field, widened if it is uniform
+    ColorRange value_range(util::strided_span<const double> field);
+
+    // one palette index per pixel, rows top to bottom
+    struct Framebuffer {
+        size_t width = 0;
+        size_t height = 0;
+        std::vector<uint8_t> pixels;
+    };
+
+    // maps the field (rows of width values, the row 0 on top) into the
+    // framebuffer, every node becomes a square of scale x scale pixels
+    void rasterize(
+        util::strided_span<const double> field, const size_t width,
+        const ColorRange & range, const size_t scale, Framebuffer & out);
+
+    // GifEncoder writes a looped GIF89a animation of frames of the same
+    // size with a global color table. Every frame is LZW-compressed and
+    // written by append(), the file is complete once the encoder is closed
+    class GifEncoder {
+    private:
+        FILE * file = nullptr;
+        const Palette palette;
+        const unsigned delay;
+        size_t width = 0;
+        size_t height = 0;
+        // LZW string table: (prefix code << 8 | next index) keys
+        // with open addressing, the codes of the empty slots are -1
+        std::vector<uint32_t> keys;
+        std::vector<int16_t> codes;
+        // packed code stream of a frame
+        std::vector<uint8_t> stream;
+    private:
+        void write_header();
+        void compress(const std::vector<uint8_t> & pixels);
+    public:
+        // delay between the frames in 1/100 s
+        GifEncoder(const std::string & path, const Palette & palette, const unsigned delay);
+        GifEncoder(const GifEncoder &) = delete;
+        GifEncoder & operator=(const GifEncoder &) = delete;
+        ~GifEncoder();
+        // the first frame sets the size of the animation,
+        // returns the number of bytes written
+        size_t append(const Framebuffer & frame);
+        // writes the trailer and closes the file
+        void close();
+    };
+
+    // writes the frame as an 8-bit indexed PNG; the image data goes
+    // uncompressed into stored deflate blocks, so no zlib is needed.
+    // Returns the size of the file
+    size_t write_png(const std::string & path, const Framebuffer & frame, const Palette & palette);
+
+    // formats of the ImageWriter, chosen by the extension of the path
+    enum image_format {
+        GIF_ANIMATION,
+        PNG_STILL
+    };
+
+    struct ImageOptions {
+        // pixels per node along each axis, 0 to fit the
+        // larger side of the mesh into about 800 pixels
+        size_t scale = 0;
+        // values spread over the palette, the range of the
+        // first frame if empty (and for the rest of the run)
+        ColorRange range;
+        // between the GIF frames, 1/100 s
+        unsigned delay = 2;
+    };
+
+    // renders the frames natively: into an animated GIF (*.gif) or
+    // into a PNG (*.png), which every frame overwrites
+    class ImageWriter final : public FrameWriter {
+    private:
+        const std::string path;
+        const image_format format;
+        const ImageOptions opts;
+        const Palette palette;
+        ColorRange range;
+        // frames are rendered and encoded by submit(), or by the writer thread in the async mode
+        Framebuffer frame;
+        std::unique_ptr<GifEncoder> gif;
+    private:
+        void write_frame(util::strided_span<const double> field, const size_t width) override;
+    public:
+        ImageWriter(const std::string & path, const ImageOptions & opts = {});
+        // asynchronous writer, the queued frames are encoded on its thread
+        ImageWriter(
+            const std::string & path, const size_t n_buffers, const backpressure policy,
+            const ImageOptions & opts = {});
+        ~ImageWriter() override;
+    };
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+
+#include "shared.hpp"
+
+namespace io {
+    // criteria of OutputScheduler, a frame is due as soon as
+    // any of the enabled ones is met (zero disables a criterion).
+    // With none of them enabled every frame is due
+    struct ScheduleOptions {
+        // every n-th timestep
+        size_t every_steps = 0;
+        // every that much of the simulated time
+        double every_time = 0.0;
+        // every that much of the wall-clock time, in seconds
+        double every_seconds = 0.0;
+        // once some node has changed by more than that
+        // since the last frame emitted
+        double change_threshold = 0.0;
+    };
+
+    // OutputScheduler sits between the Problem and the output sinks
+    // (plotter, snapshot store, ...): it is offered the field after
+    // every step and only passes the due frames on to the sinks
+    class OutputScheduler {
+    public:
+        using sink = std::function<void(const size_t step, const double time, util::strided_span<const double> field)>;
+        using clock = std::chrono::steady_clock;
+    private:
+        const ScheduleOptions opts;
+        std::vector<sink> sinks;
+        size_t emitted_frames = 0;
+        bool any_emitted = false;
+        size_t last_step = 0;
+        double next_time = 0.0;
+        clock::time_point last_wall;
+        // copy of the last emitted field, kept for change_threshold only
+        std::vector<double> reference;
+    private:
+        bool due(const size_t step, const double time, util::strided_span<const double> field) const;
+        void emit(const size_t step, const double time, util::strided_span<const double> field);
+    public:
+        OutputScheduler(const ScheduleOptions & opts = {});
+        void add_sink(sink s) { sinks.push_back(std::move(s)); }
+        // emits the frame if it is due, returns whether it was
+        bool offer(const size_t step, const double time, util::strided_span<const double> field);
+        // emits the frame unless this step has been emitted already,
+        // meant for the first and the last frames of a run
+        bool force(const size_t step, const double time, util::strided_span<const double> field);
+        // counts the frame as emitted without passing it to the sinks,
+        // the intervals start from it
+        void mark(const size_t step, const double time, util::strided_span<const double> field);
+        size_t emitted() const { return emitted_frames; }
+    };
+
+    // prints "\r<prefix>iter [i/total]" (or "iter [i]" for total = 0,
+    // when the number of steps is not known) at most once per interval
+    // of the wall-clock time instead of at every step
+    class ProgressPrinter {
+    private:
+        std::ostream & os;
+        const std::string prefix;
+        const size_t total;
+        const std::chrono::duration<double> interval;
+        OutputScheduler::clock::time_point last_print;
+        bool printed = false;
+    private:
+        void print(const size_t iter);
+    public:
+        ProgressPrinter(std::ostream & os, const std::string & prefix, const size_t total, const double interval_seconds = 0.1);
+        void update(const size_t iter);
+        // prints the final state regardless of the interval
+        void finish(const size_t iter);
+    };
+}
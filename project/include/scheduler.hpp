@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "pool.hpp"
+
+namespace solver {
+    // TaskGraph is a DAG of the tasks 0 .. size() - 1: a task may only
+    // start once all of its predecessors are done. It is built once
+    // and run by a TaskScheduler any number of times
+    class TaskGraph {
+    private:
+        std::vector<std::vector<size_t>> successors;
+        std::vector<size_t> n_predecessors;
+    public:
+        // returns the id of the new task
+        size_t add_task();
+        // the task after waits for the task before
+        void add_dependency(const size_t before, const size_t after);
+        size_t size() const { return successors.size(); }
+        const std::vector<size_t> & successors_of(const size_t task) const { return successors[task]; }
+        size_t predecessors_of(const size_t task) const { return n_predecessors[task]; }
+    };
+
+    // TaskScheduler runs the tasks of a graph over the threads of a pool.
+    // Every thread keeps a deque of the tasks that are ready to run: it
+    // takes the newest one of its own (the successors the task it has just
+    // finished made ready, with their data still in its cache) and, once
+    // it runs out, steals the oldest one of another thread. The tasks ready
+    // from the start are dealt round robin, each thread takes the ones
+    // of the lowest ids first. A thread that finds no task spins for a
+    // while and then sleeps until it is woken for a task or the run is over
+    class TaskScheduler {
+    public:
+        using task = std::function<void(const size_t thread_id, const size_t task)>;
+    private:
+        struct Queue {
+            std::mutex lock;
+            std::deque<size_t> tasks;
+        };
+        const size_t n_threads;
+        std::unique_ptr<Queue[]> queues;
+        // predecessors of every task yet to finish
+        std::unique_ptr<std::atomic<size_t>[]> pending;
+        size_t capacity = 0;
+        std::atomic<size_t> remaining{0};
+        std::atomic<bool> failed{false};
+        // tasks in the deques and the threads asleep waiting for them
+        std::atomic<size_t> queued{0};
+        std::atomic<size_t> sleeping{0};
+        std::mutex park_lock;
+        std::condition_variable ready;
+    private:
+        bool pop(const size_t thread_id, size_t & task);
+        void push(const size_t thread_id, const size_t task);
+        // wakes up to n sleepers
+        void wake(const size_t n);
+        // sleeps until a task is queued or the run is over
+        void park();
+        void wake_all();
+        void work(const TaskGraph & graph, const size_t thread_id, const task & t);
+    public:
+        TaskScheduler(const size_t n_threads);
+        TaskScheduler(const TaskScheduler &) = delete;
+        TaskScheduler & operator=(const TaskScheduler &) = delete;
+        // runs every task of the graph and returns once all of them are
+        // done, on the calling thread alone if there is no pool (which must
+        // have the threads the scheduler was made for otherwise). The first
+        // exception thrown by a task stops the run and is rethrown
+        void run(const TaskGraph & graph, ThreadPool * pool, const task & t);
+    };
+}
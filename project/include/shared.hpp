@@ -2,4 +2,87 @@
 
 #include <vector>
 #include <array>
+#include <string>
+#include <ostream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <iterator>
+#include <cstddef>
+#include <type_traits>
 
+namespace util {
+    // allocator for std::vector which places the storage
+    // at Alignment boundary (cache line by default) so that
+    // the rows of the field start at a predictable offset
+    template <typename T, size_t Alignment = 64>
+    struct aligned_allocator {
+        using value_type = T;
+        template <typename U>
+        struct rebind { using other = aligned_allocator<U, Alignment>; };
+
+        aligned_allocator() = default;
+        template <typename U>
+        aligned_allocator(const aligned_allocator<U, Alignment> &) {}
+
+        T * allocate(const size_t n) {
+            // aligned_alloc requires the size to be a multiple of the alignment
+            const size_t bytes = (n * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+            void * p = std::aligned_alloc(Alignment, bytes);
+            if (p == nullptr) throw std::bad_alloc();
+            return static_cast<T *>(p);
+        }
+        void deallocate(T * p, const size_t) { std::free(p); }
+
+        template <typename U>
+        bool operator==(const aligned_allocator<U, Alignment> &) const { return true; }
+        template <typename U>
+        bool operator!=(const aligned_allocator<U, Alignment> &) const { return false; }
+    };
+
+    template <typename T>
+    using aligned_vector = std::vector<T, aligned_allocator<T>>;
+
+    // non-owning view of size elements placed stride elements apart,
+    // a row of the row-major field has stride 1, a column has stride width
+    template <typename T>
+    class strided_span {
+    private:
+        T * ptr = nullptr;
+        size_t length = 0;
+        size_t step = 1;
+    public:
+        class iterator {
+        private:
+            T * ptr;
+            size_t step;
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::remove_cv_t<T>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T *;
+            using reference = T &;
+            iterator(T * ptr, const size_t step): ptr(ptr), step(step) {}
+            T & operator*() const { return *ptr; }
+            iterator & operator++() { ptr += step; return *this; }
+            iterator operator++(int) { iterator prev = *this; ptr += step; return prev; }
+            bool operator==(const iterator & other) const { return ptr == other.ptr; }
+            bool operator!=(const iterator & other) const { return ptr != other.ptr; }
+        };
+    public:
+        strided_span() = default;
+        strided_span(T * ptr, const size_t length, const size_t stride = 1):
+            ptr(ptr), length(length), step(stride) {}
+        // spans of mutable data decay into read-only ones
+        template <typename U, typename = std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>>>
+        strided_span(const strided_span<U> & other):
+            ptr(other.data()), length(other.size()), step(other.stride()) {}
+        T & operator[](const size_t i) const { return ptr[i * step]; }
+        T * data() const { return ptr; }
+        size_t size() const { return length; }
+        size_t stride() const { return step; }
+        iterator begin() const { return iterator(ptr, step); }
+        iterator end() const { return iterator(ptr + length * step, step); }
+    };
+}
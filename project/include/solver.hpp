@@ -1,48 +1,243 @@
 #pragma once
 
+#include <memory>
+#include <type_traits>
+
 #include "model.hpp"
+#include "batched.hpp"
+#include "partitioned.hpp"
+#include "pool.hpp"
+#include "scheduler.hpp"
 
 namespace solver {
-    using diagonal = std::vector<double>;
-    using tridiagonal_mx_extended = std::array<diagonal, 4>;
 
     // TDMA stands for tridiagonal matrix algorithm
     // aka Thomas algorithm in en literature
     // this one can solve sets of linear equations (SLEs)
-    // with tridiagonal matrix in linear time
-    class TDMA {
+    // with tridiagonal matrix in linear time.
+    // Real is the precision of the elimination, instantiated
+    // for double and float in solver.cpp
+    template <typename Real>
+    class BasicTDMA {
     private:
-        diagonal c_star;
-        diagonal d_star;
+        basic_diagonal<Real> c_star;
+        basic_diagonal<Real> d_star;
     private:
     public:
-        TDMA() = default;
-        TDMA(const size_t diagonal_length);
-        ~TDMA() = default;
-        void solve(const tridiagonal_mx_extended & newSLE, diagonal & storage);
+        BasicTDMA() = default;
+        BasicTDMA(const size_t diagonal_length);
+        ~BasicTDMA() = default;
+        void solve(const basic_tridiagonal_mx<Real> & newSLE, basic_diagonal<Real> & storage);
+        // solves the N equations starting at a, b, c & d in place of the
+        // diagonals, N must not exceed the length the solver was made for
+        void solve(
+            const size_t N, const Real * a, const Real * b, const Real * c, const Real * d,
+            Real * storage);
+        // the forward sweep consists of the matrix part (c^* and the pivots),
+        // which only depends on a, b & c, and the RHS part. factorize()
+        // performs the former once, solve_factorized() does the rest for
+        // any RHS with exactly the same arithmetic as solve()
+        static void factorize(const basic_tridiagonal_mx<Real> & SLE, Real * c_star, Real * inv_pivot);
+        static void solve_factorized(
+            const size_t N, const Real * a, const Real * c_star, const Real * inv_pivot,
+            const Real * d, Real * storage);
+        // strided variants of the two above: the i-th RHS is read from d[i]
+        // and the i-th unknown written to x[i] whatever the strides are,
+        // so a row (stride 1) or a column (stride of a row) of the field is
+        // solved right where it is stored. d[i] is read before x[i] is
+        // written, d and x may be the same span (the RHS is solved in place);
+        // the length of the system is the one of x
+        void solve(
+            const Real * a, const Real * b, const Real * c,
+            util::strided_span<const Real> d, util::strided_span<Real> x);
+        static void solve_factorized(
+            const Real * a, const Real * c_star, const Real * inv_pivot,
+            util::strided_span<const Real> d, util::strided_span<Real> x);
+    };
+
+    using TDMA = BasicTDMA<double>;
+
+    // defines how the 1D subproblems of each half-step are solved:
+    // one row (column) at a time or in interleaved batches of
+    // BatchedTDMA::native_width() rows (columns)
+    enum sweep_mode {
+        LINE_BY_LINE,
+        BATCHED
+    };
+
+    // whether a sweep solves each line on a single thread or splits
+    // the long lines into partitions spread over the threads and the
+    // SIMD lanes (see PartitionedTDMA). SPLIT_AUTO splits a sweep if its
+    // lines are too few to keep every lane of every thread busy and
+    // long enough to be worth the extra passes (see solver.cpp)
+    enum line_split {
+        SPLIT_AUTO,
+        SPLIT_NEVER,
+        SPLIT_ALWAYS
+    };
+
+    // knobs of the Problem execution: sweep mode
+    // and the number of threads rows (columns) are spread over
+    // (results do not depend on n_threads). prefactorize makes
+    // the Problem factorize the (time-invariant) matrices once
+    // and only run the RHS sweeps at each step. transpose_y makes
+    // the LINE_BY_LINE mode solve the columns on tile-transposed copies
+    // of the field instead of walking it with a stride of a row
+    // (implies prefactorize; BATCHED mode reads the columns in
+    // contiguous groups anyway and ignores it). split applies to
+    // both modes; the split sweeps keep factorizations of their own.
+    // wavefront makes the LINE_BY_LINE mode pipeline the sweeps over
+    // tiles of the field (see BasicProblem::step_wavefront(); implies
+    // prefactorize, ignored by the BATCHED mode); the steps it cannot
+    // take (the ADI splitting, split sweeps, a field of another
+    // precision than the elimination) are taken in the two passes
+    struct ProblemOptions {
+        sweep_mode mode = LINE_BY_LINE;
+        size_t n_threads = 1;
+        bool prefactorize = false;
+        bool transpose_y = false;
+        line_split split = SPLIT_AUTO;
+        bool wavefront = false;
     };
 
     // Problem entity wraps everything, i.e. the model and solvers
     // (also allocates some auxiliary storage once for the run)
     // problem is solved in an iterative manner, with grid's current
-    // values updated at each step
-    class Problem {
+    // values updated at each step.
+    // Model is either model::IModel (works with any model via virtual calls)
+    // or a concrete final model class, so that the calls are resolved
+    // at compile time; both are instantiated in solver.cpp.
+    // Real is the precision the lines are eliminated in, independent of
+    // the one the model stores its field in: Model79f with double
+    // elimination is the mixed mode (half the memory traffic of the
+    // field, same arithmetic as the double run), Model79f with float
+    // elimination also doubles the SIMD width of the BATCHED mode.
+    // See bench/bench.cpp (precision suite) for their accuracy.
+    // The lines are only solved over their active segments: runs of the
+    // equations that are not pinned (see model::IModel) together with the
+    // pinned equations bounding them. A pinned equation decouples the
+    // line, so the segments are independent systems and their solutions
+    // are the same, bit by bit, as the ones of the whole line; the pinned
+    // nodes in between (the outer region and the hole of Model79) are
+    // neither assembled, solved nor stored
+    template <typename Model, typename Real = double>
+    class BasicProblem {
+    private:
+        // everything a thread needs to solve its rows (columns)
+        // independently of the others, one instance per thread
+        using diagonal = basic_diagonal<Real>;
+        using tridiagonal_mx_extended = basic_tridiagonal_mx<Real>;
+        struct Workspace {
+            BasicTDMA<Real> solver_x;
+            BasicTDMA<Real> solver_y;
+            tridiagonal_mx_extended mx_x;
+            tridiagonal_mx_extended mx_y;
+            // RHS and solution of a line of the field stored in another
+            // precision (see IN_PLACE) and of the split sweeps
+            diagonal f_x;
+            diagonal f_y;
+            // interleaved storage for the BATCHED mode,
+            // left empty otherwise
+            BasicBatchedTDMA<Real> batched_x;
+            BasicBatchedTDMA<Real> batched_y;
+            tridiagonal_mx_extended bmx_x;
+            tridiagonal_mx_extended bmx_y;
+            diagonal bf_x;
+            diagonal bf_y;
+            // column-major scratch of the transposed y-sweep
+            util::aligned_vector<Real> tile;
+            Workspace(const size_t x_dim, const size_t y_dim, const ProblemOptions & opts);
+        };
+        // factorization of every row (column) matrix, interleaved by
+        // batches in the BATCHED mode; the columns are laid out
+        // row-major for the tiles of the wavefront
+        using Factorization = BasicFactorization<Real>;
+        // the LINE_BY_LINE sweeps assemble the RHS of a line right into the
+        // field and solve it in place there (see model::IModel::row()) if it
+        // is stored in the precision of the elimination; the lines of a
+        // field of another precision go through f_x (f_y) and are scattered
+        static constexpr bool IN_PLACE = std::is_same_v<typename Model::value_type, Real>;
     private:
         size_t current_step = 0;
         const size_t n_iters = 0;
-        model::IModel & m;
-        TDMA solver_x;
-        TDMA solver_y;
-        tridiagonal_mx_extended mx_x;
-        tridiagonal_mx_extended mx_y;
-        diagonal f_x;
-        diagonal f_y;
+        const ProblemOptions opts;
+        Model & m;
+        std::vector<Workspace> workspaces;
+        std::unique_ptr<ThreadPool> pool;
+        Factorization factors_x;
+        Factorization factors_y;
+        Segments segments_x;
+        Segments segments_y;
+        // model revision the factorizations were made for
+        size_t factorized_revision = 0;
+        // split sweeps: one solver per segment (indexed as
+        // Segments::segments), empty if the sweep is not split
+        bool split_x = false;
+        bool split_y = false;
+        std::vector<BasicPartitionedTDMA<Real>> partitions_x;
+        std::vector<BasicPartitionedTDMA<Real>> partitions_y;
+        size_t partitioned_revision = 0;
+        // wavefront engine: the bands of rows and the blocks of columns
+        // the field is tiled into and the graph of the tasks over the
+        // tiles (see build_wavefront()), empty unless opts.wavefront
+        std::vector<Segment> bands;
+        std::vector<Segment> blocks;
+        TaskGraph wavefront;
+        std::unique_ptr<TaskScheduler> scheduler;
     private:
-        void update_grid_row(const size_t y);
-        void update_grid_col(const size_t x);
+        // splits n lines into per-thread chunks (multiples of grain)
+        // and runs sweep(workspace, first, last) for each of them
+        template <typename Sweep>
+        void for_each_chunk(const size_t n, const size_t grain, const Sweep & sweep);
+        // i-th equation of a system goes to [i * width + lane],
+        // width = 1 is the ordinary (not interleaved) layout;
+        // only the equations of s are assembled
+        void assemble_row(tridiagonal_mx_extended & mx, const size_t y, const Segment s, const size_t width = 1, const size_t lane = 0) const;
+        void assemble_col(tridiagonal_mx_extended & mx, const size_t x, const Segment s, const size_t width = 1, const size_t lane = 0) const;
+        void assemble_row_rhs(diagonal & d, const size_t y, const Segment s, const size_t width = 1, const size_t lane = 0) const;
+        void assemble_col_rhs(diagonal & d, const size_t x, const Segment s, const size_t width = 1, const size_t lane = 0) const;
+        void compile_segments();
+        void factorize();
+        bool should_split(const Segments & segments, const size_t n_lines) const;
+        BasicPartitionedTDMA<Real> partition(const tridiagonal_mx_extended & mx, const Segment s) const;
+        void factorize_partitions();
+        // runs task(g) for g < n, spread over the threads
+        template <typename Task>
+        void for_each_group(const size_t n, const Task & task);
+        void solve_rows_split();
+        void solve_cols_split();
+        // the span row y (column x) is solved into: the line of the
+        // field if IN_PLACE, otherwise f_x (f_y) of the workspace
+        util::strided_span<Real> row_storage(Workspace & ws, const size_t y);
+        util::strided_span<Real> col_storage(Workspace & ws, const size_t x);
+        void solve_rows(Workspace & ws, const size_t y_first, const size_t y_last);
+        void solve_cols(Workspace & ws, const size_t x_first, const size_t x_last);
+        void solve_rows_batched(Workspace & ws, const size_t y_first, const size_t y_last);
+        void solve_cols_batched(Workspace & ws, const size_t x_first, const size_t x_last);
+        void solve_cols_transposed(Workspace & ws, const size_t x_first, const size_t x_last);
+        void build_wavefront();
+        bool can_pipeline() const;
+        // the step in tiles, see solver.cpp
+        void step_wavefront();
+        // forward sweep (back substitution) of the columns
+        // of the block over the rows of the band
+        void eliminate_tile(const Segment band, const Segment block);
+        void substitute_tile(const Segment band, const Segment block);
+        void update_grid_row(const Workspace & ws, const size_t y, const Segment s);
+        void update_grid_col(const Workspace & ws, const size_t x, const Segment s);
     public:
-        Problem() = delete;
-        Problem(model::IModel & model, const size_t n_iters);
+        BasicProblem() = delete;
+        BasicProblem(Model & model, const size_t n_iters, const ProblemOptions & opts = {});
         void step();
+        size_t steps_done() const { return current_step; }
+        // continues the step count of a restarted run, the field
+        // itself is restored through the model
+        void resume_at(const size_t step);
+        // equations of all the lines and the ones within their
+        // active segments, per step (both sweeps)
+        size_t equations() const { return 2 * m.x_dim() * m.y_dim(); }
+        size_t active_equations() const;
     };
+
+    using Problem = BasicProblem<model::IModel>;
 }
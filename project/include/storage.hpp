@@ -0,0 +1,83 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "model.hpp"
+
+namespace io {
+    // Binary snapshot store. The file starts with a fixed header
+    // followed by the condition mask, the frames begin at the next
+    // page boundary and all have the same size:
+    //
+    //   [Header][mask: width * height bytes][padding]
+    //   [FrameHeader][width * height doubles]   <- frame 0 at data_offset
+    //   [FrameHeader][width * height doubles]   <- frame 1 at data_offset + frame_stride
+    //   ...
+    //
+    // Values are stored in the native byte order, which is recorded
+    // in the header and verified by the reader. The number of frames
+    // is not stored anywhere: it follows from the size of the file,
+    // so a run that has been interrupted leaves a readable store
+    // (an incomplete trailing frame is ignored)
+    class SnapshotWriter {
+    public:
+        SnapshotWriter(
+            const std::string & path,
+            const size_t width, const size_t height,
+            const model::Parameters & parameters,
+            util::strided_span<const model::condition> mask);
+        ~SnapshotWriter();
+        SnapshotWriter(const SnapshotWriter &) = delete;
+        SnapshotWriter & operator=(const SnapshotWriter &) = delete;
+        // appends a frame of the field after the given timestep
+        void append(const size_t step, const double time, util::strided_span<const double> field);
+        size_t frames() const { return n_frames; }
+    private:
+        const std::string path;
+        int fd = -1;
+        size_t width = 0;
+        size_t height = 0;
+        uint64_t data_offset = 0;
+        uint64_t frame_stride = 0;
+        size_t n_frames = 0;
+        // strided fields are gathered here before being written
+        std::vector<double> gather;
+    };
+
+    // Read-only view of a snapshot store. The file is mapped
+    // into memory as a whole, frames are returned as spans
+    // pointing right into the mapping
+    class SnapshotReader {
+    public:
+        explicit SnapshotReader(const std::string & path);
+        ~SnapshotReader();
+        SnapshotReader(const SnapshotReader &) = delete;
+        SnapshotReader & operator=(const SnapshotReader &) = delete;
+        size_t frames() const { return n_frames; }
+        size_t x_dim() const { return width; }
+        size_t y_dim() const { return height; }
+        const model::Parameters & parameters() const { return params; }
+        util::strided_span<const model::condition> mask() const;
+        // i-th frame in the order of appending
+        util::strided_span<const double> frame(const size_t i) const;
+        size_t step(const size_t i) const;
+        double time(const size_t i) const;
+        // index of the frame stored after the given timestep,
+        // throws if there is no such frame
+        size_t find_step(const size_t step) const;
+        bool has_step(const size_t step) const { return index.count(step) > 0; }
+    private:
+        const unsigned char * base = nullptr;
+        size_t mapped_size = 0;
+        size_t width = 0;
+        size_t height = 0;
+        model::Parameters params{};
+        uint64_t data_offset = 0;
+        uint64_t frame_stride = 0;
+        size_t n_frames = 0;
+        // timestep -> frame number
+        std::unordered_map<size_t, size_t> index;
+    private:
+        const unsigned char * frame_at(const size_t i) const;
+    };
+}
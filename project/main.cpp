@@ -1,8 +1,22 @@
+#include <csignal>
+#include <sstream>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <map>
 
 #include "solver.hpp"
 #include "plotter.hpp"
+#include "render.hpp"
+#include "storage.hpp"
+#include "schedule.hpp"
+#include "profile.hpp"
+#include "checkpoint.hpp"
+#include "adaptive.hpp"
+#include "multigrid.hpp"
+#include "distributed.hpp"
+#include "ensemble.hpp"
+#include "probe.hpp"
 
 constexpr size_t DEF_TIMESTEPS = 1000;
 constexpr double DEF_TIME = 15.0;
@@ -10,11 +24,254 @@ constexpr size_t X_NODES = 200;
 constexpr size_t Y_NODES = 100;
 constexpr double X_LEN = 10.0;
 constexpr double Y_LEN = 5.0;
+// frame buffers of the native renderer unless --async-plot is given
+constexpr size_t DEF_PLOT_BUFFERS = 2;
 
 constexpr std::string_view running = "Performing computations: ";
-constexpr std::string_view usage = "Usage: <simulation time:double> [<timesteps:uint> [<x_nodes:uint> <y_nodes:uint>]]\n";
+constexpr std::string_view usage =
+    "Usage: <simulation time:double> [<timesteps:uint> [<x_nodes:uint> <y_nodes:uint>]] [options]\n"
+    "Options:\n"
+    "  --sweep=lines|batched    solve rows/columns one by one (default) or in SIMD batches\n"
+    "  --threads=<uint>         number of threads to spread rows/columns over (default 1)\n"
+    "  --prefactorize           factorize the matrices once and only solve for the RHS each step\n"
+    "  --transpose-y            solve the columns on tile-transposed copies of the field\n"
+    "  --wavefront              pipeline the row and the column sweeps over tiles of the field\n"
+    "                           (lines sweep, LOD splitting; implies --prefactorize)\n"
+    "  --split=auto|never|always split long lines over the threads and SIMD lanes (default auto:\n"
+    "                           when there are too few lines to keep them all busy)\n"
+    "  --splitting=lod|adi      time splitting: locally one-dimensional (default, first order)\n"
+    "                           or Peaceman-Rachford ADI (second order)\n"
+    "  --plotter=native|gnuplot render map.gif in process (default, always on a writer thread)\n"
+    "                           or pipe the frames to gnuplot\n"
+    "  --async-plot=<uint>      plot on a writer thread with that many frame buffers (native: default 2)\n"
+    "  --drop-frames            drop frames instead of waiting when the async writer falls behind\n"
+    "  --snapshots=<path>       store every frame in a binary file, see the reader tool\n"
+    "  --probes=<path>          sample the probes listed in the file after every step, one per line:\n"
+    "                           point <name> <x> <y>, line <name> <x0> <y0> <x1> <y1> [<points>] or\n"
+    "                           rect <name> <x0> <y0> <x1> <y1> (y grows from the ceiling to the floor)\n"
+    "  --probe-out=<path>       time series of the probes, CSV for *.csv, binary otherwise\n"
+    "                           (default probes.csv)\n"
+    "  --no-plot                do not plot\n"
+    "  --precision=<uint>       significant digits of the values piped to gnuplot (default 6)\n"
+    "  --fixed                  pipe values with precision digits after the point\n"
+    "  --profile[=threads]      print the time spent in each phase (requires -DFDM_PROFILE=ON),\n"
+    "                           per thread if asked to\n"
+    "  --profile-json=<path>    write the same report as JSON\n"
+    "  --checkpoint=<path>      save the state periodically (and on SIGINT/SIGTERM) in the background\n"
+    "  --checkpoint-every=<uint>    every n-th timestep\n"
+    "  --checkpoint-seconds=<double> every that much of the wall-clock time (default 60)\n"
+    "  --restart=<path>         continue the run from a checkpoint\n"
+    "  --steady=<double>        stop once no node changes faster than that (K per unit of time)\n"
+    "  --adaptive[=<double>]    adapt the time step to keep the local error below\n"
+    "                           the tolerance (K, rms; default 0.1), timesteps sets the first step\n"
+    "                           (not with --prefactorize, --transpose-y or --wavefront)\n"
+    "  --dt-min=<double>        smallest time step of the adaptive mode (default dt / 1000)\n"
+    "  --dt-max=<double>        largest time step of the adaptive mode (default time / 10)\n"
+    "  --stationary[=<double>]  solve for the equilibrium with multigrid instead of marching in time,\n"
+    "                           until the residual drops that many times (default 1e-10)\n"
+    "  --cycle=v|w              multigrid cycle (default w)\n"
+    "  --real=<mode>            precision of the field and of the elimination: double (default),\n"
+    "                           mixed (float field, double elimination) or float\n"
+    "  --ranks=<uint>           split the plate into strips stepped by that many processes\n"
+    "                           (fixed time step, double precision, LOD splitting; not with --threads,\n"
+    "                           --sweep, --prefactorize, --transpose-y, --wavefront or --split)\n"
+    "  --t-floor=<double>       temperature of the floor (default 50)\n"
+    "  --t-ceil=<double>        temperature of the ceiling and of the inclined side (default 80)\n"
+    "  --ensemble=<path>        step every member listed in the file together (fixed time step,\n"
+    "                           double precision), one per line: <a> [<t_floor> <t_ceil> [<checkpoint>]],\n"
+    "                           the checkpoint gives the initial field; outputs get a .<member> suffix\n"
+    "Output schedule (a frame is written once any of these is met, every frame if none given):\n"
+    "  --every=<uint>           every n-th timestep\n"
+    "  --every-time=<double>    every that much of the simulated time\n"
+    "  --every-seconds=<double> every that much of the wall-clock time\n"
+    "  --change=<double>        once a node has changed by more than that since the last frame\n";
 
-int main(int argc, char* argv[]) {
+// named options are passed as --key=value and may appear
+// anywhere in the argument list, the rest are positional
+static bool parse_args(
+    const int argc, char* argv[],
+    std::vector<std::string> & positional,
+    std::map<std::string, std::string> & options
+) {
+    constexpr std::string_view known_options[] = {"sweep", "threads", "prefactorize", "transpose-y", "wavefront", "split", "splitting", "plotter", "async-plot", "drop-frames", "snapshots", "probes", "probe-out", "no-plot", "precision", "fixed", "profile", "profile-json",
+        "checkpoint", "checkpoint-every", "checkpoint-seconds", "restart",
+        "steady", "adaptive", "dt-min", "dt-max", "stationary", "cycle", "real", "ranks", "t-floor", "t-ceil", "ensemble",
+        "every", "every-time", "every-seconds", "change"};
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            positional.push_back(arg);
+            continue;
+        }
+        const size_t eq = arg.find('=');
+        const std::string key = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+        bool known = false;
+        for (const auto & k: known_options) known = known or k == key;
+        if (not known) {
+            std::cerr << "Unknown option: " << arg << '\n';
+            return false;
+        }
+        options[key] = eq == std::string::npos ? "" : arg.substr(eq + 1);
+    }
+    return true;
+}
+
+// set by SIGINT/SIGTERM, the run stops after the current step
+static volatile std::sig_atomic_t interrupted = 0;
+
+static void on_signal(const int) {
+    interrupted = 1;
+}
+
+// member of an --ensemble file, the missing
+// values are the ones of the command line
+struct EnsembleMember {
+    double a;
+    model::BoundaryTemperatures temperatures;
+    std::string initial;
+};
+
+static std::vector<EnsembleMember> read_ensemble(
+    const std::string & path, const double a, const model::BoundaryTemperatures & temperatures
+) {
+    std::ifstream in(path);
+    if (not in) throw std::runtime_error("cannot open the ensemble file " + path);
+    std::vector<EnsembleMember> members;
+    std::string line;
+    for (size_t n = 1; std::getline(in, line); ++n) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        EnsembleMember m{a, temperatures, ""};
+        if (not (fields >> m.a)) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+            throw std::runtime_error(path + ':' + std::to_string(n) + ": expected the diffusivity");
+        }
+        if (fields >> m.temperatures.floor and not (fields >> m.temperatures.ceiling))
+            throw std::runtime_error(path + ':' + std::to_string(n) + ": expected the temperature of the ceiling");
+        fields >> m.initial;
+        members.push_back(m);
+    }
+    if (members.empty()) throw std::runtime_error("no members in the ensemble file " + path);
+    return members;
+}
+
+// outputs of the member k: map.gif -> map.<k>.gif, probes.csv -> probes.<k>.csv
+// (the extension picks the format of these), path -> path.<k>
+static std::string member_path(const std::string & path, const size_t k) {
+    const size_t dot = path.rfind('.');
+    const std::string extension = dot == std::string::npos ? "" : path.substr(dot);
+    if (extension == ".gif" or extension == ".csv") return path.substr(0, dot) + '.' + std::to_string(k) + extension;
+    return path + '.' + std::to_string(k);
+}
+
+// how the frames are plotted, see --plotter and --async-plot
+struct PlotSettings {
+    bool gnuplot = false;
+    size_t buffers = 0;
+    plt::backpressure policy = plt::BLOCK_ON_FULL;
+    plt::NumberFormat format;
+};
+
+// animation of the frames at gif_path, rendered natively or by gnuplot
+static std::unique_ptr<plt::FrameWriter> make_plotter(const PlotSettings & s, const std::string & gif_path) {
+    if (not s.gnuplot) {
+        return std::make_unique<plt::ImageWriter>(gif_path, s.buffers > 0 ? s.buffers : DEF_PLOT_BUFFERS, s.policy);
+    }
+    std::string config(plt::GNUPlotWriter::basic_gif_config);
+    config.replace(config.find("map.gif"), 7, gif_path);
+    if (s.buffers > 0) return std::make_unique<plt::GNUPlotWriter>(config, s.buffers, s.policy, s.format);
+    return std::make_unique<plt::GNUPlotWriter>(config, s.format);
+}
+
+// runs the --ensemble members on the mesh of the prototype,
+// each member writes frames of its own on the same schedule
+static int run_ensemble(
+    const std::vector<EnsembleMember> & specs,
+    const model::Model79 & prototype,
+    const size_t timesteps,
+    const size_t n_threads,
+    const io::ScheduleOptions & schedule_opts,
+    const bool plot,
+    const PlotSettings & plot_settings,
+    const std::string & snapshots_path,
+    const std::vector<io::ProbeSpec> & probe_specs,
+    const std::string & probe_path
+) {
+    const model::Parameters p = prototype.parameters();
+    // the geometry is set up once and copied
+    std::vector<model::Model79> members(specs.size(), prototype);
+    std::vector<model::Model79 *> pointers;
+    for (size_t k = 0; k < specs.size(); ++k) {
+        model::Model79 & m = members[k];
+        m.set_parameters(p.dt, p.dx, p.dy, specs[k].a);
+        m.set_boundary_temperatures(specs[k].temperatures);
+        if (not specs[k].initial.empty()) {
+            const io::Checkpoint c = io::read_checkpoint(specs[k].initial);
+            if (c.width != m.x_dim() or c.height != m.y_dim())
+                throw std::runtime_error("checkpoint " + specs[k].initial + " does not match the mesh");
+            m.load_field({c.values.data(), c.values.size()});
+        }
+        pointers.push_back(&m);
+    }
+    solver::Ensemble ensemble(pointers, timesteps, n_threads);
+    std::cout << "Ensemble: " << ensemble.size() << " members, " << ensemble.n_groups() << " distinct parameter sets\n";
+
+    std::vector<std::unique_ptr<plt::FrameWriter>> plotters;
+    std::vector<std::unique_ptr<io::SnapshotWriter>> snapshots;
+    std::vector<std::unique_ptr<io::ProbeWriter>> probes;
+    std::vector<io::OutputScheduler> outputs(specs.size(), io::OutputScheduler(schedule_opts));
+    for (size_t k = 0; k < specs.size(); ++k) {
+        const model::Model79 & m = members[k];
+        if (plot) {
+            plotters.push_back(make_plotter(plot_settings, member_path("map.gif", k)));
+            outputs[k].add_sink([&plotter = *plotters.back(), &m](const size_t, const double, util::strided_span<const double> field) {
+                plotter.submit(field, m.x_dim());
+            });
+        }
+        if (not snapshots_path.empty()) {
+            snapshots.push_back(std::make_unique<io::SnapshotWriter>(
+                member_path(snapshots_path, k), m.x_dim(), m.y_dim(), m.parameters(), m.conditions()));
+            outputs[k].add_sink([&store = *snapshots.back()](const size_t step, const double t, util::strided_span<const double> field) {
+                store.append(step, t, field);
+            });
+        }
+        if (not probe_specs.empty()) {
+            const io::ProbeSet set(probe_specs, m.x_dim(), m.y_dim(), m.parameters(), m.conditions());
+            probes.push_back(std::make_unique<io::ProbeWriter>(member_path(probe_path, k), set));
+            probes.back()->append(0, 0.0, m.field());
+        }
+        outputs[k].force(0, 0.0, m.field());
+    }
+
+    std::cout << running;
+    io::ProgressPrinter progress(std::cout, running.data(), timesteps);
+    size_t last_step = 0;
+    while (not interrupted and last_step < timesteps) {
+        progress.update(last_step);
+        ensemble.step();
+        ++last_step;
+        const double t = static_cast<double>(last_step) * p.dt;
+        for (size_t k = 0; k < members.size(); ++k) outputs[k].offer(last_step, t, members[k].field());
+        for (size_t k = 0; k < probes.size(); ++k) probes[k]->append(last_step, t, members[k].field());
+    }
+    const double t = static_cast<double>(last_step) * p.dt;
+    for (size_t k = 0; k < members.size(); ++k) outputs[k].force(last_step, t, members[k].field());
+    for (auto & plotter: plotters) plotter->drain();
+    if (interrupted) {
+        std::cout << "\nInterrupted after step " << last_step << '\n';
+        return EXIT_FAILURE;
+    }
+    progress.finish(last_step);
+    std::cout << " Done, OK\n";
+    size_t frames = 0;
+    for (const auto & output: outputs) frames += output.emitted();
+    std::cout << "Frames written: " << frames << '\n';
+    return EXIT_SUCCESS;
+}
+
+// the errors of the run itself (a frame, a snapshot or a checkpoint
+// that fails to be written) reach main() and end it with a message
+static int run(int argc, char* argv[]) {
     double time = DEF_TIME;
     double timesteps = DEF_TIMESTEPS;
 
@@ -25,19 +282,21 @@ int main(int argc, char* argv[]) {
 
     // not the most versatile solution, however
     // it is OK for this case
-    if (argc == 1) {
+    std::vector<std::string> args;
+    std::map<std::string, std::string> options;
+    if (not parse_args(argc, argv, args, options) or args.empty()) {
         std::cout << usage;
         return EXIT_FAILURE;
     }
-    if (argc >= 2) {
-        time = std::stod(argv[1]);
+    if (args.size() >= 1) {
+        time = std::stod(args[0]);
     }
-    if (argc >= 3) {
-        timesteps = std::stoul(argv[2]);
+    if (args.size() >= 2) {
+        timesteps = std::stoul(args[1]);
     }
-    if (argc == 5) {
-        x_nodes = std::stoul(argv[3]);
-        y_nodes = std::stoul(argv[4]);
+    if (args.size() == 4) {
+        x_nodes = std::stoul(args[2]);
+        y_nodes = std::stoul(args[3]);
 
         if (x_nodes != y_nodes * 2) {
             std::cerr << "X to Y ratio must be 2:1\n";
@@ -49,32 +308,445 @@ int main(int argc, char* argv[]) {
     std::cout << "Timesteps set to " << timesteps << '\n';
     std::cout << "Mesh size: [" << x_nodes << ':' << y_nodes << "]\n";
 
-    const double dt = time / static_cast<double>(timesteps);
+    solver::ProblemOptions problem_opts;
+    if (options.count("sweep")) {
+        const std::string & sweep = options["sweep"];
+        if (sweep == "batched") problem_opts.mode = solver::BATCHED;
+        else if (sweep != "lines") {
+            std::cerr << "Unknown sweep mode: " << sweep << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.count("threads")) {
+        problem_opts.n_threads = std::stoul(options["threads"]);
+        if (problem_opts.n_threads == 0) {
+            std::cerr << "Number of threads must be positive\n";
+            return EXIT_FAILURE;
+        }
+        std::cout << "Threads: " << problem_opts.n_threads << '\n';
+    }
+    problem_opts.prefactorize = options.count("prefactorize") > 0;
+    problem_opts.transpose_y = options.count("transpose-y") > 0;
+    problem_opts.wavefront = options.count("wavefront") > 0;
+    if (options.count("split")) {
+        const std::string & split = options["split"];
+        if (split == "never") problem_opts.split = solver::SPLIT_NEVER;
+        else if (split == "always") problem_opts.split = solver::SPLIT_ALWAYS;
+        else if (split != "auto") {
+            std::cerr << "Unknown split mode: " << split << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    model::splitting splitting = model::LOCALLY_ONE_DIMENSIONAL;
+    if (options.count("splitting")) {
+        const std::string & name = options["splitting"];
+        if (name == "adi") splitting = model::PEACEMAN_RACHFORD;
+        else if (name != "lod") {
+            std::cerr << "Unknown time splitting: " << name << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    PlotSettings plot_settings;
+    if (options.count("plotter")) {
+        const std::string & name = options["plotter"];
+        plot_settings.gnuplot = name == "gnuplot";
+        if (name != "native" and name != "gnuplot") {
+            std::cerr << "Unknown plotter: " << name << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.count("async-plot")) {
+        plot_settings.buffers = std::stoul(options["async-plot"]);
+        if (plot_settings.buffers == 0) {
+            std::cerr << "Number of plot buffers must be positive\n";
+            return EXIT_FAILURE;
+        }
+    }
+    const std::string probe_path = options.count("probe-out") ? options["probe-out"] : "probes.csv";
+
+    if (options.count("drop-frames")) plot_settings.policy = plt::DROP_ON_FULL;
+    if (options.count("precision")) plot_settings.format.precision = std::stoi(options["precision"]);
+    if (options.count("fixed")) plot_settings.format.style = plt::FIXED;
+
+    io::ScheduleOptions schedule_opts;
+    if (options.count("every")) schedule_opts.every_steps = std::stoul(options["every"]);
+    if (options.count("every-time")) schedule_opts.every_time = std::stod(options["every-time"]);
+    if (options.count("every-seconds")) schedule_opts.every_seconds = std::stod(options["every-seconds"]);
+    if (options.count("change")) schedule_opts.change_threshold = std::stod(options["change"]);
+
+    io::ScheduleOptions checkpoint_opts;
+    if (options.count("checkpoint-every")) checkpoint_opts.every_steps = std::stoul(options["checkpoint-every"]);
+    if (options.count("checkpoint-seconds")) checkpoint_opts.every_seconds = std::stod(options["checkpoint-seconds"]);
+    if (checkpoint_opts.every_steps == 0 and checkpoint_opts.every_seconds == 0.0) checkpoint_opts.every_seconds = 60.0;
+
+    double dt = time / static_cast<double>(timesteps);
     const double dx = X_LEN / static_cast<double>(x_nodes);
     const double dy = Y_LEN / static_cast<double>(y_nodes);
 
+    const double steady_tolerance = options.count("steady") ? std::stod(options["steady"]) : 0.0;
+    const bool adaptive = options.count("adaptive") > 0;
+    solver::AdaptiveOptions adaptive_opts;
+    if (adaptive) {
+        if (not options["adaptive"].empty()) adaptive_opts.tolerance = std::stod(options["adaptive"]);
+        adaptive_opts.dt_min = options.count("dt-min") ? std::stod(options["dt-min"]) : dt / 1000;
+        adaptive_opts.dt_max = options.count("dt-max") ? std::stod(options["dt-max"]) : time / 10;
+        // every attempt changes the step twice, a cached factorization would not outlive it
+        for (const char * option: {"prefactorize", "transpose-y", "wavefront"}) {
+            if (options.count(option)) {
+                std::cerr << "--" << option << " does not apply to the adaptive time step\n";
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    const bool stationary = options.count("stationary") > 0;
+    solver::MultigridOptions multigrid_opts;
+    if (stationary) {
+        if (not options["stationary"].empty()) multigrid_opts.tolerance = std::stod(options["stationary"]);
+        multigrid_opts.n_threads = problem_opts.n_threads;
+    }
+    if (options.count("cycle")) {
+        const std::string & cycle = options["cycle"];
+        if (cycle == "v") multigrid_opts.cycle = solver::V_CYCLE;
+        else if (cycle != "w") {
+            std::cerr << "Unknown multigrid cycle: " << cycle << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::string real = options.count("real") ? options["real"] : "double";
+    if (real != "double" and real != "mixed" and real != "float") {
+        std::cerr << "Unknown precision: " << real << '\n';
+        return EXIT_FAILURE;
+    }
+    if (stationary and (adaptive or options.count("steady"))) {
+        std::cerr << "--stationary does not march in time, it cannot be combined with --"
+                  << (adaptive ? "adaptive" : "steady") << '\n';
+        return EXIT_FAILURE;
+    }
+
+    const bool reduced = real != "double";
+    if (reduced and (adaptive or stationary)) {
+        std::cerr << "--real=" << real << " only applies to the fixed time step\n";
+        return EXIT_FAILURE;
+    }
+
+    size_t n_ranks = 0;
+    if (options.count("ranks")) {
+        n_ranks = std::stoul(options["ranks"]);
+        if (n_ranks == 0) {
+            std::cerr << "Number of ranks must be positive\n";
+            return EXIT_FAILURE;
+        }
+        if (reduced or adaptive or stationary or splitting != model::LOCALLY_ONE_DIMENSIONAL) {
+            std::cerr << "--ranks only applies to the fixed time step in double precision with the LOD splitting\n";
+            return EXIT_FAILURE;
+        }
+        // the strips are swept line by line on a single thread, with a factorization of their own
+        for (const char * option: {"threads", "sweep", "prefactorize", "transpose-y", "wavefront", "split"}) {
+            if (options.count(option)) {
+                std::cerr << "--ranks does not apply the --" << option << " option to the strips\n";
+                return EXIT_FAILURE;
+            }
+        }
+        if (y_nodes < 2 * n_ranks) {
+            std::cerr << "Every rank needs 2 rows of the mesh at least\n";
+            return EXIT_FAILURE;
+        }
+        std::cout << "Ranks: " << n_ranks << '\n';
+    }
+
+    model::BoundaryTemperatures temperatures;
+    if (options.count("t-floor")) temperatures.floor = std::stod(options["t-floor"]);
+    if (options.count("t-ceil")) temperatures.ceiling = std::stod(options["t-ceil"]);
+
     // instantiate model for my case, set up problem
     // environment (e.g., allocate memory for solvers)
     // and gnuplot wrapper to create heatmap gif
-    model::Model79 m(dt, dx, dy, a, x_nodes, y_nodes);
-    solver::Problem problem(m, timesteps);
-    plt::GNUPlotWriter plotter(plt::GNUPlotWriter::basic_gif_config.data());
+    model::Model79 m(dt, dx, dy, a, x_nodes, y_nodes, temperatures);
+    m.set_scheme(splitting);
+
+    // the members are copies of m with parameters of their own
+    if (options.count("ensemble")) {
+        if (reduced or adaptive or stationary or n_ranks > 0 or steady_tolerance > 0.0
+            or options.count("restart") or options.count("checkpoint")) {
+            std::cerr << "--ensemble only applies to the fixed time step in double precision in a single process,\n"
+                         "without restarts, checkpoints or the steady state criterion\n";
+            return EXIT_FAILURE;
+        }
+        try {
+            const std::vector<EnsembleMember> members = read_ensemble(options["ensemble"], a, temperatures);
+            const std::vector<io::ProbeSpec> probe_specs =
+                options.count("probes") ? io::read_probes(options["probes"]) : std::vector<io::ProbeSpec>();
+            return run_ensemble(
+                members, m, timesteps, problem_opts.n_threads, schedule_opts,
+                options.count("no-plot") == 0, plot_settings, options.count("snapshots") ? options["snapshots"] : "",
+                probe_specs, probe_path);
+        } catch (const std::exception & e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    // the adaptive stepper drives a problem of its own
+    std::unique_ptr<solver::BasicProblem<model::Model79>> problem;
+    std::unique_ptr<solver::AdaptiveStepper> stepper;
+    // the mixed and float modes march a float copy of the field, m
+    // keeps the geometry and receives the field whenever it is written
+    std::unique_ptr<model::Model79f> mf;
+    std::unique_ptr<solver::BasicProblem<model::Model79f, double>> mixed_problem;
+    std::unique_ptr<solver::BasicProblem<model::Model79f, float>> float_problem;
+    if (adaptive) stepper = std::make_unique<solver::AdaptiveStepper>(m, dt, adaptive_opts, problem_opts);
+    else if (reduced) {
+        mf = std::make_unique<model::Model79f>(dt, dx, dy, a, x_nodes, y_nodes, temperatures);
+        mf->set_scheme(splitting);
+        if (real == "mixed") mixed_problem = std::make_unique<solver::BasicProblem<model::Model79f, double>>(*mf, timesteps, problem_opts);
+        else float_problem = std::make_unique<solver::BasicProblem<model::Model79f, float>>(*mf, timesteps, problem_opts);
+    }
+    // the distributed problem is set up once the ranks are forked
+    else if (n_ranks == 0) problem = std::make_unique<solver::BasicProblem<model::Model79>>(m, timesteps, problem_opts);
+    // the outer nodes are left out of the line solves
+    const auto print_active = [](const auto & p) {
+        std::cout << "Active equations: " << p.active_equations() << " of " << p.equations() << " per step\n";
+    };
+    if (problem) print_active(*problem);
+    if (mixed_problem) print_active(*mixed_problem);
+    if (float_problem) print_active(*float_problem);
+
+    // the checkpoint brings its own parameters, the field and the step count
+    size_t first_step = 0;
+    double start_time = 0.0;
+    if (options.count("restart")) {
+        io::Checkpoint c;
+        try {
+            c = io::read_checkpoint(options["restart"]);
+        } catch (const std::exception & e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+        if (c.width != m.x_dim() or c.height != m.y_dim()) {
+            std::cerr << "Checkpoint mesh [" << c.width << ':' << c.height << "] does not match the mesh\n";
+            return EXIT_FAILURE;
+        }
+        if (not adaptive and c.step > timesteps) {
+            std::cerr << "Checkpoint is past the last timestep (" << c.step << ")\n";
+            return EXIT_FAILURE;
+        }
+        const model::Parameters & p = c.parameters;
+        m.set_parameters(p.dt, p.dx, p.dy, p.a);
+        m.load_field({c.values.data(), c.values.size()});
+        if (mf) {
+            mf->set_parameters(p.dt, p.dx, p.dy, p.a);
+            mf->load_field(m.field());
+        }
+        if (stepper) stepper = std::make_unique<solver::AdaptiveStepper>(m, p.dt, adaptive_opts, problem_opts);
+        if (stepper) stepper->resume(c.time, c.step);
+        else if (mixed_problem) mixed_problem->resume_at(c.step);
+        else if (float_problem) float_problem->resume_at(c.step);
+        else if (problem) problem->resume_at(c.step);
+        dt = p.dt;
+        first_step = c.step;
+        start_time = c.time;
+        std::cout << "Restarted from step " << c.step << " (t = " << c.time << ")\n";
+    }
+    // the other ranks are forked with the model as it is by now (restarted
+    // included), before any thread is started, and follow the rank 0 until
+    // the end of the run; they leave the signals to the rank 0
+    std::unique_ptr<comm::ProcessGroup> group;
+    std::unique_ptr<solver::DistributedProblem> distributed;
+    if (n_ranks > 0) {
+        try {
+            group = std::make_unique<comm::ProcessGroup>(n_ranks, [&](comm::Communicator & c) {
+                std::signal(SIGINT, SIG_IGN);
+                std::signal(SIGTERM, SIG_IGN);
+                solver::DistributedProblem d(m, c, timesteps);
+                d.follow();
+                return EXIT_SUCCESS;
+            });
+            distributed = std::make_unique<solver::DistributedProblem>(m, group->communicator(), timesteps);
+        } catch (const std::exception & e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+        distributed->resume_at(first_step);
+    }
+    std::unique_ptr<plt::FrameWriter> plotter;
+    if (options.count("no-plot") == 0) {
+        try {
+            plotter = make_plotter(plot_settings, "map.gif");
+        } catch (const std::exception & e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    std::unique_ptr<io::SnapshotWriter> snapshots;
+    if (options.count("snapshots")) {
+        snapshots = std::make_unique<io::SnapshotWriter>(
+            options["snapshots"], m.x_dim(), m.y_dim(), m.parameters(), m.conditions());
+    }
+    std::unique_ptr<io::ProbeWriter> probes;
+    if (options.count("probes")) {
+        try {
+            const io::ProbeSet set(io::read_probes(options["probes"]), m.x_dim(), m.y_dim(), m.parameters(), m.conditions());
+            probes = std::make_unique<io::ProbeWriter>(probe_path, set);
+        } catch (const std::exception & e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    io::OutputScheduler output(schedule_opts);
+    if (plotter) {
+        output.add_sink([&](const size_t, const double, util::strided_span<const double> field) {
+            plotter->submit(field, m.x_dim());
+        });
+    }
+    if (snapshots) {
+        output.add_sink([&](const size_t step, const double t, util::strided_span<const double> field) {
+            snapshots->append(step, t, field);
+        });
+    }
+
+    std::unique_ptr<io::CheckpointWriter> checkpoints;
+    io::OutputScheduler checkpoint_schedule(checkpoint_opts);
+    if (options.count("checkpoint")) {
+        checkpoints = std::make_unique<io::CheckpointWriter>(options["checkpoint"]);
+        checkpoint_schedule.add_sink([&](const size_t step, const double t, util::strided_span<const double> field) {
+            // the adaptive run is resumed with the step it would take next
+            model::Parameters p = m.parameters();
+            if (stepper) p.dt = stepper->next_dt();
+            checkpoints->submit(step, t, m.x_dim(), m.y_dim(), p, field);
+        });
+        // so that the first checkpoint is not taken right away
+        checkpoint_schedule.mark(first_step, start_time, m.field());
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+    }
+
+    // the float field is only converted (the strips of the other
+    // ranks only gathered) if anything reads it each step, the
+    // probes sample the float field as it is
+    const bool field_read = plotter or snapshots or checkpoints or steady_tolerance > 0.0;
+    const auto sample_probes = [&](const size_t step, const double time) {
+        if (mf) probes->append(step, time, mf->field());
+        else probes->append(step, time, m.field());
+    };
 
     std::cout << "The problem schematic (may not fit into the terminal entirely)\n";
     pprint_grid(m, std::cout);
-    plotter.reciever() << m;
-    plotter.flush_buffer();
+    if (not stationary) output.force(first_step, start_time, m.field());
+    if (probes and not stationary) sample_probes(first_step, start_time);
 
-    std::cout << running;
-    for (size_t i = 0; i < timesteps; ++i) {
-        std::cout << '\r' << running << "iter [" << i << '/' << timesteps << ']';
-        std::cout.flush();
+    solver::SteadyStateMonitor monitor;
+    if (steady_tolerance > 0.0) monitor.reset(m.field());
+    bool steady = false;
 
-        problem.step();
-        plotter.reciever() << m;
-        plotter.flush_buffer();
+    // the stationary solution is the only frame after the initial one,
+    // the (restarted) field is the initial guess
+    solver::MultigridStats multigrid_stats;
+    if (stationary) {
+        solver::Multigrid multigrid(m, multigrid_opts);
+        std::cout << "Solving the stationary problem on " << multigrid.n_levels() << " grids\n";
+        multigrid_stats = multigrid.solve();
+        if (probes) sample_probes(first_step, start_time);
     }
 
-    std::cout << " Done, OK\n";
+    if (not stationary) std::cout << running;
+    io::ProgressPrinter progress(std::cout, running.data(), adaptive ? 0 : static_cast<size_t>(timesteps));
+    size_t last_step = first_step;
+    double t = start_time;
+    // the adaptive run ends at the simulation time (up to the rounding of the sum of steps),
+    // the fixed one after the given number of timesteps
+    while (not stationary and not interrupted and (adaptive ? t < time * (1 - 1e-12) : last_step < timesteps)) {
+        progress.update(last_step);
+
+        double step_dt = dt;
+        if (stepper) {
+            step_dt = stepper->step(time - t);
+            t = stepper->time();
+        } else {
+            if (mixed_problem) mixed_problem->step();
+            else if (float_problem) float_problem->step();
+            else if (distributed) distributed->step();
+            else problem->step();
+            t = static_cast<double>(last_step + 1) * dt;
+        }
+        ++last_step;
+        if (mf and field_read) m.load_field(mf->field());
+        if (distributed and (field_read or probes)) distributed->gather();
+        if (probes) sample_probes(last_step, t);
+        output.offer(last_step, t, m.field());
+        checkpoint_schedule.offer(last_step, t, m.field());
+
+        if (steady_tolerance > 0.0) {
+            monitor.update(m.field(), step_dt);
+            if (monitor.max_residual() < steady_tolerance) {
+                steady = true;
+                break;
+            }
+        }
+    }
+    // the final state is always written
+    if (mf) m.load_field(mf->field());
+    if (distributed) {
+        distributed->gather();
+        distributed->finish();
+        group->join();
+    }
+    output.force(last_step, t, m.field());
+    if (checkpoints) {
+        checkpoint_schedule.force(last_step, t, m.field());
+        checkpoints->flush();
+    }
+
+    if (plotter) plotter->drain();
+    if (interrupted) {
+        std::cout << "\nInterrupted after step " << last_step;
+        if (checkpoints) std::cout << ", checkpoint saved to " << options["checkpoint"];
+        std::cout << '\n';
+        return EXIT_FAILURE;
+    }
+    if (stationary) {
+        std::cout << (multigrid_stats.converged ? "Converged" : "Not converged") << " after "
+                  << multigrid_stats.cycles << " cycles (rms residual " << multigrid_stats.initial_residual
+                  << " -> " << multigrid_stats.residual;
+        if (multigrid_stats.residual > 0.0) std::cout << ", reduced " << 1.0 / multigrid_stats.convergence_factor() << " times per cycle";
+        std::cout << ")\n";
+    } else {
+        progress.finish(last_step);
+        std::cout << " Done, OK\n";
+    }
+    if (steady) {
+        std::cout << "Steady state reached at t = " << t << " after " << last_step << " steps"
+                  << " (max |dT/dt| = " << monitor.max_residual()
+                  << ", rms |dT/dt| = " << monitor.rms_residual() << ")\n";
+    }
+    if (stepper) {
+        std::cout << "Simulated time: " << t << ", steps accepted: " << stepper->accepted()
+                  << ", rejected: " << stepper->rejected() << ", last dt: " << stepper->next_dt() << '\n';
+    }
+    std::cout << "Frames written: " << output.emitted() << '\n';
+    if (probes) std::cout << "Probe samples written: " << probes->samples() << " to " << probe_path << '\n';
+    if (plotter and plotter->dropped_frames() > 0) {
+        std::cout << "Frames dropped by the plotter: " << plotter->dropped_frames() << '\n';
+    }
+    // the plotter is destroyed first so that its writer thread is done
+    plotter.reset();
+    if (options.count("profile")) {
+        prof::report(std::cout, options["profile"] == "threads");
+    }
+    if (options.count("profile-json")) {
+        std::ofstream json(options["profile-json"]);
+        prof::report_json(json);
+    }
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        return run(argc, argv);
+    } catch (const std::exception & e) {
+        std::cerr << '\n' << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+}
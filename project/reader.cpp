@@ -0,0 +1,46 @@
+#include <iostream>
+
+#include "storage.hpp"
+#include "render.hpp"
+
+constexpr std::string_view usage =
+    "Usage: <snapshot store> [--list | <timestep:uint>]\n"
+    "  --list       print the timesteps stored in the file\n"
+    "  <timestep>   plot the field after that timestep into t-field.png (the last one by default)\n";
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 or argc > 3) {
+        std::cout << usage;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const io::SnapshotReader store(argv[1]);
+        const model::Parameters p = store.parameters();
+        std::cout << "Mesh size: [" << store.x_dim() << ':' << store.y_dim() << "]\n";
+        std::cout << "dt = " << p.dt << ", dx = " << p.dx << ", dy = " << p.dy << ", a = " << p.a << '\n';
+        std::cout << "Frames stored: " << store.frames() << '\n';
+
+        const std::string arg = argc == 3 ? argv[2] : "";
+        if (arg == "--list") {
+            for (size_t i = 0; i < store.frames(); ++i) {
+                std::cout << "step " << store.step(i) << "\tt = " << store.time(i) << '\n';
+            }
+            return EXIT_SUCCESS;
+        }
+        if (store.frames() == 0) {
+            std::cerr << "Nothing to plot\n";
+            return EXIT_FAILURE;
+        }
+
+        const size_t frame = arg.empty() ? store.frames() - 1 : store.find_step(std::stoul(arg));
+        std::cout << "Plotting step " << store.step(frame) << " (t = " << store.time(frame) << ")\n";
+
+        plt::ImageWriter plotter("t-field.png");
+        plotter.submit(store.frame(frame), store.x_dim());
+    } catch (const std::exception & e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
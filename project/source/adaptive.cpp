@@ -0,0 +1,97 @@
+#include "adaptive.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace solver {
+    void SteadyStateMonitor::reset(util::strided_span<const double> field) {
+        previous.assign(field.begin(), field.end());
+    }
+
+    void SteadyStateMonitor::update(util::strided_span<const double> field, const double dt) {
+        if (previous.size() != field.size())
+            throw std::runtime_error("steady state monitor has not been reset for this field");
+        double max_delta = 0.0, sum_squares = 0.0;
+        for (size_t i = 0; i < field.size(); ++i) {
+            const double delta = field[i] - previous[i];
+            max_delta = std::max(max_delta, std::abs(delta));
+            sum_squares += delta * delta;
+            previous[i] = field[i];
+        }
+        max_rate = max_delta / dt;
+        rms_rate = std::sqrt(sum_squares / field.size()) / dt;
+    }
+
+    AdaptiveStepper::AdaptiveStepper(
+        model::Model79 & model, const double initial_dt,
+        const AdaptiveOptions & options, const ProblemOptions & problem_opts
+    ):
+        m(model),
+        opts(options),
+        problem(model, std::numeric_limits<size_t>::max(), problem_opts),
+        dt(initial_dt) {
+        if (opts.dt_min <= 0.0 or opts.dt_max < opts.dt_min)
+            throw std::runtime_error("invalid time step bounds");
+        if (opts.tolerance <= 0.0)
+            throw std::runtime_error("tolerance must be positive");
+        if (problem_opts.prefactorize or problem_opts.transpose_y or problem_opts.wavefront)
+            throw std::runtime_error("the adaptive time step changes too often to cache factorizations");
+        dt = std::clamp(dt, opts.dt_min, opts.dt_max);
+    }
+
+    void AdaptiveStepper::set_dt(const double new_dt) {
+        const model::Parameters p = m.parameters();
+        // set_parameters() bumps the model revision, the split
+        // sweeps refactorize their partitions at the next step
+        if (p.dt != new_dt) m.set_parameters(new_dt, p.dx, p.dy, p.a);
+    }
+
+    double AdaptiveStepper::step(const double max_dt) {
+        if (max_dt <= 0.0) throw std::runtime_error("no time left to step over");
+        const util::strided_span<const double> field = m.field();
+        start.assign(field.begin(), field.end());
+
+        for (;;) {
+            const double h = std::min(dt, max_dt);
+
+            // one full step
+            set_dt(h);
+            problem.step();
+            full.assign(field.begin(), field.end());
+
+            // two half-steps from the same state
+            m.load_field({start.data(), start.size()});
+            set_dt(h / 2);
+            problem.step();
+            problem.step();
+
+            double sum_squares = 0.0;
+            for (size_t i = 0; i < field.size(); ++i) {
+                const double delta = field[i] - full[i];
+                sum_squares += delta * delta;
+            }
+            const double error = std::sqrt(sum_squares / field.size());
+            last_error = error;
+
+            // the error of a step of order p scales as dt^(p + 1)
+            const double ratio = opts.tolerance / error;
+            const double ideal = m.scheme() == model::PEACEMAN_RACHFORD ? std::cbrt(ratio) : std::sqrt(ratio);
+            const double factor = error > 0.0
+                ? std::clamp(opts.safety * ideal, opts.max_shrink, opts.max_growth)
+                : opts.max_growth;
+            const bool at_min = h <= opts.dt_min;
+            if (error <= opts.tolerance or at_min) {
+                // a step shortened by max_dt says nothing about dt
+                if (h == dt or factor < 1.0) dt = std::clamp(h * factor, opts.dt_min, opts.dt_max);
+                t += h;
+                ++n_accepted;
+                return h;
+            }
+
+            ++n_rejected;
+            dt = std::clamp(h * factor, opts.dt_min, opts.dt_max);
+            m.load_field({start.data(), start.size()});
+        }
+    }
+}
@@ -0,0 +1,644 @@
+#include "batched.hpp"
+#include "profile.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCHED_X86
+#endif
+
+// NB: this translation unit is compiled with -ffp-contract=off (see CMakeLists.txt)
+// so that no lane fuses a*b-c into FMA and every lane reproduces
+// the scalar TDMA::solve bit by bit
+
+namespace solver {
+    // portable kernel, works for any batch width
+    // and performs exactly the same operations as TDMA::solve
+    template <typename Real>
+    static void solve_scalar(
+        const Real * a, const Real * b, const Real * c, const Real * d,
+        Real * c_star, Real * d_star, Real * storage,
+        const size_t length, const size_t width
+    ) {
+        for (size_t l = 0; l < width; ++l) {
+            const Real w = Real(1) / b[l];
+            c_star[l] = c[l] * w;
+            d_star[l] = d[l] * w;
+        }
+
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * width;
+            const size_t prev = row - width;
+            for (size_t l = 0; l < width; ++l) {
+                const Real w = Real(1) / (b[row + l] - a[row + l] * c_star[prev + l]);
+                c_star[row + l] = c[row + l] * w;
+                d_star[row + l] = (d[row + l] - a[row + l] * d_star[prev + l]) * w;
+            }
+        }
+
+        const size_t last = (length - 1) * width;
+        for (size_t l = 0; l < width; ++l) {
+            storage[last + l] = d_star[last + l];
+        }
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * width;
+            const size_t next = row + width;
+            for (size_t l = 0; l < width; ++l) {
+                storage[row + l] = d_star[row + l] - c_star[row + l] * storage[next + l];
+            }
+        }
+    }
+
+    // RHS-only counterpart of solve_scalar() for prefactorized systems
+    template <typename Real>
+    static void solve_factorized_scalar(
+        const Real * a, const Real * c_star, const Real * inv_pivot, const Real * d,
+        Real * storage, const size_t length, const size_t width
+    ) {
+        for (size_t l = 0; l < width; ++l) {
+            storage[l] = d[l] * inv_pivot[l];
+        }
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * width;
+            const size_t prev = row - width;
+            for (size_t l = 0; l < width; ++l) {
+                storage[row + l] = (d[row + l] - a[row + l] * storage[prev + l]) * inv_pivot[row + l];
+            }
+        }
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * width;
+            const size_t next = row + width;
+            for (size_t l = 0; l < width; ++l) {
+                storage[row + l] = storage[row + l] - c_star[row + l] * storage[next + l];
+            }
+        }
+    }
+
+    // every lane solves the same prefactorized matrix: a, c_star and
+    // inv_pivot hold one value per row (not interleaved), d and the
+    // storage are interleaved as usual. Same operations as solve_factorized_scalar()
+    template <typename Real>
+    static void solve_shared_scalar(
+        const Real * a, const Real * c_star, const Real * inv_pivot, const Real * d,
+        Real * storage, const size_t length, const size_t width
+    ) {
+        for (size_t l = 0; l < width; ++l) {
+            storage[l] = d[l] * inv_pivot[0];
+        }
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * width;
+            const size_t prev = row - width;
+            for (size_t l = 0; l < width; ++l) {
+                storage[row + l] = (d[row + l] - a[i] * storage[prev + l]) * inv_pivot[i];
+            }
+        }
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * width;
+            const size_t next = row + width;
+            for (size_t l = 0; l < width; ++l) {
+                storage[row + l] = storage[row + l] - c_star[i] * storage[next + l];
+            }
+        }
+    }
+
+#ifdef BATCHED_X86
+    // 4 systems per ymm register, width must be 4
+    __attribute__((target("avx2")))
+    static void solve_avx2(
+        const double * a, const double * b, const double * c, const double * d,
+        double * c_star, double * d_star, double * storage,
+        const size_t length, const size_t
+    ) {
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d w0 = _mm256_div_pd(one, _mm256_loadu_pd(b));
+        __m256d cs = _mm256_mul_pd(_mm256_loadu_pd(c), w0);
+        __m256d ds = _mm256_mul_pd(_mm256_loadu_pd(d), w0);
+        _mm256_storeu_pd(c_star, cs);
+        _mm256_storeu_pd(d_star, ds);
+
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * 4;
+            const __m256d ai = _mm256_loadu_pd(a + row);
+            const __m256d w = _mm256_div_pd(
+                one, _mm256_sub_pd(_mm256_loadu_pd(b + row), _mm256_mul_pd(ai, cs)));
+            cs = _mm256_mul_pd(_mm256_loadu_pd(c + row), w);
+            ds = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(d + row), _mm256_mul_pd(ai, ds)), w);
+            _mm256_storeu_pd(c_star + row, cs);
+            _mm256_storeu_pd(d_star + row, ds);
+        }
+
+        // ds holds the last row already
+        __m256d x = ds;
+        _mm256_storeu_pd(storage + (length - 1) * 4, x);
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * 4;
+            x = _mm256_sub_pd(
+                _mm256_loadu_pd(d_star + row),
+                _mm256_mul_pd(_mm256_loadu_pd(c_star + row), x));
+            _mm256_storeu_pd(storage + row, x);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    static void solve_factorized_avx2(
+        const double * a, const double * c_star, const double * inv_pivot, const double * d,
+        double * storage, const size_t length, const size_t
+    ) {
+        __m256d x = _mm256_mul_pd(_mm256_loadu_pd(d), _mm256_loadu_pd(inv_pivot));
+        _mm256_storeu_pd(storage, x);
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * 4;
+            x = _mm256_mul_pd(
+                _mm256_sub_pd(_mm256_loadu_pd(d + row), _mm256_mul_pd(_mm256_loadu_pd(a + row), x)),
+                _mm256_loadu_pd(inv_pivot + row));
+            _mm256_storeu_pd(storage + row, x);
+        }
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * 4;
+            x = _mm256_sub_pd(
+                _mm256_loadu_pd(storage + row),
+                _mm256_mul_pd(_mm256_loadu_pd(c_star + row), x));
+            _mm256_storeu_pd(storage + row, x);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    static void solve_shared_avx2(
+        const double * a, const double * c_star, const double * inv_pivot, const double * d,
+        double * storage, const size_t length, const size_t
+    ) {
+        __m256d x = _mm256_mul_pd(_mm256_loadu_pd(d), _mm256_set1_pd(inv_pivot[0]));
+        _mm256_storeu_pd(storage, x);
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * 4;
+            x = _mm256_mul_pd(
+                _mm256_sub_pd(_mm256_loadu_pd(d + row), _mm256_mul_pd(_mm256_set1_pd(a[i]), x)),
+                _mm256_set1_pd(inv_pivot[i]));
+            _mm256_storeu_pd(storage + row, x);
+        }
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * 4;
+            x = _mm256_sub_pd(
+                _mm256_loadu_pd(storage + row),
+                _mm256_mul_pd(_mm256_set1_pd(c_star[i]), x));
+            _mm256_storeu_pd(storage + row, x);
+        }
+    }
+
+    // 8 systems per zmm register, width must be 8
+    __attribute__((target("avx512f")))
+    static void solve_avx512(
+        const double * a, const double * b, const double * c, const double * d,
+        double * c_star, double * d_star, double * storage,
+        const size_t length, const size_t
+    ) {
+        const __m512d one = _mm512_set1_pd(1.0);
+        const __m512d w0 = _mm512_div_pd(one, _mm512_loadu_pd(b));
+        __m512d cs = _mm512_mul_pd(_mm512_loadu_pd(c), w0);
+        __m512d ds = _mm512_mul_pd(_mm512_loadu_pd(d), w0);
+        _mm512_storeu_pd(c_star, cs);
+        _mm512_storeu_pd(d_star, ds);
+
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * 8;
+            const __m512d ai = _mm512_loadu_pd(a + row);
+            const __m512d w = _mm512_div_pd(
+                one, _mm512_sub_pd(_mm512_loadu_pd(b + row), _mm512_mul_pd(ai, cs)));
+            cs = _mm512_mul_pd(_mm512_loadu_pd(c + row), w);
+            ds = _mm512_mul_pd(_mm512_sub_pd(_mm512_loadu_pd(d + row), _mm512_mul_pd(ai, ds)), w);
+            _mm512_storeu_pd(c_star + row, cs);
+            _mm512_storeu_pd(d_star + row, ds);
+        }
+
+        __m512d x = ds;
+        _mm512_storeu_pd(storage + (length - 1) * 8, x);
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * 8;
+            x = _mm512_sub_pd(
+                _mm512_loadu_pd(d_star + row),
+                _mm512_mul_pd(_mm512_loadu_pd(c_star + row), x));
+            _mm512_storeu_pd(storage + row, x);
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    static void solve_factorized_avx512(
+        const double * a, const double * c_star, const double * inv_pivot, const double * d,
+        double * storage, const size_t length, const size_t
+    ) {
+        __m512d x = _mm512_mul_pd(_mm512_loadu_pd(d), _mm512_loadu_pd(inv_pivot));
+        _mm512_storeu_pd(storage, x);
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * 8;
+            x = _mm512_mul_pd(
+                _mm512_sub_pd(_mm512_loadu_pd(d + row), _mm512_mul_pd(_mm512_loadu_pd(a + row), x)),
+                _mm512_loadu_pd(inv_pivot + row));
+            _mm512_storeu_pd(storage + row, x);
+        }
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * 8;
+            x = _mm512_sub_pd(
+                _mm512_loadu_pd(storage + row),
+                _mm512_mul_pd(_mm512_loadu_pd(c_star + row), x));
+            _mm512_storeu_pd(storage + row, x);
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    static void solve_shared_avx512(
+        const double * a, const double * c_star, const double * inv_pivot, const double * d,
+        double * storage, const size_t length, const size_t
+    ) {
+        __m512d x = _mm512_mul_pd(_mm512_loadu_pd(d), _mm512_set1_pd(inv_pivot[0]));
+        _mm512_storeu_pd(storage, x);
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * 8;
+            x = _mm512_mul_pd(
+                _mm512_sub_pd(_mm512_loadu_pd(d + row), _mm512_mul_pd(_mm512_set1_pd(a[i]), x)),
+                _mm512_set1_pd(inv_pivot[i]));
+            _mm512_storeu_pd(storage + row, x);
+        }
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * 8;
+            x = _mm512_sub_pd(
+                _mm512_loadu_pd(storage + row),
+                _mm512_mul_pd(_mm512_set1_pd(c_star[i]), x));
+            _mm512_storeu_pd(storage + row, x);
+        }
+    }
+
+    // 8 float systems per ymm register, width must be 8
+    __attribute__((target("avx2")))
+    static void solve_avx2_float(
+        const float * a, const float * b, const float * c, const float * d,
+        float * c_star, float * d_star, float * storage,
+        const size_t length, const size_t
+    ) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 w0 = _mm256_div_ps(one, _mm256_loadu_ps(b));
+        __m256 cs = _mm256_mul_ps(_mm256_loadu_ps(c), w0);
+        __m256 ds = _mm256_mul_ps(_mm256_loadu_ps(d), w0);
+        _mm256_storeu_ps(c_star, cs);
+        _mm256_storeu_ps(d_star, ds);
+
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * 8;
+            const __m256 ai = _mm256_loadu_ps(a + row);
+            const __m256 w = _mm256_div_ps(
+                one, _mm256_sub_ps(_mm256_loadu_ps(b + row), _mm256_mul_ps(ai, cs)));
+            cs = _mm256_mul_ps(_mm256_loadu_ps(c + row), w);
+            ds = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(d + row), _mm256_mul_ps(ai, ds)), w);
+            _mm256_storeu_ps(c_star + row, cs);
+            _mm256_storeu_ps(d_star + row, ds);
+        }
+
+        // ds holds the last row already
+        __m256 x = ds;
+        _mm256_storeu_ps(storage + (length - 1) * 8, x);
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * 8;
+            x = _mm256_sub_ps(
+                _mm256_loadu_ps(d_star + row),
+                _mm256_mul_ps(_mm256_loadu_ps(c_star + row), x));
+            _mm256_storeu_ps(storage + row, x);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    static void solve_factorized_avx2_float(
+        const float * a, const float * c_star, const float * inv_pivot, const float * d,
+        float * storage, const size_t length, const size_t
+    ) {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(d), _mm256_loadu_ps(inv_pivot));
+        _mm256_storeu_ps(storage, x);
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * 8;
+            x = _mm256_mul_ps(
+                _mm256_sub_ps(_mm256_loadu_ps(d + row), _mm256_mul_ps(_mm256_loadu_ps(a + row), x)),
+                _mm256_loadu_ps(inv_pivot + row));
+            _mm256_storeu_ps(storage + row, x);
+        }
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * 8;
+            x = _mm256_sub_ps(
+                _mm256_loadu_ps(storage + row),
+                _mm256_mul_ps(_mm256_loadu_ps(c_star + row), x));
+            _mm256_storeu_ps(storage + row, x);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    static void solve_shared_avx2_float(
+        const float * a, const float * c_star, const float * inv_pivot, const float * d,
+        float * storage, const size_t length, const size_t
+    ) {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(d), _mm256_set1_ps(inv_pivot[0]));
+        _mm256_storeu_ps(storage, x);
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * 8;
+            x = _mm256_mul_ps(
+                _mm256_sub_ps(_mm256_loadu_ps(d + row), _mm256_mul_ps(_mm256_set1_ps(a[i]), x)),
+                _mm256_set1_ps(inv_pivot[i]));
+            _mm256_storeu_ps(storage + row, x);
+        }
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * 8;
+            x = _mm256_sub_ps(
+                _mm256_loadu_ps(storage + row),
+                _mm256_mul_ps(_mm256_set1_ps(c_star[i]), x));
+            _mm256_storeu_ps(storage + row, x);
+        }
+    }
+
+    // 16 float systems per zmm register, width must be 16
+    __attribute__((target("avx512f")))
+    static void solve_avx512_float(
+        const float * a, const float * b, const float * c, const float * d,
+        float * c_star, float * d_star, float * storage,
+        const size_t length, const size_t
+    ) {
+        const __m512 one = _mm512_set1_ps(1.0f);
+        const __m512 w0 = _mm512_div_ps(one, _mm512_loadu_ps(b));
+        __m512 cs = _mm512_mul_ps(_mm512_loadu_ps(c), w0);
+        __m512 ds = _mm512_mul_ps(_mm512_loadu_ps(d), w0);
+        _mm512_storeu_ps(c_star, cs);
+        _mm512_storeu_ps(d_star, ds);
+
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * 16;
+            const __m512 ai = _mm512_loadu_ps(a + row);
+            const __m512 w = _mm512_div_ps(
+                one, _mm512_sub_ps(_mm512_loadu_ps(b + row), _mm512_mul_ps(ai, cs)));
+            cs = _mm512_mul_ps(_mm512_loadu_ps(c + row), w);
+            ds = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(d + row), _mm512_mul_ps(ai, ds)), w);
+            _mm512_storeu_ps(c_star + row, cs);
+            _mm512_storeu_ps(d_star + row, ds);
+        }
+
+        __m512 x = ds;
+        _mm512_storeu_ps(storage + (length - 1) * 16, x);
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * 16;
+            x = _mm512_sub_ps(
+                _mm512_loadu_ps(d_star + row),
+                _mm512_mul_ps(_mm512_loadu_ps(c_star + row), x));
+            _mm512_storeu_ps(storage + row, x);
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    static void solve_factorized_avx512_float(
+        const float * a, const float * c_star, const float * inv_pivot, const float * d,
+        float * storage, const size_t length, const size_t
+    ) {
+        __m512 x = _mm512_mul_ps(_mm512_loadu_ps(d), _mm512_loadu_ps(inv_pivot));
+        _mm512_storeu_ps(storage, x);
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * 16;
+            x = _mm512_mul_ps(
+                _mm512_sub_ps(_mm512_loadu_ps(d + row), _mm512_mul_ps(_mm512_loadu_ps(a + row), x)),
+                _mm512_loadu_ps(inv_pivot + row));
+            _mm512_storeu_ps(storage + row, x);
+        }
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * 16;
+            x = _mm512_sub_ps(
+                _mm512_loadu_ps(storage + row),
+                _mm512_mul_ps(_mm512_loadu_ps(c_star + row), x));
+            _mm512_storeu_ps(storage + row, x);
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    static void solve_shared_avx512_float(
+        const float * a, const float * c_star, const float * inv_pivot, const float * d,
+        float * storage, const size_t length, const size_t
+    ) {
+        __m512 x = _mm512_mul_ps(_mm512_loadu_ps(d), _mm512_set1_ps(inv_pivot[0]));
+        _mm512_storeu_ps(storage, x);
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * 16;
+            x = _mm512_mul_ps(
+                _mm512_sub_ps(_mm512_loadu_ps(d + row), _mm512_mul_ps(_mm512_set1_ps(a[i]), x)),
+                _mm512_set1_ps(inv_pivot[i]));
+            _mm512_storeu_ps(storage + row, x);
+        }
+        for (size_t i = length - 1; i-- > 0; ) {
+            const size_t row = i * 16;
+            x = _mm512_sub_ps(
+                _mm512_loadu_ps(storage + row),
+                _mm512_mul_ps(_mm512_set1_ps(c_star[i]), x));
+            _mm512_storeu_ps(storage + row, x);
+        }
+    }
+#endif
+
+    static BasicBatchedTDMA<double>::kernel pick_kernel(const double *, const size_t width) {
+#ifdef BATCHED_X86
+        if (width == 8 and __builtin_cpu_supports("avx512f")) return solve_avx512;
+        if (width == 4 and __builtin_cpu_supports("avx2")) return solve_avx2;
+#endif
+        return solve_scalar<double>;
+    }
+
+    static BasicBatchedTDMA<float>::kernel pick_kernel(const float *, const size_t width) {
+#ifdef BATCHED_X86
+        if (width == 16 and __builtin_cpu_supports("avx512f")) return solve_avx512_float;
+        if (width == 8 and __builtin_cpu_supports("avx2")) return solve_avx2_float;
+#endif
+        return solve_scalar<float>;
+    }
+
+    static BasicBatchedTDMA<double>::factorized_kernel pick_factorized_kernel(const double *, const size_t width) {
+#ifdef BATCHED_X86
+        if (width == 8 and __builtin_cpu_supports("avx512f")) return solve_factorized_avx512;
+        if (width == 4 and __builtin_cpu_supports("avx2")) return solve_factorized_avx2;
+#endif
+        return solve_factorized_scalar<double>;
+    }
+
+    static BasicBatchedTDMA<float>::factorized_kernel pick_factorized_kernel(const float *, const size_t width) {
+#ifdef BATCHED_X86
+        if (width == 16 and __builtin_cpu_supports("avx512f")) return solve_factorized_avx512_float;
+        if (width == 8 and __builtin_cpu_supports("avx2")) return solve_factorized_avx2_float;
+#endif
+        return solve_factorized_scalar<float>;
+    }
+
+    static BasicBatchedTDMA<double>::factorized_kernel pick_shared_kernel(const double *, const size_t width) {
+#ifdef BATCHED_X86
+        if (width == 8 and __builtin_cpu_supports("avx512f")) return solve_shared_avx512;
+        if (width == 4 and __builtin_cpu_supports("avx2")) return solve_shared_avx2;
+#endif
+        return solve_shared_scalar<double>;
+    }
+
+    static BasicBatchedTDMA<float>::factorized_kernel pick_shared_kernel(const float *, const size_t width) {
+#ifdef BATCHED_X86
+        if (width == 16 and __builtin_cpu_supports("avx512f")) return solve_shared_avx512_float;
+        if (width == 8 and __builtin_cpu_supports("avx2")) return solve_shared_avx2_float;
+#endif
+        return solve_shared_scalar<float>;
+    }
+
+    // a register holds 64 (32) bytes with AVX-512 (AVX2)
+    template <typename Real>
+    size_t BasicBatchedTDMA<Real>::native_width() {
+#ifdef BATCHED_X86
+        if (__builtin_cpu_supports("avx512f")) return 64 / sizeof(Real);
+        if (__builtin_cpu_supports("avx2")) return 32 / sizeof(Real);
+#endif
+        return 1;
+    }
+
+    template <typename Real>
+    BasicBatchedTDMA<Real>::BasicBatchedTDMA(const size_t diagonal_length, const size_t width):
+        length(diagonal_length),
+        width(width),
+        // the pointer argument only selects the overload of the precision
+        solve_kernel(pick_kernel(static_cast<const Real *>(nullptr), width)),
+        factorized_solve_kernel(pick_factorized_kernel(static_cast<const Real *>(nullptr), width)),
+        shared_solve_kernel(pick_shared_kernel(static_cast<const Real *>(nullptr), width)),
+        c_star(diagonal_length * width, 0),
+        d_star(diagonal_length * width, 0) {
+        if (width == 0) throw std::runtime_error("zero batch width");
+    }
+
+    template <typename Real>
+    void BasicBatchedTDMA<Real>::solve(
+        const basic_tridiagonal_mx<Real> & SLE,
+        basic_diagonal<Real> & storage
+    ) {
+        solve(SLE, storage, 0, length);
+    }
+
+    template <typename Real>
+    void BasicBatchedTDMA<Real>::solve(
+        const basic_tridiagonal_mx<Real> & SLE,
+        basic_diagonal<Real> & storage,
+        const size_t first,
+        const size_t last
+    ) {
+        const size_t N = length * width;
+
+        if (N == 0)
+            throw std::runtime_error("solver is not initialized");
+        if (N != SLE[0].size())
+            throw std::runtime_error("dimension mismatch for a");
+        if (N != SLE[1].size())
+            throw std::runtime_error("dimension mismatch for b");
+        if (N != SLE[2].size())
+            throw std::runtime_error("dimension mismatch for c");
+        if (N != SLE[3].size())
+            throw std::runtime_error("dimension mismatch for d");
+        if (N != storage.size())
+            throw std::runtime_error("dimension mismatch for storage");
+        if (first > last or last > length)
+            throw std::runtime_error("rows out of the systems");
+        if (first == last) return;
+
+        // the kernels see the rows [first, last) as whole systems
+        const size_t offset = first * width;
+        solve_kernel(
+            SLE[0].data() + offset, SLE[1].data() + offset, SLE[2].data() + offset, SLE[3].data() + offset,
+            c_star.data() + offset, d_star.data() + offset, storage.data() + offset,
+            last - first, width);
+        PROF_COUNT(EQUATIONS_SOLVED, (last - first) * width);
+    }
+
+    template <typename Real>
+    void BasicBatchedTDMA<Real>::factorize(
+        const basic_tridiagonal_mx<Real> & SLE,
+        Real * c_star,
+        Real * inv_pivot
+    ) const {
+        const size_t N = length * width;
+        if (N == 0)
+            throw std::runtime_error("solver is not initialized");
+        if (N != SLE[0].size() or N != SLE[1].size() or N != SLE[2].size())
+            throw std::runtime_error("dimension mismatch for the matrix");
+
+        // done once per run, no need for SIMD here
+        const Real * a = SLE[0].data(), * b = SLE[1].data(), * c = SLE[2].data();
+        for (size_t l = 0; l < width; ++l) {
+            inv_pivot[l] = Real(1) / b[l];
+            c_star[l] = c[l] * inv_pivot[l];
+        }
+        for (size_t i = 1; i < length; ++i) {
+            const size_t row = i * width;
+            const size_t prev = row - width;
+            for (size_t l = 0; l < width; ++l) {
+                inv_pivot[row + l] = Real(1) / (b[row + l] - a[row + l] * c_star[prev + l]);
+                c_star[row + l] = c[row + l] * inv_pivot[row + l];
+            }
+        }
+    }
+
+    template <typename Real>
+    void BasicBatchedTDMA<Real>::solve_factorized(
+        const Real * a,
+        const Real * c_star,
+        const Real * inv_pivot,
+        const basic_diagonal<Real> & d,
+        basic_diagonal<Real> & storage
+    ) const {
+        solve_factorized(a, c_star, inv_pivot, d, storage, 0, length);
+    }
+
+    template <typename Real>
+    void BasicBatchedTDMA<Real>::solve_factorized(
+        const Real * a,
+        const Real * c_star,
+        const Real * inv_pivot,
+        const basic_diagonal<Real> & d,
+        basic_diagonal<Real> & storage,
+        const size_t first,
+        const size_t last
+    ) const {
+        const size_t N = length * width;
+        if (N == 0)
+            throw std::runtime_error("solver is not initialized");
+        if (N != d.size())
+            throw std::runtime_error("dimension mismatch for d");
+        if (N != storage.size())
+            throw std::runtime_error("dimension mismatch for storage");
+        if (first > last or last > length)
+            throw std::runtime_error("rows out of the systems");
+        if (first == last) return;
+
+        const size_t offset = first * width;
+        factorized_solve_kernel(
+            a + offset, c_star + offset, inv_pivot + offset, d.data() + offset, storage.data() + offset,
+            last - first, width);
+        PROF_COUNT(EQUATIONS_SOLVED, (last - first) * width);
+    }
+
+    template <typename Real>
+    void BasicBatchedTDMA<Real>::solve_shared(
+        const Real * a,
+        const Real * c_star,
+        const Real * inv_pivot,
+        const basic_diagonal<Real> & d,
+        basic_diagonal<Real> & storage,
+        const size_t first,
+        const size_t last
+    ) const {
+        const size_t N = length * width;
+        if (N == 0)
+            throw std::runtime_error("solver is not initialized");
+        if (N != d.size())
+            throw std::runtime_error("dimension mismatch for d");
+        if (N != storage.size())
+            throw std::runtime_error("dimension mismatch for storage");
+        if (first > last or last > length)
+            throw std::runtime_error("rows out of the systems");
+        if (first == last) return;
+
+        shared_solve_kernel(
+            a + first, c_star + first, inv_pivot + first, d.data() + first * width, storage.data() + first * width,
+            last - first, width);
+        PROF_COUNT(EQUATIONS_SOLVED, (last - first) * width);
+    }
+
+    template class BasicBatchedTDMA<double>;
+    template class BasicBatchedTDMA<float>;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+// internal to the library: what the binary formats (snapshot stores,
+// checkpoints, probe series) have in common. Their headers start with
+// char magic[8], uint32_t version and uint32_t byte_order
+namespace io::binary {
+    // reads back as 0x04030201 on a machine of the other endianness
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    template <typename Header>
+    void stamp(Header & header, const char (&magic)[8], const uint32_t version) {
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.byte_order = BYTE_ORDER_MARK;
+    }
+
+    // why the header is not one of the format (a "snapshot store",
+    // a "checkpoint") this build reads, empty if it is
+    template <typename Header>
+    std::string mismatch(const Header & header, const char (&magic)[8], const uint32_t version, const std::string & format) {
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+            return "not a " + format;
+        if (header.byte_order != BYTE_ORDER_MARK)
+            return format + " has been written on a machine of different endianness";
+        if (header.version != version)
+            return "unsupported " + format + " version " + std::to_string(header.version);
+        return {};
+    }
+
+    [[noreturn]] inline void throw_errno(const std::string & what, const std::string & path) {
+        throw std::runtime_error(what + " '" + path + "': " + std::strerror(errno));
+    }
+
+    // write() and pwrite() may be interrupted or write less than asked for,
+    // the calls are repeated until all of it is written
+    template <typename Write>
+    void write_fully(Write && write_some, const void * data, size_t size, const std::string & what, const std::string & path) {
+        const char * p = static_cast<const char *>(data);
+        while (size > 0) {
+            const ssize_t n = write_some(p, size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw_errno(what, path);
+            }
+            p += n;
+            size -= static_cast<size_t>(n);
+        }
+    }
+
+    inline void write_fully(const int fd, const void * data, const size_t size, const std::string & what, const std::string & path) {
+        write_fully([fd](const char * p, const size_t n) { return write(fd, p, n); }, data, size, what, path);
+    }
+
+    inline void pwrite_fully(
+        const int fd, const void * data, const size_t size, const off_t offset,
+        const std::string & what, const std::string & path
+    ) {
+        const char * const begin = static_cast<const char *>(data);
+        write_fully([fd, begin, offset](const char * p, const size_t n) {
+            return pwrite(fd, p, n, offset + (p - begin));
+        }, data, size, what, path);
+    }
+
+    inline void read_fully(const int fd, void * data, size_t size, const std::string & what, const std::string & path) {
+        char * p = static_cast<char *>(data);
+        while (size > 0) {
+            const ssize_t n = read(fd, p, size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw_errno(what, path);
+            }
+            if (n == 0) throw std::runtime_error("'" + path + "' is truncated");
+            p += n;
+            size -= static_cast<size_t>(n);
+        }
+    }
+}
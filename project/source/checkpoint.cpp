@@ -0,0 +1,184 @@
+#include "checkpoint.hpp"
+#include "binary.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace io {
+    namespace {
+        constexpr char MAGIC[8] = {'F', 'D', 'M', 'C', 'H', 'K', 'P', '1'};
+        constexpr uint32_t VERSION = 1;
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t byte_order;
+            uint64_t width;
+            uint64_t height;
+            uint64_t step;
+            double time;
+            double dt;
+            double dx;
+            double dy;
+            double a;
+            uint64_t checksum;
+        };
+        static_assert(sizeof(Header) == 88, "checkpoint header must have no padding");
+
+        // FNV-1a over 64-bit words, good enough to catch a torn file
+        uint64_t checksum(const std::vector<double> & values) {
+            uint64_t h = 14695981039346656037ull;
+            for (const double v: values) {
+                uint64_t word;
+                std::memcpy(&word, &v, sizeof(word));
+                h = (h ^ word) * 1099511628211ull;
+            }
+            return h;
+        }
+    }
+
+    using binary::throw_errno;
+
+    void write_checkpoint(const std::string & path, const Checkpoint & c) {
+        if (c.values.size() != c.width * c.height)
+            throw std::runtime_error("checkpoint field does not match its mesh");
+
+        Header header{};
+        binary::stamp(header, MAGIC, VERSION);
+        header.width = c.width;
+        header.height = c.height;
+        header.step = c.step;
+        header.time = c.time;
+        header.dt = c.parameters.dt;
+        header.dx = c.parameters.dx;
+        header.dy = c.parameters.dy;
+        header.a = c.parameters.a;
+        header.checksum = checksum(c.values);
+
+        // rename() within a directory is atomic: a reader sees
+        // either the previous checkpoint or the complete new one
+        const std::string tmp = path + ".tmp";
+        const int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) throw_errno("failed to create checkpoint", tmp);
+        try {
+            binary::write_fully(fd, &header, sizeof(header), "failed to write checkpoint", tmp);
+            binary::write_fully(fd, c.values.data(), c.values.size() * sizeof(double), "failed to write checkpoint", tmp);
+            if (fsync(fd) != 0) throw_errno("failed to sync checkpoint", tmp);
+        } catch (...) {
+            close(fd);
+            unlink(tmp.c_str());
+            throw;
+        }
+        close(fd);
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            unlink(tmp.c_str());
+            throw_errno("failed to replace checkpoint", path);
+        }
+    }
+
+    Checkpoint read_checkpoint(const std::string & path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw_errno("failed to open checkpoint", path);
+
+        Checkpoint c;
+        try {
+            Header header;
+            binary::read_fully(fd, &header, sizeof(header), "failed to read checkpoint", path);
+            const std::string why = binary::mismatch(header, MAGIC, VERSION, "checkpoint");
+            if (not why.empty()) throw std::runtime_error("'" + path + "': " + why);
+            if (header.width == 0 or header.height == 0)
+                throw std::runtime_error("checkpoint '" + path + "' has an empty mesh");
+
+            c.step = header.step;
+            c.time = header.time;
+            c.width = header.width;
+            c.height = header.height;
+            c.parameters = {header.dt, header.dx, header.dy, header.a};
+            c.values.resize(c.width * c.height);
+            binary::read_fully(fd, c.values.data(), c.values.size() * sizeof(double), "failed to read checkpoint", path);
+            if (checksum(c.values) != header.checksum)
+                throw std::runtime_error("checkpoint '" + path + "' is corrupted (checksum mismatch)");
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        close(fd);
+        return c;
+    }
+
+    CheckpointWriter::CheckpointWriter(const std::string & path):
+        path(path),
+        writer(&CheckpointWriter::writer_loop, this) {}
+
+    CheckpointWriter::~CheckpointWriter() {
+        // a pending checkpoint is still written
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopped = true;
+        }
+        wake.notify_one();
+        writer.join();
+    }
+
+    void CheckpointWriter::submit(
+        const size_t step, const double time,
+        const size_t width, const size_t height,
+        const model::Parameters & parameters,
+        util::strided_span<const double> field
+    ) {
+        if (field.size() != width * height)
+            throw std::runtime_error("field does not match the mesh of the checkpoint");
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (has_pending) ++n_superseded;
+            pending.step = step;
+            pending.time = time;
+            pending.width = width;
+            pending.height = height;
+            pending.parameters = parameters;
+            // the buffer is reused, no allocation after the first checkpoint
+            pending.values.assign(field.begin(), field.end());
+            has_pending = true;
+        }
+        wake.notify_one();
+    }
+
+    void CheckpointWriter::flush() {
+        std::unique_lock<std::mutex> guard(lock);
+        idle.wait(guard, [&] { return not has_pending and not busy; });
+        if (error) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+    void CheckpointWriter::writer_loop() {
+        for (;;) {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] { return stopped or has_pending; });
+            if (not has_pending) return;  // stopped and nothing left
+            std::swap(pending, in_flight);
+            has_pending = false;
+            busy = true;
+            guard.unlock();
+
+            std::exception_ptr failure;
+            try {
+                write_checkpoint(path, in_flight);
+            } catch (...) {
+                failure = std::current_exception();
+            }
+
+            guard.lock();
+            busy = false;
+            if (failure) error = failure;
+            else ++n_written;
+            guard.unlock();
+            idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,217 @@
+#include "comm.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include <fcntl.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace comm {
+    namespace {
+        // doubles per slot: 128 KiB, a row of a 16k-wide mesh at once
+        constexpr size_t SLOT_SIZE = 1 << 14;
+        // a blocked rank checks this often whether another one has failed
+        constexpr long POLL_NS = 100'000'000;
+
+        struct Channel {
+            // empty is posted by the receiver once the slot is read,
+            // full by the sender once it is written
+            sem_t empty;
+            sem_t full;
+            size_t count;
+            double slot[SLOT_SIZE];
+        };
+    }
+
+    // lives at the start of the shared segment, followed by
+    // the channels, the one from s to d at [s * n_ranks + d]
+    struct Mailboxes {
+        std::atomic<bool> failed;
+        size_t n_ranks;
+        Channel & channel(const size_t source, const size_t dest) {
+            return reinterpret_cast<Channel *>(this + 1)[source * n_ranks + dest];
+        }
+    };
+
+    static_assert(std::atomic<bool>::is_always_lock_free, "the failure flag is shared between processes");
+
+    namespace {
+        void fail(const std::string & what) {
+            throw std::runtime_error(what + ": " + std::strerror(errno));
+        }
+
+        class SharedMemoryCommunicator final : public Communicator {
+        private:
+            Mailboxes & boxes;
+            const size_t r;
+            // the rank 0 watches the workers, they watch their parent,
+            // so that a killed process does not leave the others waiting
+            const std::vector<pid_t> * workers;
+            const pid_t parent;
+        private:
+            bool peers_alive() const {
+                if (workers == nullptr) return getppid() == parent;
+                for (const pid_t pid: *workers) {
+                    siginfo_t info;
+                    info.si_pid = 0;
+                    // WNOWAIT leaves the exit status to join()
+                    if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 and info.si_pid != 0) return false;
+                }
+                return true;
+            }
+            void wait(sem_t & s) {
+                for (;;) {
+                    timespec deadline;
+                    clock_gettime(CLOCK_REALTIME, &deadline);
+                    deadline.tv_nsec += POLL_NS;
+                    if (deadline.tv_nsec >= 1'000'000'000) {
+                        deadline.tv_nsec -= 1'000'000'000;
+                        ++deadline.tv_sec;
+                    }
+                    if (sem_timedwait(&s, &deadline) == 0) return;
+                    if (errno != ETIMEDOUT and errno != EINTR) fail("sem_timedwait");
+                    if (boxes.failed.load()) throw std::runtime_error("another rank has failed");
+                    if (not peers_alive()) throw std::runtime_error("another rank has exited");
+                }
+            }
+            void check_peer(const size_t peer) const {
+                if (peer >= boxes.n_ranks or peer == r)
+                    throw std::runtime_error("no such peer rank: " + std::to_string(peer));
+            }
+        public:
+            SharedMemoryCommunicator(Mailboxes & boxes, const size_t rank, const std::vector<pid_t> * workers, const pid_t parent):
+                boxes(boxes), r(rank), workers(workers), parent(parent) {}
+            size_t rank() const override { return r; }
+            size_t size() const override { return boxes.n_ranks; }
+            void send(const size_t dest, const double * data, const size_t n) override {
+                check_peer(dest);
+                Channel & ch = boxes.channel(r, dest);
+                for (size_t sent = 0; sent < n; sent += SLOT_SIZE) {
+                    const size_t count = std::min(n - sent, SLOT_SIZE);
+                    wait(ch.empty);
+                    std::copy_n(data + sent, count, ch.slot);
+                    ch.count = count;
+                    sem_post(&ch.full);
+                }
+            }
+            void recv(const size_t source, double * data, const size_t n) override {
+                check_peer(source);
+                Channel & ch = boxes.channel(source, r);
+                for (size_t received = 0; received < n; received += SLOT_SIZE) {
+                    const size_t count = std::min(n - received, SLOT_SIZE);
+                    wait(ch.full);
+                    const size_t arrived = ch.count;
+                    std::copy_n(ch.slot, std::min(count, arrived), data + received);
+                    sem_post(&ch.empty);
+                    if (arrived != count) throw std::runtime_error("message length mismatch");
+                }
+            }
+        };
+    }
+
+    ProcessGroup::ProcessGroup(const size_t n_ranks, const job & worker) {
+        if (n_ranks == 0) throw std::runtime_error("process group must have at least one rank");
+
+        // the segment is unlinked right away, the mapping
+        // stays valid and is inherited by the forked ranks
+        const std::string name = "/fdm-heat-" + std::to_string(getpid());
+        const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) fail("shm_open");
+        mapped_size = sizeof(Mailboxes) + n_ranks * n_ranks * sizeof(Channel);
+        const bool sized = ftruncate(fd, static_cast<off_t>(mapped_size)) == 0;
+        void * addr = sized ? mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        const int error = errno;
+        shm_unlink(name.c_str());
+        close(fd);
+        if (addr == MAP_FAILED) {
+            errno = error;
+            fail(sized ? "mmap" : "ftruncate");
+        }
+
+        mailboxes = new (addr) Mailboxes;
+        mailboxes->failed = false;
+        mailboxes->n_ranks = n_ranks;
+        for (size_t s = 0; s < n_ranks; ++s) {
+            for (size_t d = 0; d < n_ranks; ++d) {
+                Channel & ch = mailboxes->channel(s, d);
+                sem_init(&ch.empty, 1, 1);
+                sem_init(&ch.full, 1, 0);
+                ch.count = 0;
+            }
+        }
+
+        // buffered output would be written once more by every child
+        std::cout.flush();
+        std::fflush(nullptr);
+        workers.reserve(n_ranks - 1);
+        const pid_t parent = getpid();
+        for (size_t r = 1; r < n_ranks; ++r) {
+            const pid_t pid = fork();
+            if (pid < 0) {
+                const int error = errno;
+                release();
+                errno = error;
+                fail("fork");
+            }
+            if (pid == 0) {
+                int status = EXIT_FAILURE;
+                try {
+                    SharedMemoryCommunicator c(*mailboxes, r, nullptr, parent);
+                    status = worker(c);
+                } catch (const std::exception & e) {
+                    std::cerr << "Rank " << r << ": " << e.what() << '\n';
+                }
+                if (status != EXIT_SUCCESS) mailboxes->failed = true;
+                std::cout.flush();
+                // no destructors nor atexit handlers of the parent state
+                _exit(status);
+            }
+            workers.push_back(pid);
+        }
+        root = std::make_unique<SharedMemoryCommunicator>(*mailboxes, 0, &workers, parent);
+    }
+
+    void ProcessGroup::join() {
+        size_t failures = 0;
+        for (const pid_t pid: workers) {
+            int status = 0;
+            while (waitpid(pid, &status, 0) < 0 and errno == EINTR);
+            if (not WIFEXITED(status) or WEXITSTATUS(status) != EXIT_SUCCESS) ++failures;
+        }
+        workers.clear();
+        if (failures) throw std::runtime_error(std::to_string(failures) + " worker rank(s) failed");
+    }
+
+    ProcessGroup::~ProcessGroup() {
+        release();
+    }
+
+    void ProcessGroup::release() {
+        if (mailboxes == nullptr) return;
+        if (not workers.empty()) {
+            mailboxes->failed = true;
+            try {
+                join();
+            } catch (...) {}
+        }
+        root.reset();
+        for (size_t s = 0; s < mailboxes->n_ranks; ++s) {
+            for (size_t d = 0; d < mailboxes->n_ranks; ++d) {
+                sem_destroy(&mailboxes->channel(s, d).empty);
+                sem_destroy(&mailboxes->channel(s, d).full);
+            }
+        }
+        munmap(mailboxes, mapped_size);
+        mailboxes = nullptr;
+    }
+}
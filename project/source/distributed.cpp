@@ -0,0 +1,303 @@
+#include "distributed.hpp"
+
+#include <algorithm>
+
+#include "profile.hpp"
+
+namespace solver {
+    DistributedProblem::DistributedProblem(model::Model79 & model, comm::Communicator & comm, const size_t n_iters):
+        n_iters(n_iters), m(model), comm(comm) {
+        // an ADI sweep would need the rows of the neighbouring strips
+        if (m.scheme() != model::LOCALLY_ONE_DIMENSIONAL)
+            throw std::runtime_error("distributed problem only supports the LOD splitting");
+        const Segment s = strip(m.y_dim(), comm.rank(), comm.size());
+        first_row = s.first;
+        last_row = s.last;
+        separator_row = comm.rank() + 1 < comm.size() ? last_row - 1 : last_row;
+        setup();
+        reduce_setup();
+    }
+
+    Segment DistributedProblem::strip(const size_t y_dim, const size_t r, const size_t n) {
+        if (r >= n) throw std::runtime_error("rank out of range");
+        if (y_dim < 2 * n) throw std::runtime_error("mesh too coarse for that many ranks (2 rows per rank at least)");
+        return {r * y_dim / n, (r + 1) * y_dim / n};
+    }
+
+    void DistributedProblem::setup() {
+        PROF_SCOPE(FACTORIZE);
+        const size_t x_dim = m.x_dim(), y_dim = m.y_dim();
+        const size_t n = interior_size();
+
+        // the rows of the strip are solved whole, as in the Problem
+        const size_t n_rows = last_row - first_row;
+        rows = {diagonal(n_rows * x_dim), diagonal(n_rows * x_dim), diagonal(n_rows * x_dim)};
+        tridiagonal_mx_extended mx = {diagonal(x_dim), diagonal(x_dim), diagonal(x_dim), diagonal(x_dim)};
+        for (size_t y = first_row; y < last_row; ++y) {
+            const size_t offset = (y - first_row) * x_dim;
+            m.fill_x_line(y, 0, x_dim, mx[0].data(), mx[1].data(), mx[2].data(), mx[3].data(), 1);
+            TDMA::factorize(mx, &rows.c_star[offset], &rows.inv_pivot[offset]);
+            std::copy(mx[0].begin(), mx[0].end(), rows.a.begin() + offset);
+        }
+
+        // the interior of a column is cut off the separators: their
+        // couplings move to the RHS, as the responses p and q
+        cols = {diagonal(n * x_dim), diagonal(n * x_dim), diagonal(n * x_dim)};
+        p.assign(n * x_dim, 0);
+        q.assign(n * x_dim, 0);
+        y_local.assign(n * x_dim, 0);
+        separator_a.assign(x_dim, 0);
+        separator_b.assign(x_dim, 0);
+        separator_c.assign(x_dim, 0);
+        separator_d.assign(x_dim, 0);
+        // the strips of the first and the last ranks
+        // have no separator above (below)
+        s_above.assign(x_dim, 0);
+        s_below.assign(x_dim, 0);
+        tridiagonal_mx_extended col = {diagonal(y_dim), diagonal(y_dim), diagonal(y_dim), diagonal(y_dim)};
+        tridiagonal_mx_extended interior = {diagonal(n), diagonal(n), diagonal(n), diagonal(n)};
+        line.assign(std::max(x_dim, y_dim), 0);
+        for (size_t x = 0; x < x_dim; ++x) {
+            const size_t offset = x * n;
+            m.fill_y_line(x, first_row, last_row, col[0].data(), col[1].data(), col[2].data(), col[3].data(), 1);
+            for (size_t k = 0; k < 3; ++k) {
+                std::copy_n(&col[k][first_row], n, interior[k].begin());
+            }
+            // zero on the first and the last ranks (boundary rows)
+            const double a_top = interior[0][0], c_bottom = interior[2][n - 1];
+            interior[0][0] = 0;
+            interior[2][n - 1] = 0;
+            TDMA::factorize(interior, &cols.c_star[offset], &cols.inv_pivot[offset]);
+            std::copy(interior[0].begin(), interior[0].end(), cols.a.begin() + offset);
+
+            std::fill_n(line.begin(), n, 0);
+            line[0] = -a_top;
+            TDMA::solve_factorized(n, &cols.a[offset], &cols.c_star[offset], &cols.inv_pivot[offset], line.data(), &p[offset]);
+            std::fill_n(line.begin(), n, 0);
+            line[n - 1] = -c_bottom;
+            TDMA::solve_factorized(n, &cols.a[offset], &cols.c_star[offset], &cols.inv_pivot[offset], line.data(), &q[offset]);
+
+            if (has_separator()) {
+                separator_a[x] = col[0][separator_row];
+                separator_b[x] = col[1][separator_row];
+                separator_c[x] = col[2][separator_row];
+            }
+        }
+    }
+
+    void DistributedProblem::reduce_setup() {
+        const size_t x_dim = m.x_dim(), n = interior_size();
+        const size_t r = comm.rank(), n_ranks = comm.size();
+        if (n_ranks == 1) return;
+
+        // the separator above only sees the first interior row
+        // of this strip, the one below the last
+        message.assign(3 * x_dim, 0);
+        if (r > 0) {
+            for (size_t x = 0; x < x_dim; ++x) {
+                message[x] = p[x * n];
+                message[x_dim + x] = q[x * n];
+            }
+            comm.send(r - 1, message.data(), 2 * x_dim);
+        }
+        // reduced equation of the separator S_r:
+        // a * S_{r-1} + b * S_r + c * S_{r+1} = d
+        diagonal equation(3 * x_dim, 0);
+        if (has_separator()) {
+            comm.recv(r + 1, message.data(), 2 * x_dim);
+            for (size_t x = 0; x < x_dim; ++x) {
+                const size_t last = x * n + n - 1;
+                const double a = separator_a[x], b = separator_b[x], c = separator_c[x];
+                equation[x] = a * p[last];
+                equation[x_dim + x] = b + a * q[last] + c * message[x];
+                equation[2 * x_dim + x] = c * message[x_dim + x];
+            }
+            if (r > 0) comm.send(0, equation.data(), 3 * x_dim);
+        }
+        if (r > 0) return;
+
+        // the rank 0 gathers the reduced systems, one per column
+        const size_t R = n_ranks - 1;
+        reduced = {diagonal(R * x_dim), diagonal(R * x_dim), diagonal(R * x_dim)};
+        reduced_d.assign(R * x_dim, 0);
+        tridiagonal_mx_extended mx = {diagonal(R * x_dim), diagonal(R * x_dim), diagonal(R * x_dim), diagonal(0)};
+        for (size_t j = 0; j < R; ++j) {
+            if (j > 0) comm.recv(j, equation.data(), 3 * x_dim);
+            for (size_t x = 0; x < x_dim; ++x) {
+                for (size_t k = 0; k < 3; ++k) {
+                    mx[k][x * R + j] = equation[k * x_dim + x];
+                }
+            }
+        }
+        tridiagonal_mx_extended system = {diagonal(R), diagonal(R), diagonal(R), diagonal(R)};
+        for (size_t x = 0; x < x_dim; ++x) {
+            for (size_t k = 0; k < 3; ++k) {
+                std::copy_n(&mx[k][x * R], R, system[k].begin());
+            }
+            TDMA::factorize(system, &reduced.c_star[x * R], &reduced.inv_pivot[x * R]);
+            std::copy(system[0].begin(), system[0].end(), reduced.a.begin() + x * R);
+        }
+    }
+
+    void DistributedProblem::resume_at(const size_t step) {
+        if (step > n_iters) throw std::runtime_error("restart step is past the last iteration");
+        current_step = step;
+    }
+
+    void DistributedProblem::broadcast(const command c) {
+        if (comm.rank() != 0) throw std::runtime_error("only the rank 0 drives a distributed run");
+        if (finished) throw std::runtime_error("distributed run is over");
+        const double code = c;
+        for (size_t r = 1; r < comm.size(); ++r) {
+            comm.send(r, &code, 1);
+        }
+    }
+
+    void DistributedProblem::step() {
+        if (current_step == n_iters) throw std::runtime_error("out of iterations");
+        broadcast(STEP);
+        ++current_step;
+        local_step();
+    }
+
+    void DistributedProblem::gather() {
+        broadcast(GATHER);
+        local_gather();
+    }
+
+    void DistributedProblem::finish() {
+        broadcast(STOP);
+        finished = true;
+    }
+
+    void DistributedProblem::follow() {
+        if (comm.rank() == 0) throw std::runtime_error("the rank 0 drives a distributed run, it does not follow");
+        for (;;) {
+            double code = 0;
+            comm.recv(0, &code, 1);
+            switch (static_cast<command>(static_cast<size_t>(code))) {
+                case STEP:
+                    ++current_step;
+                    local_step();
+                    break;
+                case GATHER:
+                    local_gather();
+                    break;
+                case STOP:
+                    return;
+                default:
+                    throw std::runtime_error("unknown command of the rank 0");
+            }
+        }
+    }
+
+    void DistributedProblem::local_step() {
+        PROF_SCOPE(STEP);
+        PROF_COUNT(STEPS, 1);
+        const size_t x_dim = m.x_dim(), n = interior_size();
+        const size_t r = comm.rank();
+
+        // rows of the strip, nothing to exchange
+        for (size_t y = first_row; y < last_row; ++y) {
+            const size_t offset = (y - first_row) * x_dim;
+            m.fill_x_rhs(y, 0, x_dim, line.data(), 1);
+            TDMA::solve_factorized(
+                x_dim, &rows.a[offset], &rows.c_star[offset], &rows.inv_pivot[offset],
+                line.data(), line.data());
+            m.scatter_x_line(y, 0, x_dim, line.data(), 1);
+        }
+        PROF_COUNT(LINES_SOLVED, last_row - first_row);
+
+        // interiors of the columns for the RHS alone
+        for (size_t x = 0; x < x_dim; ++x) {
+            const size_t offset = x * n;
+            m.fill_y_rhs(x, first_row, last_row, line.data(), 1);
+            TDMA::solve_factorized(
+                n, &cols.a[offset], &cols.c_star[offset], &cols.inv_pivot[offset],
+                &line[first_row], &y_local[offset]);
+            if (has_separator()) separator_d[x] = line[separator_row];
+        }
+
+        {
+            PROF_SCOPE(EXCHANGE);
+            if (r > 0) {
+                for (size_t x = 0; x < x_dim; ++x) {
+                    message[x] = y_local[x * n];
+                }
+                comm.send(r - 1, message.data(), x_dim);
+            }
+            if (has_separator()) {
+                comm.recv(r + 1, message.data(), x_dim);
+                for (size_t x = 0; x < x_dim; ++x) {
+                    const double y_last = y_local[x * n + n - 1];
+                    separator_d[x] = separator_d[x] - separator_a[x] * y_last - separator_c[x] * message[x];
+                }
+            }
+            solve_reduced();
+        }
+
+        // x = y + p * S_above + q * S_below
+        for (size_t x = 0; x < x_dim; ++x) {
+            const size_t offset = x * n;
+            for (size_t i = 0; i < n; ++i) {
+                line[first_row + i] = y_local[offset + i] + p[offset + i] * s_above[x] + q[offset + i] * s_below[x];
+            }
+            if (has_separator()) line[separator_row] = s_below[x];
+            m.scatter_y_line(x, first_row, last_row, line.data(), 1);
+        }
+        PROF_COUNT(LINES_SOLVED, x_dim);
+    }
+
+    void DistributedProblem::solve_reduced() {
+        const size_t x_dim = m.x_dim();
+        const size_t r = comm.rank(), n_ranks = comm.size();
+        if (n_ranks == 1) return;
+        if (r > 0) {
+            if (has_separator()) comm.send(0, separator_d.data(), x_dim);
+            comm.recv(0, message.data(), 2 * x_dim);
+            std::copy_n(message.begin(), x_dim, s_above.begin());
+            std::copy_n(message.begin() + x_dim, x_dim, s_below.begin());
+            return;
+        }
+
+        const size_t R = n_ranks - 1;
+        for (size_t j = 0; j < R; ++j) {
+            const double * d = separator_d.data();
+            if (j > 0) {
+                comm.recv(j, message.data(), x_dim);
+                d = message.data();
+            }
+            for (size_t x = 0; x < x_dim; ++x) {
+                reduced_d[x * R + j] = d[x];
+            }
+        }
+        for (size_t x = 0; x < x_dim; ++x) {
+            const size_t offset = x * R;
+            TDMA::solve_factorized(
+                R, &reduced.a[offset], &reduced.c_star[offset], &reduced.inv_pivot[offset],
+                &reduced_d[offset], &reduced_d[offset]);
+            s_below[x] = reduced_d[offset];
+        }
+        // rank j needs S_{j-1} and S_j, the last one has no S_j
+        for (size_t j = 1; j < n_ranks; ++j) {
+            for (size_t x = 0; x < x_dim; ++x) {
+                message[x] = reduced_d[x * R + j - 1];
+                message[x_dim + x] = j < R ? reduced_d[x * R + j] : 0.0;
+            }
+            comm.send(j, message.data(), 2 * x_dim);
+        }
+    }
+
+    void DistributedProblem::local_gather() {
+        const size_t x_dim = m.x_dim(), y_dim = m.y_dim();
+        const size_t r = comm.rank(), n_ranks = comm.size();
+        if (r > 0) {
+            comm.send(0, m.row(first_row).data(), (last_row - first_row) * x_dim);
+            return;
+        }
+        for (size_t j = 1; j < n_ranks; ++j) {
+            const Segment s = strip(y_dim, j, n_ranks);
+            comm.recv(j, m.row(s.first).data(), (s.last - s.first) * x_dim);
+        }
+    }
+}
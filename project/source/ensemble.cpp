@@ -0,0 +1,213 @@
+#include "ensemble.hpp"
+#include "profile.hpp"
+#include "solver.hpp"
+
+#include <algorithm>
+
+namespace solver {
+    // columns of a cache line of doubles
+    constexpr size_t COLUMN_BLOCK = 8;
+
+    Ensemble::Workspace::Workspace(const size_t x_dim, const size_t y_dim, const size_t width):
+        batched_x(x_dim, width),
+        batched_y(y_dim, width),
+        d_x(x_dim * width, 0),
+        f_x(x_dim * width, 0),
+        d_y(y_dim * width, 0),
+        f_y(y_dim * width, 0),
+        mx_x({diagonal(x_dim, 0), diagonal(x_dim, 0), diagonal(x_dim, 0), diagonal(x_dim, 0)}),
+        mx_y({diagonal(y_dim, 0), diagonal(y_dim, 0), diagonal(y_dim, 0), diagonal(y_dim, 0)}) {}
+
+    Ensemble::Ensemble(const Members & members, const size_t n_iters, const size_t n_threads):
+        n_iters(n_iters),
+        members(members) {
+        if (members.empty()) throw std::runtime_error("ensemble must have at least one member");
+        if (n_threads == 0) throw std::runtime_error("number of threads must be positive");
+        for (const model::Model79 * m: members) {
+            if (m == nullptr) throw std::runtime_error("ensemble member is missing");
+            if (m->x_dim() != x_dim() or m->y_dim() != y_dim())
+                throw std::runtime_error("ensemble members must share the mesh");
+            if (not std::equal(m->conditions().begin(), m->conditions().end(), members.front()->conditions().begin()))
+                throw std::runtime_error("ensemble members must share the geometry");
+        }
+        const size_t width = BatchedTDMA::native_width();
+        workspaces.reserve(n_threads);
+        for (size_t t = 0; t < n_threads; ++t) {
+            workspaces.emplace_back(x_dim(), y_dim(), width);
+        }
+        if (n_threads > 1) pool = std::make_unique<ThreadPool>(n_threads);
+        regroup();
+    }
+
+    bool Ensemble::stale() const {
+        for (size_t k = 0; k < members.size(); ++k) {
+            if (members[k]->revision() != revisions[k]) return true;
+        }
+        return false;
+    }
+
+    // the matrices only depend on the parameters and the splitting (the geometry is common),
+    // so the members with equal ones are solved against the same factorization
+    void Ensemble::regroup() {
+        PROF_SCOPE(FACTORIZE);
+        const auto same = [](const model::Parameters & l, const model::Parameters & r) {
+            return l.dt == r.dt and l.dx == r.dx and l.dy == r.dy and l.a == r.a;
+        };
+        const auto same_scheme = [&](const size_t k, const size_t l) {
+            return members[k]->scheme() == members[l]->scheme();
+        };
+        groups.clear();
+        revisions.resize(members.size());
+        for (size_t k = 0; k < members.size(); ++k) {
+            revisions[k] = members[k]->revision();
+            const model::Parameters p = members[k]->parameters();
+            const auto g = std::find_if(groups.begin(), groups.end(), [&](const Group & g) {
+                return same(members[g.members.front()]->parameters(), p) and same_scheme(g.members.front(), k);
+            });
+            if (g != groups.end()) g->members.push_back(k);
+            else groups.push_back({{k}, {}, {}, {}, {}});
+        }
+        for (Group & g: groups) factorize(g);
+    }
+
+    // same factorization and segments as the ones of the
+    // prefactorized Problem, made from the first member of the group
+    void Ensemble::factorize(Group & g) {
+        const model::Model79 & m = *members[g.members.front()];
+        const size_t x_dim = m.x_dim(), y_dim = m.y_dim();
+        Workspace & ws = workspaces.front();
+        g.rows = {diagonal(x_dim * y_dim), diagonal(x_dim * y_dim), diagonal(x_dim * y_dim)};
+        g.cols = {diagonal(x_dim * y_dim), diagonal(x_dim * y_dim), diagonal(x_dim * y_dim)};
+        g.segments_x = {{}, {0}};
+        g.segments_y = {{}, {0}};
+        for (size_t y = 0; y < y_dim; ++y) {
+            tridiagonal_mx_extended & mx = ws.mx_x;
+            m.fill_x_line(y, 0, x_dim, mx[0].data(), mx[1].data(), mx[2].data(), mx[3].data(), 1);
+            g.segments_x.add_line(mx, x_dim);
+            const size_t offset = y * x_dim;
+            std::copy(mx[0].cbegin(), mx[0].cend(), g.rows.a.begin() + offset);
+            TDMA::factorize(mx, &g.rows.c_star[offset], &g.rows.inv_pivot[offset]);
+        }
+        for (size_t x = 0; x < x_dim; ++x) {
+            tridiagonal_mx_extended & mx = ws.mx_y;
+            m.fill_y_line(x, 0, y_dim, mx[0].data(), mx[1].data(), mx[2].data(), mx[3].data(), 1);
+            g.segments_y.add_line(mx, y_dim);
+            const size_t offset = x * y_dim;
+            std::copy(mx[0].cbegin(), mx[0].cend(), g.cols.a.begin() + offset);
+            TDMA::factorize(mx, &g.cols.c_star[offset], &g.cols.inv_pivot[offset]);
+        }
+    }
+
+    template <typename Sweep>
+    void Ensemble::for_each_chunk(const size_t n, const Sweep & sweep) {
+        if (not pool) {
+            sweep(workspaces.front(), 0, n);
+            return;
+        }
+        const size_t n_threads = pool->size();
+        pool->run([&](const size_t t) {
+            const size_t first = t * n / n_threads;
+            const size_t last = (t + 1) * n / n_threads;
+            if (first < last) sweep(workspaces[t], first, last);
+        });
+    }
+
+    void Ensemble::step() {
+        if (current_step++ == n_iters) throw std::runtime_error("out of iterations");
+        PROF_SCOPE(STEP);
+        PROF_COUNT(STEPS, 1);
+        if (stale()) regroup();
+
+        // the row (column) of every member is solved before the next one,
+        // so that the lines of a batch are read from the members at once
+        // the ADI members evaluate the explicit part of a sweep first,
+        // see model::IModel::prepare_rhs()
+        const auto prepare = [&](const model::direction d) {
+            for_each_chunk(y_dim(), [&](Workspace &, const size_t first, const size_t last) {
+                for (model::Model79 * m: members) m->prepare_rhs(d, first, last);
+            });
+        };
+        prepare(model::HORIZONTAL);
+        for_each_chunk(y_dim(), [&](Workspace & ws, const size_t first, const size_t last) {
+            for (const Group & g: groups) solve_rows(ws, g, first, last);
+        });
+        prepare(model::VERTICAL);
+        for_each_chunk(x_dim(), [&](Workspace & ws, const size_t first, const size_t last) {
+            for (const Group & g: groups) solve_cols(ws, g, first, last);
+        });
+        for_each_chunk(y_dim(), [&](Workspace &, const size_t first, const size_t last) {
+            for (model::Model79 * m: members) m->restore_conditions(first, last);
+        });
+    }
+
+    // members k0 .. k0 + W - 1 of the group are packed into the lanes
+    // of a batch, lanes past the last member are left unread
+    void Ensemble::solve_rows(Workspace & ws, const Group & g, const size_t y_first, const size_t y_last) {
+        const size_t x_dim = this->x_dim();
+        const size_t W = ws.batched_x.lanes();
+
+        for (size_t y = y_first; y < y_last; ++y) {
+            for (size_t k0 = 0; k0 < g.members.size(); k0 += W) {
+                const size_t k1 = std::min(k0 + W, g.members.size());
+                for (const Segment * s = g.segments_x.begin(y); s != g.segments_x.end(y); ++s) {
+                    {
+                        PROF_SCOPE(ASSEMBLE_X);
+                        for (size_t k = k0; k < k1; ++k) {
+                            members[g.members[k]]->fill_x_rhs(y, s->first, s->last, &ws.d_x[k - k0], W);
+                        }
+                    }
+                    const size_t offset = y * x_dim;
+                    {
+                        PROF_SCOPE(SOLVE_X);
+                        ws.batched_x.solve_shared(
+                            &g.rows.a[offset], &g.rows.c_star[offset], &g.rows.inv_pivot[offset],
+                            ws.d_x, ws.f_x, s->first, s->last);
+                    }
+                    PROF_SCOPE(SCATTER_X);
+                    for (size_t k = k0; k < k1; ++k) {
+                        members[g.members[k]]->scatter_x_line(y, s->first, s->last, &ws.f_x[k - k0], W);
+                    }
+                    PROF_COUNT(NODES_UPDATED, (k1 - k0) * (s->last - s->first));
+                }
+            }
+        }
+        PROF_COUNT(LINES_SOLVED, (y_last - y_first) * g.members.size());
+    }
+
+    void Ensemble::solve_cols(Workspace & ws, const Group & g, const size_t x_first, const size_t x_last) {
+        const size_t y_dim = this->y_dim();
+        const size_t W = ws.batched_y.lanes();
+
+        // a batch of members walks COLUMN_BLOCK columns before the next
+        // batch does, so that the cache lines of a row are used up
+        for (size_t x0 = x_first; x0 < x_last; x0 += COLUMN_BLOCK) {
+            const size_t x1 = std::min(x0 + COLUMN_BLOCK, x_last);
+            for (size_t k0 = 0; k0 < g.members.size(); k0 += W) {
+                const size_t k1 = std::min(k0 + W, g.members.size());
+                for (size_t x = x0; x < x1; ++x) {
+                    for (const Segment * s = g.segments_y.begin(x); s != g.segments_y.end(x); ++s) {
+                        {
+                            PROF_SCOPE(ASSEMBLE_Y);
+                            for (size_t k = k0; k < k1; ++k) {
+                                members[g.members[k]]->fill_y_rhs(x, s->first, s->last, &ws.d_y[k - k0], W);
+                            }
+                        }
+                        const size_t offset = x * y_dim;
+                        {
+                            PROF_SCOPE(SOLVE_Y);
+                            ws.batched_y.solve_shared(
+                                &g.cols.a[offset], &g.cols.c_star[offset], &g.cols.inv_pivot[offset],
+                                ws.d_y, ws.f_y, s->first, s->last);
+                        }
+                        PROF_SCOPE(SCATTER_Y);
+                        for (size_t k = k0; k < k1; ++k) {
+                            members[g.members[k]]->scatter_y_line(x, s->first, s->last, &ws.f_y[k - k0], W);
+                        }
+                        PROF_COUNT(NODES_UPDATED, (k1 - k0) * (s->last - s->first));
+                    }
+                }
+            }
+        }
+        PROF_COUNT(LINES_SOLVED, (x_last - x_first) * g.members.size());
+    }
+}
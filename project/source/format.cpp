@@ -0,0 +1,61 @@
+#include "format.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace plt {
+    FieldFormatter::FieldFormatter(const NumberFormat & fmt): fmt(fmt) {
+        if (fmt.precision < 0) throw std::runtime_error("negative precision");
+    }
+
+    void FieldFormatter::reserve(const size_t n) {
+        if (buffer.size() - used >= n) return;
+        buffer.resize(std::max(buffer.size() * 2, used + n));
+    }
+
+    void FieldFormatter::append(std::string_view text) {
+        reserve(text.size());
+        std::memcpy(buffer.data() + used, text.data(), text.size());
+        used += text.size();
+    }
+
+    void FieldFormatter::append_value(const double value) {
+        const std::chars_format style = fmt.style == FIXED ? std::chars_format::fixed : std::chars_format::general;
+        for (;;) {
+            char * first = buffer.data() + used;
+            char * last = buffer.data() + buffer.size();
+            const auto result = std::to_chars(first, last, value, style, fmt.precision);
+            if (result.ec == std::errc()) {
+                used = static_cast<size_t>(result.ptr - buffer.data());
+                return;
+            }
+            // only huge values in the fixed notation end up here
+            reserve(buffer.size() + 64);
+        }
+    }
+
+    void FieldFormatter::append(util::strided_span<const double> field, const size_t width) {
+        if (width == 0 or field.size() % width != 0)
+            throw std::runtime_error("field size is not a multiple of the row width");
+
+        // a guess at the frame size which holds for the usual temperatures:
+        // a digit per significant digit plus the sign, the point, the exponent
+        // and the separator. Ensures a single reallocation for the first frame
+        const size_t per_value = static_cast<size_t>(fmt.precision) + (fmt.style == FIXED ? 8 : 9);
+        reserve(field.size() * per_value + field.size() / width);
+
+        for (size_t i = 0; i < field.size(); ++i) {
+            append_value(field[i]);
+            // room for the separators
+            reserve(2);
+            buffer[used++] = ' ';
+            if ((i + 1) % width == 0) buffer[used++] = '\n';
+        }
+    }
+
+    void FieldFormatter::write(FILE * stream) const {
+        if (used > 0 and std::fwrite(buffer.data(), 1, used, stream) != used)
+            throw std::runtime_error("failed to write the formatted field");
+    }
+}
@@ -1,7 +1,9 @@
 #include "model.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <map>
 
 /*
 *    in schematic, the geometry of the plate
@@ -40,21 +42,129 @@
 */
 
 namespace model {
-    void Model79::dump(std::ostream & os) const {
-        for (const auto & row: grid.nodes) {
-            for (const auto & e: row) {
-                os << e.current_value << ' ';
+    // bits of Grid::diffusion
+    constexpr uint8_t DIFFUSION_X = 1;
+    constexpr uint8_t DIFFUSION_Y = 2;
+
+    template <typename Real>
+    void BasicModel79<Real>::dump(std::ostream & os) const {
+        for (size_t y = 0; y < grid.height; ++y) {
+            for (const auto & e: row(y)) {
+                os << e << ' ';
             }
             os << '\n';
         }
     }
 
-    void Model79::throw_on_bounds(const size_t x, const size_t y) const {
+    template <typename Real>
+    util::strided_span<Real> BasicModel79<Real>::row(const size_t y) {
+        throw_on_bounds(0, y);
+        return {grid.values.data() + grid.index(0, y), grid.width};
+    }
+
+    template <typename Real>
+    util::strided_span<Real> BasicModel79<Real>::col(const size_t x) {
+        throw_on_bounds(x, 0);
+        return {grid.values.data() + x, grid.height, grid.width};
+    }
+
+    template <typename Real>
+    util::strided_span<const Real> BasicModel79<Real>::row(const size_t y) const {
+        throw_on_bounds(0, y);
+        return {grid.values.data() + grid.index(0, y), grid.width};
+    }
+
+    template <typename Real>
+    util::strided_span<const Real> BasicModel79<Real>::col(const size_t x) const {
+        throw_on_bounds(x, 0);
+        return {grid.values.data() + x, grid.height, grid.width};
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::set_parameters(const double dt, const double dx, const double dy, const double a) {
+        this->dt = dt;
+        this->dx = dx;
+        this->dy = dy;
+        this->a = a;
+        ++coefs_revision;
+        if (time_splitting == PEACEMAN_RACHFORD) classify();
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::set_scheme(const splitting s) {
+        time_splitting = s;
+        grid.rhs.resize(s == PEACEMAN_RACHFORD ? grid.values.size() : 0);
+        ++coefs_revision;
+        classify();
+    }
+
+    // b of a diffusion equation is 1 + 2R, of a condition 1
+    template <typename Real>
+    void BasicModel79<Real>::classify() {
+        grid.diffusion.clear();
+        grid.relaxed.clear();
+        if (time_splitting != PEACEMAN_RACHFORD) return;
+        grid.diffusion.resize(grid.values.size(), 0);
+        const size_t x_end = dims.first - 1, y_end = dims.second - 1;
+        for (size_t y = 0; y < dims.second; ++y) {
+            for (size_t x = 0; x < dims.first; ++x) {
+                const size_t i = grid.index(x, y);
+                uint8_t flags = 0;
+                if (x > 0 and x < x_end and x_coefs(x, y)[1] != 1.0) flags |= DIFFUSION_X;
+                if (y > 0 and y < y_end and y_coefs(x, y)[1] != 1.0) flags |= DIFFUSION_Y;
+                grid.diffusion[i] = flags;
+                const condition cond = grid.conditions[i];
+                if (flags == DIFFUSION_Y and cond != BOUNDARY_1TYPE and cond != OUTER_NODE) grid.relaxed.push_back(i);
+            }
+        }
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::set_boundary_temperatures(const BoundaryTemperatures & t) {
+        temperatures = t;
+        for (const auto & [i, on_floor]: grid.fixed) {
+            grid.values[i] = static_cast<Real>(on_floor ? t.floor : t.ceiling);
+        }
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::reset() {
+        std::fill(grid.values.begin(), grid.values.end(), Real(0));
+        set_boundary_temperatures(temperatures);
+    }
+
+    template <typename Real>
+    template <typename T>
+    void BasicModel79<Real>::load_values(util::strided_span<const T> values) {
+        if (values.size() != grid.values.size())
+            throw std::runtime_error("field size does not match the grid");
+        std::transform(values.begin(), values.end(), grid.values.begin(), [](const T v) { return static_cast<Real>(v); });
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::load_field(util::strided_span<const double> values) {
+        load_values(values);
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::load_field(util::strided_span<const float> values) {
+        load_values(values);
+    }
+
+    // the checks are only compiled into debug builds
+    template <typename Real>
+    void BasicModel79<Real>::throw_on_bounds(const size_t x, const size_t y) const {
+#ifndef NDEBUG
         if (x >= dims.first) throw std::runtime_error("X index exceeding grid bounds");
         if (y >= dims.second) throw std::runtime_error("Y index exceeding grid bounds");
+#else
+        (void) x;
+        (void) y;
+#endif
     }
 
-    void Model79::grid_set_up() {
+    template <typename Real>
+    void BasicModel79<Real>::grid_set_up() {
         const size_t x_dim = dims.first;
         const size_t y_dim = dims.second;
 
@@ -66,117 +176,129 @@ namespace model {
         const size_t y_hole_lower = y_dim * 1.5 / 5;
         const size_t y_hole_upper = y_dim * 3.5 / 5;
 
+        // fixed nodes are collected here first since
+        // some of them are assigned more than once
+        std::map<size_t, bool> fixed;
+
         // left side
         for (size_t i = 0; i < y_dim; ++i) {
-            grid.nodes[i][0].condition_type = BOUNDARY_2TYPE_X;
+            grid.at(0, i) = BOUNDARY_2TYPE_X;
         }
 
         // floor
         for (size_t i = 0; i < x_dim; ++i) {
-            grid.nodes[y_dim - 1][i].condition_type = BOUNDARY_1TYPE;
-            grid.nodes[y_dim - 1][i].current_value = T_FLOOR;
-            grid.nodes[y_dim - 1][i].initial_value = T_FLOOR;
+            grid.at(i, y_dim - 1) = BOUNDARY_1TYPE;
+            fixed[grid.index(i, y_dim - 1)] = true;
         }
 
         // ceiling
         for (size_t i = 0; i < x_half; ++i) {
-            grid.nodes[0][i].condition_type = BOUNDARY_1TYPE;
-            grid.nodes[0][i].current_value = T_CEIL;
-            grid.nodes[0][i].initial_value = T_CEIL;
+            grid.at(i, 0) = BOUNDARY_1TYPE;
+            fixed[grid.index(i, 0)] = false;
         }
 
         // right side
         for (size_t i = 0; i < x_half; ++i) {
             // nodes to the right to the inclined side
             for (size_t j = i; j < y_dim; ++j) {
-                grid.nodes[y_dim - j - 1][x_dim - i - 1].condition_type = OUTER_NODE;
+                grid.at(x_dim - i - 1, y_dim - j - 1) = OUTER_NODE;
             }
-            grid.nodes[x_half - i - 1][x_dim - i - 1].condition_type = BOUNDARY_1TYPE;
-            grid.nodes[x_half - i - 1][x_dim - i - 1].current_value = T_CEIL;
-            grid.nodes[x_half - i - 1][x_dim - i - 1].initial_value = T_CEIL;
+            grid.at(x_dim - i - 1, x_half - i - 1) = BOUNDARY_1TYPE;
+            fixed[grid.index(x_dim - i - 1, x_half - i - 1)] = false;
         }
 
         // hole
         for (size_t i = x_hole_left + 1; i < x_hole_right; ++i) {
             for (size_t j = y_hole_lower + 1; j < y_hole_upper; ++j) {
                 // nodes inside the hole are marked as outer
-                grid.nodes[j][i].condition_type = OUTER_NODE;
+                grid.at(i, j) = OUTER_NODE;
             }
         }
         for (size_t i = x_hole_left + 1; i < x_hole_right; ++i) {
-            grid.nodes[y_hole_lower][i].condition_type = BOUNDARY_3TYPE_Y;
-            grid.nodes[y_hole_upper][i].condition_type = BOUNDARY_3TYPE_Y;
+            grid.at(i, y_hole_lower) = BOUNDARY_3TYPE_Y;
+            grid.at(i, y_hole_upper) = BOUNDARY_3TYPE_Y;
         }
         for (size_t i = y_hole_lower + 1; i < y_hole_upper; ++i) {
-            grid.nodes[i][x_hole_left].condition_type = BOUNDARY_3TYPE_X;
-            grid.nodes[i][x_hole_right].condition_type = BOUNDARY_3TYPE_X;
+            grid.at(x_hole_left, i) = BOUNDARY_3TYPE_X;
+            grid.at(x_hole_right, i) = BOUNDARY_3TYPE_X;
         }
 
         // corner nodes
-        grid.nodes[y_hole_upper][x_hole_left].condition_type = BOUNDARY_3TYPE_XY;
-        grid.nodes[y_hole_upper][x_hole_right].condition_type = BOUNDARY_3TYPE_XY;
-        grid.nodes[y_hole_lower][x_hole_right].condition_type = BOUNDARY_3TYPE_XY;
-        grid.nodes[y_hole_lower][x_hole_left].condition_type = BOUNDARY_3TYPE_XY;
+        grid.at(x_hole_left, y_hole_upper) = BOUNDARY_3TYPE_XY;
+        grid.at(x_hole_right, y_hole_upper) = BOUNDARY_3TYPE_XY;
+        grid.at(x_hole_right, y_hole_lower) = BOUNDARY_3TYPE_XY;
+        grid.at(x_hole_left, y_hole_lower) = BOUNDARY_3TYPE_XY;
+
+        grid.fixed.assign(fixed.cbegin(), fixed.cend());
+        reset();
     }
 
-    bool Model79::is_inner(const size_t x, const size_t y) const {
+    template <typename Real>
+    bool BasicModel79<Real>::is_inner(const size_t x, const size_t y) const {
         throw_on_bounds(x, y);
-        return not (grid.nodes[y][x].condition_type == OUTER_NODE);
+        return not (grid.at(x, y) == OUTER_NODE);
     }
 
-    void Model79::set_current_value(const size_t x, const size_t y, const double value) {
+    template <typename Real>
+    void BasicModel79<Real>::set_current_value(const size_t x, const size_t y, const double value) {
         throw_on_bounds(x, y);
-        const condition cond = grid.nodes[y][x].condition_type;
+        const condition cond = grid.at(x, y);
         if (cond == BOUNDARY_1TYPE or cond == OUTER_NODE) return;
-        grid.nodes[y][x].current_value = value;
+        grid.values[grid.index(x, y)] = static_cast<Real>(value);
     }
 
-    double Model79::get_RHS_coefs_x(const size_t x, const size_t y) const {
-        throw_on_bounds(x, y);
-        const Node grid_node = grid.nodes[y][x];
+    template <typename Real>
+    double BasicModel79<Real>::rhs_x(const size_t x, const size_t y) const {
+        const size_t i = grid.index(x, y);
 
-        switch (grid_node.condition_type) {
+        switch (grid.conditions[i]) {
+            // outer and 1st type nodes are never updated
+            // and keep their initial values
             case OUTER_NODE:
-                return grid_node.initial_value;
+                return grid.values[i];
             case BOUNDARY_2TYPE_X:
             case BOUNDARY_3TYPE_X:
                 return 0;
             case BOUNDARY_3TYPE_XY:
             case BOUNDARY_2TYPE_Y:
             case BOUNDARY_3TYPE_Y:
-            case BOUNDARY_1TYPE:
             case NO_CONDITION:
-                return grid_node.current_value;
+                return node_rhs(i);
+            case BOUNDARY_1TYPE:
+                return grid.values[i];
             default:
                 throw std::runtime_error("unknown condition type");
         }
     }
 
-    double Model79::get_RHS_coefs_y(const size_t x, const size_t y) const {
-        throw_on_bounds(x, y);
-        const Node grid_node = grid.nodes[y][x];
+    template <typename Real>
+    double BasicModel79<Real>::rhs_y(const size_t x, const size_t y) const {
+        const size_t i = grid.index(x, y);
 
-        switch (grid_node.condition_type) {
+        switch (grid.conditions[i]) {
+            // outer and 1st type nodes are never updated
+            // and keep their initial values
             case OUTER_NODE:
-                return grid_node.initial_value;
+                return grid.values[i];
             case BOUNDARY_2TYPE_Y:
             case BOUNDARY_3TYPE_Y:
                 return 0;
             case BOUNDARY_3TYPE_XY:
             case BOUNDARY_2TYPE_X:
             case BOUNDARY_3TYPE_X:
-            case BOUNDARY_1TYPE:
             case NO_CONDITION:
-                return grid_node.current_value;
+                return node_rhs(i);
+            case BOUNDARY_1TYPE:
+                return grid.values[i];
             default:
                 throw std::runtime_error("unknown condition type");
         }
     }
 
-    tridiag_coefs Model79::get_x_coefs(const size_t x, const size_t y) const {
-        throw_on_bounds(x, y);
-        const double R = a * dt / (dx * dx);    // needed for nodes with no boundary
-        const condition cond = grid.nodes[y][x].condition_type;
+    template <typename Real>
+    tridiag_coefs BasicModel79<Real>::x_coefs(const size_t x, const size_t y) const {
+        const double R = implicit_weight() * a * dt / (dx * dx);    // needed for nodes with no boundary
+        const condition cond = grid.at(x, y);
 
         switch (cond) {
             // must be constant value
@@ -185,11 +307,11 @@ namespace model {
                 return {0, 1.0, 0};
             case BOUNDARY_3TYPE_XY:
             case BOUNDARY_3TYPE_X: {
-                if (grid.nodes[y][x + 1].condition_type == NO_CONDITION) {
+                if (grid.at(x + 1, y) == NO_CONDITION) {
                     const double c = (-1.0) / (1.0 + dx);
                     return {c, 1.0, 0};
                 }
-                if (grid.nodes[y][x - 1].condition_type == NO_CONDITION) {
+                if (grid.at(x - 1, y) == NO_CONDITION) {
                     const double c = (-1.0) / (1.0 + dx);
                     return {0, 1.0, c};
                 }
@@ -204,10 +326,10 @@ namespace model {
         }
     }
 
-    tridiag_coefs Model79::get_y_coefs(const size_t x, const size_t y) const {
-        throw_on_bounds(x, y);
-        const double R = a * dt / (dy * dy);
-        const condition cond = grid.nodes[y][x].condition_type;
+    template <typename Real>
+    tridiag_coefs BasicModel79<Real>::y_coefs(const size_t x, const size_t y) const {
+        const double R = implicit_weight() * a * dt / (dy * dy);
+        const condition cond = grid.at(x, y);
 
         switch (cond) {
             // must be constant value
@@ -220,11 +342,11 @@ namespace model {
                 // are only defined at inner nodes -> if one has these at the edge
                 // of the mesh, it is a good idea to bound-check the axis first
                 // in order to avoid segfaults
-                if (grid.nodes[y + 1][x].condition_type == NO_CONDITION) {
+                if (grid.at(x, y + 1) == NO_CONDITION) {
                     const double c = (-1.0) / (1.0 + dx);
                     return {c, 1.0, 0};
                 }
-                if (grid.nodes[y - 1][x].condition_type == NO_CONDITION) {
+                if (grid.at(x, y - 1) == NO_CONDITION) {
                     const double c = (-1.0) / (1.0 + dx);
                     return {0, 1.0, c};
                 }
@@ -242,27 +364,395 @@ namespace model {
         }
     }
 
+    template <typename Real>
+    double BasicModel79<Real>::get_RHS_coefs_x(const size_t x, const size_t y) const {
+        throw_on_bounds(x, y);
+        return rhs_x(x, y);
+    }
+
+    template <typename Real>
+    double BasicModel79<Real>::get_RHS_coefs_y(const size_t x, const size_t y) const {
+        throw_on_bounds(x, y);
+        return rhs_y(x, y);
+    }
+
+    template <typename Real>
+    tridiag_coefs BasicModel79<Real>::get_x_coefs(const size_t x, const size_t y) const {
+        throw_on_bounds(x, y);
+        return x_coefs(x, y);
+    }
+
+    template <typename Real>
+    tridiag_coefs BasicModel79<Real>::get_y_coefs(const size_t x, const size_t y) const {
+        throw_on_bounds(x, y);
+        return y_coefs(x, y);
+    }
+
+    // the time steps solve (1 - a * dt * L) along the lines, every line
+    // equation is either such a diffusion one or a boundary condition
+    // (of the 1st, 2nd or 3rd type) the sweep imposes. At equilibrium
+    // the diffusion parts add up to the Laplacian and the conditions hold
+    // as they are; of a node constrained along both axes the y condition
+    // is kept as the y-sweep is the last one of a step. The conditions are
+    // homogeneous in this setup and are scaled to the diagonal of the
+    // Laplacian, so that all the equations weigh alike
+    template <typename Real>
+    StationaryRow BasicModel79<Real>::stationary_row(const size_t x, const size_t y) const {
+        throw_on_bounds(x, y);
+        const size_t i = grid.index(x, y);
+        const condition cond = grid.conditions[i];
+        if (cond == BOUNDARY_1TYPE or cond == OUTER_NODE) return {1.0, 0, 0, 0, 0, grid.values[i]};
+
+        // same coefficients as the ones fill_x_line() and fill_y_line() produce
+        tridiag_coefs tx, ty;
+        if (x == 0) {
+            const boundary_coefs bc = get_x_first_coefs(y);
+            tx = {0, bc[0], bc[1]};
+        } else if (x == dims.first - 1) {
+            const boundary_coefs bc = get_x_last_coefs(y);
+            tx = {bc[0], bc[1], 0};
+        } else {
+            tx = x_coefs(x, y);
+        }
+        if (y == 0) {
+            const boundary_coefs bc = get_y_first_coefs(x);
+            ty = {0, bc[0], bc[1]};
+        } else if (y == dims.second - 1) {
+            const boundary_coefs bc = get_y_last_coefs(x);
+            ty = {bc[0], bc[1], 0};
+        } else {
+            ty = y_coefs(x, y);
+        }
+
+        const double Rx = implicit_weight() * a * dt / (dx * dx);
+        const double Ry = implicit_weight() * a * dt / (dy * dy);
+        const bool x_diffusion = tx[0] == -Rx and tx[2] == -Rx;
+        const bool y_diffusion = ty[0] == -Ry and ty[2] == -Ry;
+        const double wx = 1.0 / (dx * dx);
+        const double wy = 1.0 / (dy * dy);
+        const double diag = 2.0 * (wx + wy);
+
+        if (x_diffusion and y_diffusion) return {diag, -wx, -wx, -wy, -wy, 0.0};
+        if (not y_diffusion) {
+            const double s = diag / ty[1];
+            return {diag, 0, 0, ty[0] * s, ty[2] * s, 0.0};
+        }
+        const double s = diag / tx[1];
+        return {diag, tx[0] * s, tx[2] * s, 0, 0, 0.0};
+    }
+
+    // T + (1 - weight) * a * dt * L T across the lines of the sweep, where L
+    // is the second difference of the diffusion equations of the other sweep
+    // (a node that is a boundary condition along the other axis is left as
+    // it is, that sweep imposes the condition). 1st type and outer nodes are
+    // copied, they are never read as the RHS of a diffusion equation anyway
+    template <typename Real>
+    void BasicModel79<Real>::prepare_rhs(const direction d, const size_t y_first, const size_t y_last) {
+        if (time_splitting != PEACEMAN_RACHFORD) return;
+        const bool across_y = d == HORIZONTAL;
+        const double R = (1.0 - implicit_weight()) * a * dt / (across_y ? dy * dy : dx * dx);
+        const size_t step = across_y ? grid.width : 1;
+        const uint8_t flag = across_y ? DIFFUSION_Y : DIFFUSION_X;
+        const Real * T = grid.values.data();
+        Real * rhs = grid.rhs.data();
+        for (size_t i = y_first * grid.width; i < y_last * grid.width; ++i) {
+            rhs[i] = grid.diffusion[i] & flag
+                ? static_cast<Real>(T[i] + R * (T[i - step] - 2.0 * T[i] + T[i + step]))
+                : T[i];
+        }
+    }
+
+    // a condition of the x-sweep reads the nodes next to it along x,
+    // none of which is such a condition itself, so the rows are independent
+    template <typename Real>
+    void BasicModel79<Real>::restore_conditions(const size_t y_first, const size_t y_last) {
+        if (time_splitting != PEACEMAN_RACHFORD) return;
+        const size_t x_end = dims.first - 1;
+        const auto first = std::lower_bound(grid.relaxed.cbegin(), grid.relaxed.cend(), grid.index(0, y_first));
+        const auto last = std::lower_bound(first, grid.relaxed.cend(), grid.index(0, y_last));
+        for (auto it = first; it != last; ++it) {
+            const size_t i = *it;
+            const size_t x = i % grid.width, y = i / grid.width;
+            tridiag_coefs tc;
+            if (x == 0) {
+                const boundary_coefs bc = get_x_first_coefs(y);
+                tc = {0, bc[0], bc[1]};
+            } else if (x == x_end) {
+                const boundary_coefs bc = get_x_last_coefs(y);
+                tc = {bc[0], bc[1], 0};
+            } else {
+                tc = x_coefs(x, y);
+            }
+            double sum = rhs_x(x, y);
+            if (tc[0] != 0) sum -= tc[0] * grid.values[i - 1];
+            if (tc[2] != 0) sum -= tc[2] * grid.values[i + 1];
+            grid.values[i] = static_cast<Real>(sum / tc[1]);
+        }
+    }
+
+    // the bulk methods below are what the solver calls in its inner loops:
+    // one call per line, no per-node bounds checks and the
+    // per-node kernels above are inlined into the loops.
+    // The equations of the edges come from the boundary coefficients
+    template <typename Real>
+    template <typename T>
+    void BasicModel79<Real>::fill_x_line(
+        const size_t y, const size_t first, const size_t last,
+        T * a, T * b, T * c, T * d,
+        const size_t stride
+    ) const {
+        throw_on_bounds(0, y);
+        const size_t end = dims.first - 1;
+        size_t x = first;
+
+        if (x == 0 and x < last) {
+            // the fixed corners are pinned rather than given the flux
+            // condition of the edge, so that they keep their values
+            const condition cond = grid.at(0, y);
+            const bool fixed = cond == BOUNDARY_1TYPE or cond == OUTER_NODE;
+            const boundary_coefs bc = fixed ? boundary_coefs{1.0, 0.0} : get_x_first_coefs(y);
+            a[0] = 0;
+            b[0] = bc[0];
+            c[0] = bc[1];
+            d[0] = rhs_x(0, y);
+            ++x;
+        }
+
+        for (; x < std::min(last, end); ++x) {
+            const tridiag_coefs tc = x_coefs(x, y);
+            a[x * stride] = tc[0];
+            b[x * stride] = tc[1];
+            c[x * stride] = tc[2];
+            d[x * stride] = rhs_x(x, y);
+        }
+
+        if (x == end and x < last) {
+            const boundary_coefs bc = get_x_last_coefs(y);
+            a[end * stride] = bc[0];
+            b[end * stride] = bc[1];
+            c[end * stride] = 0;
+            d[end * stride] = rhs_x(end, y);
+        }
+    }
+
+    template <typename Real>
+    template <typename T>
+    void BasicModel79<Real>::fill_y_line(
+        const size_t x, const size_t first, const size_t last,
+        T * a, T * b, T * c, T * d,
+        const size_t stride
+    ) const {
+        throw_on_bounds(x, 0);
+        const size_t end = dims.second - 1;
+        size_t y = first;
+
+        if (y == 0 and y < last) {
+            const boundary_coefs bc = get_y_first_coefs(x);
+            a[0] = 0;
+            b[0] = bc[0];
+            c[0] = bc[1];
+            d[0] = rhs_y(x, 0);
+            ++y;
+        }
+
+        for (; y < std::min(last, end); ++y) {
+            const tridiag_coefs tc = y_coefs(x, y);
+            a[y * stride] = tc[0];
+            b[y * stride] = tc[1];
+            c[y * stride] = tc[2];
+            d[y * stride] = rhs_y(x, y);
+        }
+
+        if (y == end and y < last) {
+            const boundary_coefs bc = get_y_last_coefs(x);
+            a[end * stride] = bc[0];
+            b[end * stride] = bc[1];
+            c[end * stride] = 0;
+            d[end * stride] = rhs_y(x, end);
+        }
+    }
+
+    template <typename Real>
+    template <typename T>
+    void BasicModel79<Real>::fill_x_rhs(const size_t y, const size_t first, const size_t last, T * d, const size_t stride) const {
+        throw_on_bounds(0, y);
+        for (size_t x = first; x < last; ++x) {
+            d[x * stride] = rhs_x(x, y);
+        }
+    }
+
+    template <typename Real>
+    template <typename T>
+    void BasicModel79<Real>::fill_y_rhs(const size_t x, const size_t first, const size_t last, T * d, const size_t stride) const {
+        throw_on_bounds(x, 0);
+        for (size_t y = first; y < last; ++y) {
+            d[y * stride] = rhs_y(x, y);
+        }
+    }
+
+    // 1st type and outer nodes keep their values, same as in set_current_value()
+    template <typename Real>
+    template <typename T>
+    void BasicModel79<Real>::scatter_x_line(const size_t y, const size_t first, const size_t last, const T * f, const size_t stride) {
+        throw_on_bounds(0, y);
+        const size_t offset = grid.index(0, y);
+        for (size_t x = first; x < last; ++x) {
+            const condition cond = grid.conditions[offset + x];
+            if (cond == BOUNDARY_1TYPE or cond == OUTER_NODE) continue;
+            grid.values[offset + x] = f[x * stride];
+        }
+    }
+
+    template <typename Real>
+    template <typename T>
+    void BasicModel79<Real>::scatter_y_line(const size_t x, const size_t first, const size_t last, const T * f, const size_t stride) {
+        throw_on_bounds(x, 0);
+        for (size_t y = first; y < last; ++y) {
+            const size_t i = grid.index(x, y);
+            const condition cond = grid.conditions[i];
+            if (cond == BOUNDARY_1TYPE or cond == OUTER_NODE) continue;
+            grid.values[i] = f[y * stride];
+        }
+    }
+
+    // nodes are transposed in TILE x TILE squares: TILE rows of the field
+    // and TILE columns of the block both fit into L1
+    constexpr size_t TILE = 32;
+
+    template <typename Real>
+    template <typename T>
+    void BasicModel79<Real>::fill_y_rhs_block(const size_t x_first, const size_t x_last, T * d, const size_t ld) const {
+        if (x_first >= x_last) return;
+        throw_on_bounds(x_last - 1, 0);
+        for (size_t y0 = 0; y0 < dims.second; y0 += TILE) {
+            const size_t y1 = std::min(y0 + TILE, dims.second);
+            for (size_t x0 = x_first; x0 < x_last; x0 += TILE) {
+                const size_t x1 = std::min(x0 + TILE, x_last);
+                for (size_t y = y0; y < y1; ++y) {
+                    for (size_t x = x0; x < x1; ++x) {
+                        d[(x - x_first) * ld + y] = rhs_y(x, y);
+                    }
+                }
+            }
+        }
+    }
+
+    template <typename Real>
+    template <typename T>
+    void BasicModel79<Real>::scatter_y_block(const size_t x_first, const size_t x_last, const T * f, const size_t ld) {
+        if (x_first >= x_last) return;
+        throw_on_bounds(x_last - 1, 0);
+        for (size_t y0 = 0; y0 < dims.second; y0 += TILE) {
+            const size_t y1 = std::min(y0 + TILE, dims.second);
+            for (size_t x0 = x_first; x0 < x_last; x0 += TILE) {
+                const size_t x1 = std::min(x0 + TILE, x_last);
+                for (size_t y = y0; y < y1; ++y) {
+                    for (size_t x = x0; x < x1; ++x) {
+                        const size_t i = grid.index(x, y);
+                        const condition cond = grid.conditions[i];
+                        if (cond == BOUNDARY_1TYPE or cond == OUTER_NODE) continue;
+                        grid.values[i] = f[(x - x_first) * ld + y];
+                    }
+                }
+            }
+        }
+    }
+
+    template <typename Real>
+    template <typename T>
+    void BasicModel79<Real>::fill_y_rhs_tile(
+        const size_t y_first, const size_t y_last,
+        const size_t x_first, const size_t x_last, T * d, const size_t ld
+    ) const {
+        if (y_first >= y_last or x_first >= x_last) return;
+        throw_on_bounds(x_last - 1, y_last - 1);
+        for (size_t y = y_first; y < y_last; ++y) {
+            for (size_t x = x_first; x < x_last; ++x) {
+                d[y * ld + x] = rhs_y(x, y);
+            }
+        }
+    }
+
+    // the IModel interface passes the lines in double
+    template <typename Real>
+    void BasicModel79<Real>::fill_x_line(
+        const size_t y, const size_t first, const size_t last,
+        double * a, double * b, double * c, double * d, const size_t stride
+    ) const {
+        fill_x_line<double>(y, first, last, a, b, c, d, stride);
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::fill_y_line(
+        const size_t x, const size_t first, const size_t last,
+        double * a, double * b, double * c, double * d, const size_t stride
+    ) const {
+        fill_y_line<double>(x, first, last, a, b, c, d, stride);
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::fill_x_rhs(const size_t y, const size_t first, const size_t last, double * d, const size_t stride) const {
+        fill_x_rhs<double>(y, first, last, d, stride);
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::fill_y_rhs(const size_t x, const size_t first, const size_t last, double * d, const size_t stride) const {
+        fill_y_rhs<double>(x, first, last, d, stride);
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::scatter_x_line(const size_t y, const size_t first, const size_t last, const double * f, const size_t stride) {
+        scatter_x_line<double>(y, first, last, f, stride);
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::scatter_y_line(const size_t x, const size_t first, const size_t last, const double * f, const size_t stride) {
+        scatter_y_line<double>(x, first, last, f, stride);
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::fill_y_rhs_block(const size_t x_first, const size_t x_last, double * d, const size_t ld) const {
+        fill_y_rhs_block<double>(x_first, x_last, d, ld);
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::scatter_y_block(const size_t x_first, const size_t x_last, const double * f, const size_t ld) {
+        scatter_y_block<double>(x_first, x_last, f, ld);
+    }
+
+    template <typename Real>
+    void BasicModel79<Real>::fill_y_rhs_tile(
+        const size_t y_first, const size_t y_last,
+        const size_t x_first, const size_t x_last, double * d, const size_t ld
+    ) const {
+        fill_y_rhs_tile<double>(y_first, y_last, x_first, x_last, d, ld);
+    }
+
     // numeration order is as follows:
     // upmost nodes = 0, lowest nodes = x_max, leftmost nodes = 0, rightmost_nodes = y_max
     // these functions would only apply to my particular problem
-    boundary_coefs Model79::get_x_last_coefs(const size_t x) const {
+    template <typename Real>
+    boundary_coefs BasicModel79<Real>::get_x_last_coefs(const size_t x) const {
         throw_on_bounds(x, 0);
         return {0, 1.0};
     }
 
-    boundary_coefs Model79::get_x_first_coefs(const size_t y) const {
+    template <typename Real>
+    boundary_coefs BasicModel79<Real>::get_x_first_coefs(const size_t y) const {
         throw_on_bounds(0, y);
         // in this case, the 2 TYPE boundary is defined on the
         // leftmost side of the plate  
         return {-1.0, 1.0};
     }
 
-    boundary_coefs Model79::get_y_last_coefs(const size_t x) const {
+    template <typename Real>
+    boundary_coefs BasicModel79<Real>::get_y_last_coefs(const size_t x) const {
         throw_on_bounds(x, 0);
         return {0.0, 1.0};
     }
 
-    boundary_coefs Model79::get_y_first_coefs(const size_t x) const {
+    template <typename Real>
+    boundary_coefs BasicModel79<Real>::get_y_first_coefs(const size_t x) const {
         throw_on_bounds(x, 0);
         return {1.0, 0.0};
     }
@@ -294,9 +784,22 @@ namespace model {
         const size_t y_dim = m.y_dim();
         for (size_t i = 0; i < y_dim; ++i) {
             for (size_t j = 0; j < x_dim; ++j) {
-                out << cond_to_symbol(m.grid.nodes[i][j].condition_type) << ' ';
+                out << cond_to_symbol(m.conditions()[i * x_dim + j]) << ' ';
             }
             out << '\n';
         }
     }
+
+    template class BasicModel79<double>;
+    template class BasicModel79<float>;
+    // float lines of the float field, see solver::BasicProblem
+    template void Model79f::fill_x_line<float>(const size_t, const size_t, const size_t, float *, float *, float *, float *, const size_t) const;
+    template void Model79f::fill_y_line<float>(const size_t, const size_t, const size_t, float *, float *, float *, float *, const size_t) const;
+    template void Model79f::fill_x_rhs<float>(const size_t, const size_t, const size_t, float *, const size_t) const;
+    template void Model79f::fill_y_rhs<float>(const size_t, const size_t, const size_t, float *, const size_t) const;
+    template void Model79f::scatter_x_line<float>(const size_t, const size_t, const size_t, const float *, const size_t);
+    template void Model79f::scatter_y_line<float>(const size_t, const size_t, const size_t, const float *, const size_t);
+    template void Model79f::fill_y_rhs_block<float>(const size_t, const size_t, float *, const size_t) const;
+    template void Model79f::scatter_y_block<float>(const size_t, const size_t, const float *, const size_t);
+    template void Model79f::fill_y_rhs_tile<float>(const size_t, const size_t, const size_t, const size_t, float *, const size_t) const;
 }
@@ -0,0 +1,445 @@
+#include "multigrid.hpp"
+#include "solver.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace solver {
+    // the grids are coarsened as long as both sides have at least that many
+    // nodes, the coarsest one (a few dozen nodes for the 2:1 plate) is solved
+    // by a dense LU, which the cap keeps within 32 KiB
+    constexpr size_t MIN_COARSE_SIDE = 5;
+    constexpr size_t MAX_COARSEST_NODES = 64;
+    constexpr size_t COLUMN_BLOCK = 16;
+
+    using stencil_type = std::array<double, 9>;
+
+    double MultigridStats::convergence_factor() const {
+        if (cycles == 0 or initial_residual == 0.0) return 0.0;
+        return std::pow(residual / initial_residual, 1.0 / static_cast<double>(cycles));
+    }
+
+    // coarse unknowns the correction of fine node (x, y) is interpolated
+    // from: bilinear weights of the one it coincides with or the two (four)
+    // it lies in between, the fixed coarse nodes contribute nothing
+    size_t Multigrid::parents(const Level & coarse, const size_t x, const size_t y, size_t index[4], double weight[4]) {
+        const size_t x0 = x / 2, x1 = x0 + x % 2;
+        const size_t y0 = y / 2, y1 = y0 + y % 2;
+        const double wx = x % 2 ? 0.5 : 1.0;
+        const double wy = y % 2 ? 0.5 : 1.0;
+        size_t n = 0;
+        for (size_t cy = y0; cy <= y1; ++cy) {
+            for (size_t cx = x0; cx <= x1; ++cx) {
+                const size_t i = coarse.index(cx, cy);
+                if (not coarse.unknown[i]) continue;
+                index[n] = i;
+                weight[n] = wx * wy;
+                ++n;
+            }
+        }
+        return n;
+    }
+
+    // d[i] -= s[i][k] * v[i - 1] + s[i][k + 1] * v[i] + s[i][k + 2] * v[i + 1]
+    // for the stencil entries k, k + 1, k + 2 of one row of neighbours,
+    // the coefficients pointing past the ends of the line are zero
+    static void subtract_line(double * d, const stencil_type * s, const size_t k, const double * v, const size_t n) {
+        if (n == 1) {
+            d[0] -= s[0][k + 1] * v[0];
+            return;
+        }
+        d[0] -= s[0][k + 1] * v[0] + s[0][k + 2] * v[1];
+        for (size_t i = 1; i < n - 1; ++i) {
+            d[i] -= s[i][k] * v[i - 1] + s[i][k + 1] * v[i] + s[i][k + 2] * v[i + 1];
+        }
+        d[n - 1] -= s[n - 1][k] * v[n - 2] + s[n - 1][k + 1] * v[n - 1];
+    }
+
+    static void allocate(
+        std::vector<stencil_type> & stencil, std::vector<uint8_t> & unknown,
+        diagonal & u, diagonal & f, diagonal & r, const size_t n
+    ) {
+        stencil.assign(n, stencil_type{});
+        unknown.assign(n, 0);
+        u.assign(n, 0.0);
+        f.assign(n, 0.0);
+        r.assign(n, 0.0);
+    }
+
+    Multigrid::Multigrid(model::Model79 & model, const MultigridOptions & options):
+        m(model),
+        opts(options) {
+        if (opts.n_threads == 0) throw std::runtime_error("number of threads must be positive");
+        if (opts.tolerance <= 0.0) throw std::runtime_error("tolerance must be positive");
+        if (opts.n_threads > 1) pool = std::make_unique<ThreadPool>(opts.n_threads);
+        scratch.assign(opts.n_threads, diagonal(std::max(m.x_dim(), COLUMN_BLOCK * m.y_dim()), 0.0));
+        build();
+    }
+
+    void Multigrid::build() {
+        PROF_SCOPE(FACTORIZE);
+        levels.clear();
+        levels.emplace_back();
+        build_fine(levels.front());
+        while (std::min(levels.back().width, levels.back().height) >= MIN_COARSE_SIDE) {
+            Level coarse;
+            build_coarse(levels.back(), coarse);
+            levels.push_back(std::move(coarse));
+        }
+        if (levels.back().size() > MAX_COARSEST_NODES)
+            throw std::runtime_error("mesh is too elongated for the coarsest grid to be solved directly");
+        for (size_t l = 0; l + 1 < levels.size(); ++l) factorize_lines(levels[l]);
+        factorize_coarsest();
+        built_revision = m.revision();
+    }
+
+    void Multigrid::build_fine(Level & fine) const {
+        const size_t w = m.x_dim(), h = m.y_dim();
+        fine.width = w;
+        fine.height = h;
+        allocate(fine.stencil, fine.unknown, fine.u, fine.f, fine.r, w * h);
+
+        const util::strided_span<const model::condition> conditions = m.conditions();
+        for (size_t y = 0; y < h; ++y) {
+            for (size_t x = 0; x < w; ++x) {
+                const size_t i = fine.index(x, y);
+                const model::StationaryRow row = m.stationary_row(x, y);
+                fine.stencil[i][4] = row.center;
+                if (x > 0) fine.stencil[i][3] = row.west;
+                if (x + 1 < w) fine.stencil[i][5] = row.east;
+                if (y > 0) fine.stencil[i][1] = row.north;
+                if (y + 1 < h) fine.stencil[i][7] = row.south;
+                fine.f[i] = row.rhs;
+                fine.unknown[i] = conditions[i] != model::BOUNDARY_1TYPE and conditions[i] != model::OUTER_NODE;
+            }
+        }
+    }
+
+    // a coarse node is an unknown if the fine node it coincides with is,
+    // A_c = P^T A P is accumulated over the couplings of the fine unknowns:
+    // fine node i is interpolated from coarse node C, its neighbour j from D,
+    // so that A[i][j] contributes to A_c[C][D]. Fixed nodes take no
+    // corrections (their rows of P are zero) and are left out
+    void Multigrid::build_coarse(const Level & fine, Level & coarse) {
+        const size_t w = (fine.width + 2) / 2, h = (fine.height + 2) / 2;
+        coarse.width = w;
+        coarse.height = h;
+        allocate(coarse.stencil, coarse.unknown, coarse.u, coarse.f, coarse.r, w * h);
+        for (size_t y = 0; 2 * y < fine.height; ++y) {
+            for (size_t x = 0; 2 * x < fine.width; ++x) {
+                coarse.unknown[coarse.index(x, y)] = fine.unknown[fine.index(2 * x, 2 * y)];
+            }
+        }
+
+        size_t ci[4], cj[4];
+        double wi[4], wj[4];
+        for (size_t y = 0; y < fine.height; ++y) {
+            for (size_t x = 0; x < fine.width; ++x) {
+                const size_t i = fine.index(x, y);
+                if (not fine.unknown[i]) continue;
+                const size_t ni = parents(coarse, x, y, ci, wi);
+                for (size_t k = 0; k < 9; ++k) {
+                    const double coef = fine.stencil[i][k];
+                    if (coef == 0.0) continue;
+                    // nonzero coefficients never point past the grid
+                    const size_t nx = x + k % 3 - 1, ny = y + k / 3 - 1;
+                    if (not fine.unknown[fine.index(nx, ny)]) continue;
+                    const size_t nj = parents(coarse, nx, ny, cj, wj);
+                    for (size_t a = 0; a < ni; ++a) {
+                        const size_t cx = ci[a] % w, cy = ci[a] / w;
+                        for (size_t b = 0; b < nj; ++b) {
+                            // |D - C| <= 1 along both axes
+                            const size_t offset = (cj[b] % w + 1 - cx) + 3 * (cj[b] / w + 1 - cy);
+                            coarse.stencil[ci[a]][offset] += wi[a] * coef * wj[b];
+                        }
+                    }
+                }
+            }
+        }
+        // the fixed coarse nodes keep a zero correction
+        for (size_t i = 0; i < coarse.size(); ++i) {
+            if (not coarse.unknown[i]) coarse.stencil[i][4] = 1.0;
+        }
+    }
+
+    void Multigrid::factorize_lines(Level & l) {
+        const size_t w = l.width, h = l.height;
+        l.row_a.assign(w * h, 0.0);
+        l.row_c_star.assign(w * h, 0.0);
+        l.row_inv_pivot.assign(w * h, 0.0);
+        l.col_a.assign(w * h, 0.0);
+        l.col_c_star.assign(w * h, 0.0);
+        l.col_inv_pivot.assign(w * h, 0.0);
+
+        // the sub-diagonals are copied out of the stencils
+        // for solve_factorized() to read them contiguously
+        tridiagonal_mx_extended mx;
+        for (auto & d: mx) d.resize(w);
+        for (size_t y = 0; y < h; ++y) {
+            for (size_t x = 0; x < w; ++x) {
+                const size_t i = l.index(x, y);
+                mx[0][x] = l.stencil[i][3];
+                mx[1][x] = l.stencil[i][4];
+                mx[2][x] = l.stencil[i][5];
+            }
+            std::copy(mx[0].cbegin(), mx[0].cend(), l.row_a.begin() + y * w);
+            TDMA::factorize(mx, &l.row_c_star[y * w], &l.row_inv_pivot[y * w]);
+        }
+        for (size_t x = 0; x < w; ++x) {
+            for (auto & d: mx) d.resize(h);
+            for (size_t y = 0; y < h; ++y) {
+                const size_t i = l.index(x, y);
+                mx[0][y] = l.stencil[i][1];
+                mx[1][y] = l.stencil[i][4];
+                mx[2][y] = l.stencil[i][7];
+            }
+            std::copy(mx[0].cbegin(), mx[0].cend(), l.col_a.begin() + x * h);
+            TDMA::factorize(mx, &l.col_c_star[x * h], &l.col_inv_pivot[x * h]);
+        }
+    }
+
+    // dense LU with partial pivoting, the coarsest grid is a few dozen nodes
+    void Multigrid::factorize_coarsest() {
+        const Level & l = levels.back();
+        const size_t n = l.size();
+        coarse_lu.assign(n * n, 0.0);
+        coarse_pivots.resize(n);
+        for (size_t y = 0; y < l.height; ++y) {
+            for (size_t x = 0; x < l.width; ++x) {
+                const size_t i = l.index(x, y);
+                for (size_t k = 0; k < 9; ++k) {
+                    const double coef = l.stencil[i][k];
+                    if (coef == 0.0) continue;
+                    coarse_lu[i * n + l.index(x + k % 3 - 1, y + k / 3 - 1)] = coef;
+                }
+            }
+        }
+
+        for (size_t col = 0; col < n; ++col) {
+            size_t pivot = col;
+            for (size_t row = col + 1; row < n; ++row) {
+                if (std::abs(coarse_lu[row * n + col]) > std::abs(coarse_lu[pivot * n + col])) pivot = row;
+            }
+            if (coarse_lu[pivot * n + col] == 0.0) throw std::runtime_error("coarsest grid operator is singular");
+            coarse_pivots[col] = pivot;
+            if (pivot != col) {
+                std::swap_ranges(
+                    coarse_lu.begin() + col * n, coarse_lu.begin() + (col + 1) * n,
+                    coarse_lu.begin() + pivot * n);
+            }
+            const double inv = 1.0 / coarse_lu[col * n + col];
+            for (size_t row = col + 1; row < n; ++row) {
+                const double factor = coarse_lu[row * n + col] * inv;
+                coarse_lu[row * n + col] = factor;
+                if (factor == 0.0) continue;
+                for (size_t k = col + 1; k < n; ++k) coarse_lu[row * n + k] -= factor * coarse_lu[col * n + k];
+            }
+        }
+    }
+
+    void Multigrid::solve_coarsest(Level & l) const {
+        const size_t n = l.size();
+        std::copy(l.f.cbegin(), l.f.cend(), l.u.begin());
+        // the rows have been swapped as a whole, L included
+        for (size_t col = 0; col < n; ++col) std::swap(l.u[col], l.u[coarse_pivots[col]]);
+        for (size_t row = 1; row < n; ++row) {
+            double sum = l.u[row];
+            for (size_t k = 0; k < row; ++k) sum -= coarse_lu[row * n + k] * l.u[k];
+            l.u[row] = sum;
+        }
+        for (size_t row = n; row-- > 0; ) {
+            double sum = l.u[row];
+            for (size_t k = row + 1; k < n; ++k) sum -= coarse_lu[row * n + k] * l.u[k];
+            l.u[row] = sum / coarse_lu[row * n + row];
+        }
+    }
+
+    template <typename Task>
+    void Multigrid::for_each_task(const size_t count, const Task & task) {
+        if (not pool) {
+            for (size_t j = 0; j < count; ++j) task(scratch.front(), j);
+            return;
+        }
+        // lines of one colour are independent of each other
+        const size_t n_threads = pool->size();
+        pool->run([&](const size_t t) {
+            const size_t begin = t * count / n_threads, end = (t + 1) * count / n_threads;
+            for (size_t j = begin; j < end; ++j) task(scratch[t], j);
+        });
+    }
+
+    void Multigrid::solve_rows(Level & l, const size_t parity) {
+        const size_t w = l.width, h = l.height;
+        for_each_task((h - parity + 1) / 2, [&](diagonal & d, const size_t j) {
+            const size_t y = parity + 2 * j;
+            const size_t row = y * w;
+            std::copy(l.f.cbegin() + row, l.f.cbegin() + row + w, d.begin());
+            // the rows above and below are of the other colour
+            if (y > 0) {
+                subtract_line(d.data(), &l.stencil[row], 0, &l.u[row - w], w);
+            }
+            if (y + 1 < h) {
+                subtract_line(d.data(), &l.stencil[row], 6, &l.u[row + w], w);
+            }
+            TDMA::solve_factorized(w, &l.row_a[row], &l.row_c_star[row], &l.row_inv_pivot[row], d.data(), &l.u[row]);
+        });
+    }
+
+    // the columns are taken COLUMN_BLOCK at a time and the RHS is gathered
+    // row by row across the block, so that the field is read in runs
+    // rather than a node per cache line
+    void Multigrid::solve_cols(Level & l, const size_t parity) {
+        const size_t w = l.width, h = l.height;
+        const size_t count = (w - parity + 1) / 2;
+        for_each_task((count + COLUMN_BLOCK - 1) / COLUMN_BLOCK, [&](diagonal & d, const size_t j) {
+            const size_t first = j * COLUMN_BLOCK;
+            const size_t n = std::min(COLUMN_BLOCK, count - first);
+            for (size_t y = 0; y < h; ++y) {
+                for (size_t b = 0; b < n; ++b) {
+                    const size_t x = parity + 2 * (first + b);
+                    const size_t i = l.index(x, y);
+                    double sum = l.f[i];
+                    // the columns to the left and to the right are of the other colour
+                    if (x > 0) {
+                        if (y > 0) sum -= l.stencil[i][0] * l.u[i - w - 1];
+                        sum -= l.stencil[i][3] * l.u[i - 1];
+                        if (y + 1 < h) sum -= l.stencil[i][6] * l.u[i + w - 1];
+                    }
+                    if (x + 1 < w) {
+                        if (y > 0) sum -= l.stencil[i][2] * l.u[i - w + 1];
+                        sum -= l.stencil[i][5] * l.u[i + 1];
+                        if (y + 1 < h) sum -= l.stencil[i][8] * l.u[i + w + 1];
+                    }
+                    d[b * h + y] = sum;
+                }
+            }
+            for (size_t b = 0; b < n; ++b) {
+                const size_t x = parity + 2 * (first + b);
+                double * col = &d[b * h];
+                TDMA::solve_factorized(h, &l.col_a[x * h], &l.col_c_star[x * h], &l.col_inv_pivot[x * h], col, col);
+            }
+            for (size_t y = 0; y < h; ++y) {
+                for (size_t b = 0; b < n; ++b) l.u[l.index(parity + 2 * (first + b), y)] = d[b * h + y];
+            }
+        });
+    }
+
+    void Multigrid::smooth(Level & l, const size_t steps) {
+        PROF_SCOPE(SMOOTH);
+        for (size_t s = 0; s < steps; ++s) {
+            solve_rows(l, 0);
+            solve_rows(l, 1);
+            solve_cols(l, 0);
+            solve_cols(l, 1);
+        }
+    }
+
+    void Multigrid::residual(Level & l) {
+        const size_t w = l.width, h = l.height;
+        for (size_t y = 0; y < h; ++y) {
+            const size_t row = y * w;
+            double * r = &l.r[row];
+            std::copy(l.f.cbegin() + row, l.f.cbegin() + row + w, r);
+            if (y > 0) subtract_line(r, &l.stencil[row], 0, &l.u[row - w], w);
+            subtract_line(r, &l.stencil[row], 3, &l.u[row], w);
+            if (y + 1 < h) subtract_line(r, &l.stencil[row], 6, &l.u[row + w], w);
+            for (size_t x = 0; x < w; ++x) {
+                if (not l.unknown[row + x]) r[x] = 0.0;
+            }
+        }
+    }
+
+    void Multigrid::restrict_residual(const Level & fine, Level & coarse) {
+        std::fill(coarse.f.begin(), coarse.f.end(), 0.0);
+        std::fill(coarse.u.begin(), coarse.u.end(), 0.0);
+        size_t ci[4];
+        double wi[4];
+        for (size_t y = 0; y < fine.height; ++y) {
+            for (size_t x = 0; x < fine.width; ++x) {
+                const size_t i = fine.index(x, y);
+                if (not fine.unknown[i]) continue;
+                const size_t n = parents(coarse, x, y, ci, wi);
+                for (size_t a = 0; a < n; ++a) coarse.f[ci[a]] += wi[a] * fine.r[i];
+            }
+        }
+    }
+
+    void Multigrid::prolongate(const Level & coarse, Level & fine) {
+        size_t ci[4];
+        double wi[4];
+        for (size_t y = 0; y < fine.height; ++y) {
+            for (size_t x = 0; x < fine.width; ++x) {
+                const size_t i = fine.index(x, y);
+                if (not fine.unknown[i]) continue;
+                const size_t n = parents(coarse, x, y, ci, wi);
+                double correction = 0.0;
+                for (size_t a = 0; a < n; ++a) correction += wi[a] * coarse.u[ci[a]];
+                fine.u[i] += correction;
+            }
+        }
+    }
+
+    void Multigrid::cycle(const size_t depth) {
+        Level & l = levels[depth];
+        if (depth + 1 == levels.size()) {
+            PROF_SCOPE(COARSE_SOLVE);
+            solve_coarsest(l);
+            return;
+        }
+        Level & coarse = levels[depth + 1];
+        smooth(l, opts.pre_smoothing);
+        {
+            PROF_SCOPE(TRANSFER);
+            residual(l);
+            restrict_residual(l, coarse);
+        }
+        // a second visit of the coarsest grid would solve it once more for nothing
+        const size_t visits = opts.cycle == W_CYCLE and depth + 2 < levels.size() ? 2 : 1;
+        for (size_t v = 0; v < visits; ++v) cycle(depth + 1);
+        {
+            PROF_SCOPE(TRANSFER);
+            prolongate(coarse, l);
+        }
+        smooth(l, opts.post_smoothing);
+    }
+
+    double Multigrid::residual_norm() {
+        Level & fine = levels.front();
+        residual(fine);
+        double sum_squares = 0.0;
+        size_t n = 0;
+        for (size_t i = 0; i < fine.size(); ++i) {
+            if (not fine.unknown[i]) continue;
+            sum_squares += fine.r[i] * fine.r[i];
+            ++n;
+        }
+        return n > 0 ? std::sqrt(sum_squares / n) : 0.0;
+    }
+
+    MultigridStats Multigrid::solve() {
+        // the operators depend on the mesh steps
+        if (built_revision != m.revision()) build();
+
+        Level & fine = levels.front();
+        const util::strided_span<const double> field = m.field();
+        std::copy(field.begin(), field.end(), fine.u.begin());
+        // the fixed nodes keep the values of the field
+        for (size_t i = 0; i < fine.size(); ++i) {
+            if (not fine.unknown[i]) fine.f[i] = fine.u[i];
+        }
+
+        MultigridStats stats;
+        stats.initial_residual = stats.residual = residual_norm();
+        stats.converged = stats.residual == 0.0;
+        while (not stats.converged and stats.cycles < opts.max_cycles) {
+            cycle(0);
+            ++stats.cycles;
+            PROF_COUNT(CYCLES, 1);
+            stats.residual = residual_norm();
+            stats.converged = stats.residual <= opts.tolerance * stats.initial_residual;
+        }
+        m.load_field({fine.u.data(), fine.u.size()});
+        return stats;
+    }
+}
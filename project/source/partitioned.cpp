@@ -0,0 +1,236 @@
+#include "partitioned.hpp"
+
+#include <algorithm>
+
+#include "solver.hpp"
+
+namespace solver {
+    // widest batch the lanes are gathered for (AVX-512 floats)
+    constexpr size_t MAX_WIDTH = 16;
+
+    Segment Segments::hull(const size_t first_line, const size_t last_line) const {
+        Segment h = {0, 0};
+        bool any = false;
+        for (size_t l = first_line; l < last_line; ++l) {
+            if (begin(l) == end(l)) continue;
+            h.first = any ? std::min(h.first, begin(l)->first) : begin(l)->first;
+            h.last = any ? std::max(h.last, (end(l) - 1)->last) : (end(l) - 1)->last;
+            any = true;
+        }
+        return h;
+    }
+
+    template <typename Real>
+    void Segments::add_line(const basic_tridiagonal_mx<Real> & mx, const size_t n) {
+        const auto pinned = [&mx](const size_t i) { return mx[0][i] == 0 and mx[1][i] == 1 and mx[2][i] == 0; };
+        const size_t line_begin = segments.size();
+        size_t i = 0;
+        while (i < n) {
+            if (pinned(i)) {
+                ++i;
+                continue;
+            }
+            const size_t first = i > 0 ? i - 1 : 0;
+            while (i < n and not pinned(i)) ++i;
+            const size_t last = std::min(i + 1, n);
+            // runs a single pinned equation apart share it and are merged
+            if (segments.size() > line_begin and segments.back().last > first) segments.back().last = last;
+            else segments.push_back({first, last});
+        }
+        offsets.push_back(segments.size());
+    }
+
+    template void Segments::add_line<double>(const basic_tridiagonal_mx<double> &, const size_t);
+    template void Segments::add_line<float>(const basic_tridiagonal_mx<float> &, const size_t);
+
+    template <typename Real>
+    BasicPartitionedTDMA<Real>::BasicPartitionedTDMA(
+        const size_t N, const Real * a, const Real * b, const Real * c,
+        const size_t groups, const size_t width
+    ): width(width) {
+        if (groups == 0 or width == 0) throw std::runtime_error("system must have at least one partition");
+        if (width > MAX_WIDTH) throw std::runtime_error("too many lanes per group");
+        const size_t K = groups * width;
+        if (N == 0 or (K > 1 and N < 2 * K)) throw std::runtime_error("partitions must have 2 equations at least");
+
+        bounds.resize(K + 1);
+        for (size_t k = 0; k <= K; ++k) bounds[k] = k * N / K;
+
+        // the couplings of an interior to the separators move to the RHS:
+        // p and q are the responses to them (zero for the ends of the system)
+        parts.resize(groups);
+        basic_tridiagonal_mx<Real> mx;
+        basic_diagonal<Real> rhs;
+        for (size_t g = 0; g < groups; ++g) {
+            Group & part = parts[g];
+            part.first = g * width;
+            for (size_t l = 0; l < width; ++l) {
+                const Segment in = interior(part.first + l);
+                part.length = std::max(part.length, in.last - in.first);
+            }
+            const size_t L = part.length * width;
+            mx = {basic_diagonal<Real>(L, 0), basic_diagonal<Real>(L, 1), basic_diagonal<Real>(L, 0), basic_diagonal<Real>(L, 0)};
+            for (size_t l = 0; l < width; ++l) {
+                const Segment in = interior(part.first + l);
+                for (size_t i = 0; i < in.last - in.first; ++i) {
+                    mx[0][i * width + l] = a[in.first + i];
+                    mx[1][i * width + l] = b[in.first + i];
+                    mx[2][i * width + l] = c[in.first + i];
+                }
+                mx[0][l] = 0;
+                mx[2][(in.last - in.first - 1) * width + l] = 0;
+            }
+            part.c_star.resize(L);
+            part.inv_pivot.resize(L);
+            part.y.resize(L);
+            part.p.resize(L);
+            part.q.resize(L);
+            if (width > 1) {
+                part.batched = BasicBatchedTDMA<Real>(part.length, width);
+                part.batched.factorize(mx, part.c_star.data(), part.inv_pivot.data());
+            } else {
+                BasicTDMA<Real>::factorize(mx, part.c_star.data(), part.inv_pivot.data());
+            }
+            part.a = std::move(mx[0]);
+
+            const auto respond = [&](basic_diagonal<Real> & out, const bool top) {
+                rhs.assign(L, 0);
+                for (size_t l = 0; l < width; ++l) {
+                    const size_t k = part.first + l;
+                    const Segment in = interior(k);
+                    if (top and k > 0) rhs[l] = -a[in.first];
+                    if (not top and k + 1 < K) rhs[(in.last - in.first - 1) * width + l] = -c[in.last - 1];
+                }
+                if (width > 1) part.batched.solve_factorized(part.a.data(), part.c_star.data(), part.inv_pivot.data(), rhs, out);
+                else BasicTDMA<Real>::solve_factorized(L, part.a.data(), part.c_star.data(), part.inv_pivot.data(), rhs.data(), out.data());
+            };
+            respond(part.p, true);
+            respond(part.q, false);
+        }
+
+        // the separator k (the last equation of the partition k) couples
+        // to the last row of the interior k and the first one of k + 1:
+        // A S_{k-1} + B S_k + C S_{k+1} = D
+        const size_t R = K - 1;
+        separator_a.resize(R);
+        separator_c.resize(R);
+        separators.resize(R);
+        reduced_c_star.resize(R);
+        reduced_inv_pivot.resize(R);
+        if (R == 0) return;
+        basic_tridiagonal_mx<Real> reduced = {
+            basic_diagonal<Real>(R), basic_diagonal<Real>(R), basic_diagonal<Real>(R), basic_diagonal<Real>(R)};
+        for (size_t k = 0; k < R; ++k) {
+            const size_t s = bounds[k + 1] - 1;
+            const size_t last = interior(k).last - interior(k).first - 1;
+            separator_a[k] = a[s];
+            separator_c[k] = c[s];
+            reduced[0][k] = a[s] * at(&Group::p, k, last);
+            reduced[1][k] = b[s] + a[s] * at(&Group::q, k, last) + c[s] * at(&Group::p, k + 1, 0);
+            reduced[2][k] = c[s] * at(&Group::q, k + 1, 0);
+        }
+        BasicTDMA<Real>::factorize(reduced, reduced_c_star.data(), reduced_inv_pivot.data());
+        reduced_a = std::move(reduced[0]);
+    }
+
+    template <typename Real>
+    Segment BasicPartitionedTDMA<Real>::interior(const size_t k) const {
+        const bool last = k + 1 == n_partitions();
+        return {bounds[k], last ? bounds[k + 1] : bounds[k + 1] - 1};
+    }
+
+    template <typename Real>
+    const Real & BasicPartitionedTDMA<Real>::at(
+        const basic_diagonal<Real> Group::* field, const size_t k, const size_t i
+    ) const {
+        return (parts[k / width].*field)[i * width + k % width];
+    }
+
+    template <typename Real>
+    Segment BasicPartitionedTDMA<Real>::span(const size_t g) const {
+        return {bounds[g * width], bounds[(g + 1) * width]};
+    }
+
+    template <typename Real>
+    void BasicPartitionedTDMA<Real>::eliminate(const size_t g, const Real * d) {
+        Group & part = parts[g];
+        if (width == 1) {
+            const Segment in = interior(part.first);
+            BasicTDMA<Real>::solve_factorized(
+                in.last - in.first, part.a.data(), part.c_star.data(), part.inv_pivot.data(),
+                d + in.first, part.y.data());
+            return;
+        }
+        // row by row, so that the interleaved side is walked contiguously;
+        // the padding rows of the shorter interiors stay zero
+        const Real * lanes[MAX_WIDTH];
+        size_t common = part.length;
+        for (size_t l = 0; l < width; ++l) {
+            const Segment in = interior(part.first + l);
+            lanes[l] = d + in.first;
+            common = std::min(common, in.last - in.first);
+        }
+        Real * y = part.y.data();
+        for (size_t i = 0; i < common; ++i) {
+            for (size_t l = 0; l < width; ++l) {
+                y[i * width + l] = lanes[l][i];
+            }
+        }
+        for (size_t l = 0; l < width; ++l) {
+            const Segment in = interior(part.first + l);
+            for (size_t i = common; i < in.last - in.first; ++i) {
+                y[i * width + l] = lanes[l][i];
+            }
+        }
+        part.batched.solve_factorized(part.a.data(), part.c_star.data(), part.inv_pivot.data(), part.y, part.y);
+    }
+
+    template <typename Real>
+    void BasicPartitionedTDMA<Real>::reduce(const Real * d) {
+        const size_t R = separators.size();
+        if (R == 0) return;
+        for (size_t k = 0; k < R; ++k) {
+            const size_t last = interior(k).last - interior(k).first - 1;
+            separators[k] = d[bounds[k + 1] - 1]
+                - separator_a[k] * at(&Group::y, k, last) - separator_c[k] * at(&Group::y, k + 1, 0);
+        }
+        BasicTDMA<Real>::solve_factorized(
+            R, reduced_a.data(), reduced_c_star.data(), reduced_inv_pivot.data(),
+            separators.data(), separators.data());
+    }
+
+    template <typename Real>
+    void BasicPartitionedTDMA<Real>::substitute(const size_t g, Real * x) const {
+        const Group & part = parts[g];
+        const size_t R = separators.size();
+        Real above[MAX_WIDTH], below[MAX_WIDTH];
+        Real * lanes[MAX_WIDTH];
+        size_t common = part.length;
+        for (size_t l = 0; l < width; ++l) {
+            const size_t k = part.first + l;
+            const Segment in = interior(k);
+            above[l] = k > 0 ? separators[k - 1] : Real(0);
+            below[l] = k < R ? separators[k] : Real(0);
+            lanes[l] = x + in.first;
+            common = std::min(common, in.last - in.first);
+            if (k < R) x[in.last] = below[l];
+        }
+        const Real * y = part.y.data(), * p = part.p.data(), * q = part.q.data();
+        for (size_t i = 0; i < common; ++i) {
+            for (size_t l = 0; l < width; ++l) {
+                const size_t j = i * width + l;
+                lanes[l][i] = y[j] + p[j] * above[l] + q[j] * below[l];
+            }
+        }
+        for (size_t l = 0; l < width; ++l) {
+            const Segment in = interior(part.first + l);
+            for (size_t i = common; i < in.last - in.first; ++i) {
+                const size_t j = i * width + l;
+                lanes[l][i] = y[j] + p[j] * above[l] + q[j] * below[l];
+            }
+        }
+    }
+
+    template class BasicPartitionedTDMA<double>;
+    template class BasicPartitionedTDMA<float>;
+}
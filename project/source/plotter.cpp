@@ -1,26 +1,161 @@
 #include "plotter.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
 
 namespace plt {
-    GNUPlotWriter::GNUPlotWriter(const std::string & config) {
+    GNUPlotWriter::GNUPlotWriter(const std::string & config, const NumberFormat & fmt):
+        frame_text(fmt) {
+        pipe = popen(command.data(), "w");
+        if (pipe == nullptr) throw std::runtime_error("failed to run GNUplot");
+        fputs(config.c_str(), pipe);
+    }
+
+    GNUPlotWriter::GNUPlotWriter(
+        const std::string & config, const size_t n_buffers, const backpressure policy,
+        const NumberFormat & fmt
+    ):
+        FrameWriter(n_buffers, policy),
+        frame_text(fmt) {
         pipe = popen(command.data(), "w");
         if (pipe == nullptr) throw std::runtime_error("failed to run GNUplot");
         fputs(config.c_str(), pipe);
     }
 
     GNUPlotWriter::~GNUPlotWriter() {
-        pclose(pipe);
+        try {
+            stop();
+        } catch (const std::exception &) {}
+        if (pipe != nullptr) pclose(pipe);
     }
 
     void GNUPlotWriter::flush_buffer() {
+        if (asynchronous()) throw std::runtime_error("flush_buffer() is not available in async mode");
         throw_on_bad_pipe();
         fputs("splot '-' matrix with image\n", pipe);
         fputs(payload_buffer.str().c_str(), pipe);
         fputs("e\n", pipe);
-        std::stringstream().swap(payload_buffer);
+        payload_buffer.str(std::string());
+    }
+
+    // with the default format the text is the same as model::Model79::dump() produces
+    void GNUPlotWriter::write_frame(util::strided_span<const double> field, const size_t width) {
+        throw_on_bad_pipe();
+        {
+            PROF_SCOPE(FORMAT);
+            frame_text.clear();
+            frame_text.append("splot '-' matrix with image\n");
+            frame_text.append(field, width);
+            frame_text.append("e\n");
+        }
+        PROF_SCOPE(PIPE);
+        frame_text.write(pipe);
+        PROF_COUNT(FRAMES_WRITTEN, 1);
+        PROF_COUNT(BYTES_WRITTEN, frame_text.view().size());
     }
 
     void GNUPlotWriter::throw_on_bad_pipe() {
         if (pipe == nullptr)
             throw std::runtime_error("failed to open GNUPlot subprocess");
     }
+
+    // the writer thread only calls write_frame() for the submitted frames,
+    // which may not come before the implementation is constructed
+    FrameWriter::FrameWriter(const size_t n_buffers, const backpressure policy):
+        async(true),
+        policy(policy),
+        snapshots(n_buffers) {
+        if (n_buffers == 0) throw std::runtime_error("async writer needs at least one buffer");
+        writer = std::thread(&FrameWriter::writer_loop, this);
+    }
+
+    FrameWriter::~FrameWriter() {
+        stop();
+    }
+
+    void FrameWriter::stop() {
+        if (not writer.joinable()) return;
+        // the frames queued so far are still written
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopped = true;
+        }
+        queued.notify_one();
+        writer.join();
+        rethrow_error();
+    }
+
+    // the error stays: the writer thread is gone, no frame is written anymore
+    void FrameWriter::rethrow_error() const {
+        if (error) std::rethrow_exception(error);
+    }
+
+    bool FrameWriter::submit(util::strided_span<const double> field, const size_t width) {
+        if (width == 0 or field.size() % width != 0)
+            throw std::runtime_error("field size is not a multiple of the row width");
+
+        if (not async) {
+            write_frame(field, width);
+            return true;
+        }
+
+        std::unique_lock<std::mutex> guard(lock);
+        rethrow_error();
+        if (submitted - written == snapshots.size()) {
+            if (policy == DROP_ON_FULL) {
+                ++dropped;
+                PROF_COUNT(FRAMES_DROPPED, 1);
+                return false;
+            }
+            freed.wait(guard, [&] { return error or submitted - written < snapshots.size(); });
+            rethrow_error();
+        }
+        // the slot is not visible to the writer until submitted is bumped,
+        // so the copy may be done without holding the lock
+        Snapshot & s = snapshots[submitted % snapshots.size()];
+        guard.unlock();
+
+        s.values.resize(field.size());
+        std::copy(field.begin(), field.end(), s.values.begin());
+        s.width = width;
+
+        guard.lock();
+        ++submitted;
+        guard.unlock();
+        queued.notify_one();
+        return true;
+    }
+
+    void FrameWriter::drain() {
+        if (not async) return;
+        std::unique_lock<std::mutex> guard(lock);
+        freed.wait(guard, [&] { return error or written == submitted; });
+        rethrow_error();
+    }
+
+    void FrameWriter::writer_loop() {
+        for (;;) {
+            std::unique_lock<std::mutex> guard(lock);
+            queued.wait(guard, [&] { return stopped or written != submitted; });
+            if (written == submitted) return;  // stopped and nothing left
+            const Snapshot & s = snapshots[written % snapshots.size()];
+            guard.unlock();
+
+            // the state of the implementation belongs to this thread in the async mode
+            std::exception_ptr failure;
+            try {
+                write_frame({s.values.data(), s.values.size()}, s.width);
+            } catch (...) {
+                failure = std::current_exception();
+            }
+
+            guard.lock();
+            if (failure) error = failure;
+            else ++written;
+            guard.unlock();
+            freed.notify_all();
+            if (failure) return;
+        }
+    }
+
 }
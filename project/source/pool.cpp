@@ -0,0 +1,65 @@
+#include "pool.hpp"
+
+namespace solver {
+    ThreadPool::ThreadPool(const size_t n_threads) {
+        if (n_threads == 0) throw std::runtime_error("thread pool must have at least one thread");
+        workers.reserve(n_threads - 1);
+        for (size_t i = 1; i < n_threads; ++i) {
+            workers.emplace_back(&ThreadPool::worker_loop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopped = true;
+        }
+        wake.notify_all();
+        for (auto & w: workers) w.join();
+    }
+
+    void ThreadPool::execute(const size_t thread_id) {
+        // the first exception is kept and rethrown
+        // by run(), the rest are discarded
+        try {
+            (*current_job)(thread_id);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (not error) error = std::current_exception();
+        }
+    }
+
+    void ThreadPool::worker_loop(const size_t thread_id) {
+        size_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&] { return stopped or generation != seen; });
+                if (stopped) return;
+                seen = generation;
+            }
+            execute(thread_id);
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (--pending == 0) done.notify_one();
+            }
+        }
+    }
+
+    void ThreadPool::run(const job & j) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            current_job = &j;
+            pending = workers.size();
+            error = nullptr;
+            ++generation;
+        }
+        wake.notify_all();
+        execute(0);
+
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [&] { return pending == 0; });
+        current_job = nullptr;
+        if (error) std::rethrow_exception(error);
+    }
+}
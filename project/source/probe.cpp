@@ -0,0 +1,276 @@
+#include "probe.hpp"
+#include "binary.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace io {
+    namespace {
+        constexpr char MAGIC[8] = {'F', 'D', 'M', 'P', 'R', 'O', 'B', '1'};
+        constexpr uint32_t VERSION = 1;
+        // coordinates this close to the mesh (in node spacings) are on it
+        constexpr double EPS = 1e-9;
+        // most points a line probe may be sampled at
+        constexpr long long MAX_LINE_SAMPLES = 1 << 20;
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t byte_order;
+            uint64_t channels;
+            uint64_t names_size;
+        };
+        static_assert(sizeof(Header) == 32, "probe header must have no padding");
+
+        bool ends_with(const std::string & s, const std::string_view suffix) {
+            return s.size() >= suffix.size() and s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+        }
+    }
+
+    std::vector<ProbeSpec> read_probes(const std::string & path) {
+        std::ifstream in(path);
+        if (not in) throw std::runtime_error("cannot open the probe file " + path);
+        std::vector<ProbeSpec> probes;
+        std::string line;
+        for (size_t n = 1; std::getline(in, line); ++n) {
+            const auto fail = [&](const std::string & why) {
+                throw std::runtime_error(path + ':' + std::to_string(n) + ": " + why);
+            };
+            line = line.substr(0, line.find('#'));
+            std::istringstream fields(line);
+            std::string kind;
+            if (not (fields >> kind)) continue;
+            ProbeSpec p;
+            if (not (fields >> p.name)) fail("expected the name of the probe");
+            if (p.name.find(',') != std::string::npos) fail("probe names must not contain commas");
+            if (kind == "point") {
+                p.shape = PROBE_POINT;
+                if (not (fields >> p.x0 >> p.y0)) fail("expected the coordinates of the point");
+            } else if (kind == "line" or kind == "rect") {
+                p.shape = kind == "line" ? PROBE_LINE : PROBE_RECTANGLE;
+                if (not (fields >> p.x0 >> p.y0 >> p.x1 >> p.y1)) fail("expected the coordinates of both ends");
+                std::string count;
+                if (p.shape == PROBE_LINE and fields >> count) {
+                    // read signed, so that a negative count is not wrapped around
+                    long long samples = 0;
+                    const auto [end, ec] = std::from_chars(count.data(), count.data() + count.size(), samples);
+                    if (ec != std::errc() or end != count.data() + count.size())
+                        fail("expected the number of samples of the line");
+                    if (samples <= 0 or samples > MAX_LINE_SAMPLES)
+                        fail("number of samples must be in [1, " + std::to_string(MAX_LINE_SAMPLES) + ']');
+                    p.samples = static_cast<size_t>(samples);
+                }
+            } else {
+                fail("unknown probe kind '" + kind + "' (expected point, line or rect)");
+            }
+            std::string extra;
+            if (fields >> extra) fail("unexpected '" + extra + "' after the probe");
+            probes.push_back(p);
+        }
+        if (probes.empty()) throw std::runtime_error("no probes in the file " + path);
+        return probes;
+    }
+
+    ProbeSet::ProbeSet(
+        const std::vector<ProbeSpec> & specs,
+        const size_t width, const size_t height,
+        const model::Parameters & parameters,
+        util::strided_span<const model::condition> mask
+    ):
+        n_nodes(width * height) {
+        if (width == 0 or height == 0) throw std::runtime_error("empty mesh cannot be probed");
+        if (mask.size() != n_nodes) throw std::runtime_error("condition mask does not match the mesh");
+        const double dx = parameters.dx, dy = parameters.dy;
+        const auto check_bounds = [&](const ProbeSpec & p, const double fx, const double fy) {
+            if (fx < -EPS or fy < -EPS or fx > width - 1 + EPS or fy > height - 1 + EPS)
+                throw std::runtime_error("probe " + p.name + " is outside the mesh");
+        };
+
+        for (const ProbeSpec & p: specs) {
+            if (p.shape == PROBE_POINT) {
+                check_bounds(p, p.x0 / dx, p.y0 / dy);
+                add_point(p.name, p.x0 / dx, p.y0 / dy, width, height, mask);
+            } else if (p.shape == PROBE_LINE) {
+                check_bounds(p, p.x0 / dx, p.y0 / dy);
+                check_bounds(p, p.x1 / dx, p.y1 / dy);
+                if (p.samples > static_cast<size_t>(MAX_LINE_SAMPLES))
+                    throw std::runtime_error("probe " + p.name + " has too many samples");
+                const double steps = std::max(std::abs(p.x1 - p.x0) / dx, std::abs(p.y1 - p.y0) / dy);
+                const size_t n = p.samples > 0 ? p.samples : static_cast<size_t>(std::lround(steps)) + 1;
+                for (size_t k = 0; k < n; ++k) {
+                    const double s = n > 1 ? static_cast<double>(k) / (n - 1) : 0.0;
+                    const double x = p.x0 + s * (p.x1 - p.x0), y = p.y0 + s * (p.y1 - p.y0);
+                    add_point(p.name + '[' + std::to_string(k) + ']', x / dx, y / dy, width, height, mask);
+                }
+            } else {
+                check_bounds(p, p.x0 / dx, p.y0 / dy);
+                check_bounds(p, p.x1 / dx, p.y1 / dy);
+                const auto node_range = [](const double a, const double b, const double d, const size_t n) {
+                    const double lo = std::max(0.0, std::ceil(std::min(a, b) / d - EPS));
+                    const double hi = std::min(n - 1.0, std::floor(std::max(a, b) / d + EPS));
+                    return std::make_pair(static_cast<size_t>(lo), static_cast<size_t>(hi) + 1);
+                };
+                const auto [i_first, i_last] = node_range(p.x0, p.x1, dx, width);
+                const auto [j_first, j_last] = node_range(p.y0, p.y1, dy, height);
+                const size_t first = taps.size();
+                for (size_t j = j_first; j < j_last; ++j) {
+                    for (size_t i = i_first; i < i_last; ++i) {
+                        const size_t index = j * width + i;
+                        if (mask[index] != model::OUTER_NODE) taps.push_back({index, 1.0});
+                    }
+                }
+                const size_t last = taps.size();
+                if (first == last) throw std::runtime_error("probe " + p.name + " has no nodes inside");
+                for (size_t t = first; t < last; ++t) taps[t].weight = 1.0 / (last - first);
+                channels.push_back({WEIGHTED_SUM, first, last});
+                channels.push_back({MINIMUM, first, last});
+                channels.push_back({MAXIMUM, first, last});
+                channel_names.push_back(p.name + ".mean");
+                channel_names.push_back(p.name + ".min");
+                channel_names.push_back(p.name + ".max");
+            }
+        }
+    }
+
+    // fx and fy are in the node spacings, on the mesh up to EPS
+    void ProbeSet::add_point(
+        const std::string & name, const double fx, const double fy,
+        const size_t width, const size_t height, util::strided_span<const model::condition> mask
+    ) {
+        const auto cell = [](const double f, const size_t n) {
+            const double c = std::clamp(f, 0.0, n - 1.0);
+            const size_t i = std::min(static_cast<size_t>(c), n > 1 ? n - 2 : 0);
+            return std::make_pair(i, c - i);
+        };
+        const auto [i0, tx] = cell(fx, width);
+        const auto [j0, ty] = cell(fy, height);
+        const size_t first = taps.size();
+        double total = 0.0;
+        for (size_t dj = 0; dj < 2; ++dj) {
+            for (size_t di = 0; di < 2; ++di) {
+                const double w = (di ? tx : 1.0 - tx) * (dj ? ty : 1.0 - ty);
+                if (w == 0.0 or i0 + di >= width or j0 + dj >= height) continue;
+                const size_t index = (j0 + dj) * width + i0 + di;
+                if (mask[index] == model::OUTER_NODE) continue;
+                taps.push_back({index, w});
+                total += w;
+            }
+        }
+        for (size_t t = first; t < taps.size(); ++t) taps[t].weight /= total;
+        channels.push_back({WEIGHTED_SUM, first, taps.size()});
+        channel_names.push_back(name);
+    }
+
+    template <typename T>
+    void ProbeSet::sample_values(util::strided_span<const T> field, double * out) const {
+        if (field.size() != n_nodes) throw std::runtime_error("field does not match the mesh of the probes");
+        for (size_t c = 0; c < channels.size(); ++c) {
+            const Channel & ch = channels[c];
+            if (ch.first == ch.last) {
+                out[c] = std::numeric_limits<double>::quiet_NaN();
+                continue;
+            }
+            double v = ch.op == WEIGHTED_SUM ? 0.0 : static_cast<double>(field[taps[ch.first].index]);
+            for (size_t t = ch.first; t < ch.last; ++t) {
+                const double value = field[taps[t].index];
+                if (ch.op == WEIGHTED_SUM) v += taps[t].weight * value;
+                else if (ch.op == MINIMUM) v = std::min(v, value);
+                else v = std::max(v, value);
+            }
+            out[c] = v;
+        }
+    }
+
+    void ProbeSet::sample(util::strided_span<const double> field, double * out) const {
+        sample_values(field, out);
+    }
+
+    void ProbeSet::sample(util::strided_span<const float> field, double * out) const {
+        sample_values(field, out);
+    }
+
+    ProbeWriter::ProbeWriter(const std::string & path, const ProbeSet & probes):
+        probes(probes),
+        csv(ends_with(path, ".csv")),
+        values(probes.size()) {
+        file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) throw std::runtime_error("failed to create the probe series " + path);
+        try {
+            write_header();
+        } catch (...) {
+            std::fclose(file);
+            throw;
+        }
+    }
+
+    ProbeWriter::~ProbeWriter() {
+        if (file != nullptr) std::fclose(file);
+    }
+
+    void ProbeWriter::write_header() {
+        std::string text;
+        if (csv) {
+            text = "step,time";
+            for (const std::string & name: probes.names()) text += ',' + name;
+            text += '\n';
+        } else {
+            std::string names;
+            for (const std::string & name: probes.names()) names += name + '\0';
+            names.resize((names.size() + 7) / 8 * 8, '\0');
+            Header header{};
+            binary::stamp(header, MAGIC, VERSION);
+            header.channels = probes.size();
+            header.names_size = names.size();
+            text.assign(reinterpret_cast<const char *>(&header), sizeof(Header));
+            text += names;
+        }
+        if (std::fwrite(text.data(), 1, text.size(), file) != text.size())
+            throw std::runtime_error("failed to write the probe series");
+    }
+
+    // the CSV values are printed in the shortest form that reads back exactly
+    void ProbeWriter::write_sample(const size_t step, const double time) {
+        if (csv) {
+            // 24 characters hold any double and the separator, the integers are shorter
+            line.resize(25 * (values.size() + 2));
+            char * p = line.data(), * end = line.data() + line.size();
+            p = std::to_chars(p, end, step).ptr;
+            *p++ = ',';
+            p = std::to_chars(p, end, time).ptr;
+            for (const double v: values) {
+                *p++ = ',';
+                p = std::to_chars(p, end, v).ptr;
+            }
+            *p++ = '\n';
+            line.resize(static_cast<size_t>(p - line.data()));
+        } else {
+            const uint64_t s = step;
+            line.resize(sizeof(s) + sizeof(time) + values.size() * sizeof(double));
+            std::memcpy(line.data(), &s, sizeof(s));
+            std::memcpy(line.data() + sizeof(s), &time, sizeof(time));
+            std::memcpy(line.data() + sizeof(s) + sizeof(time), values.data(), values.size() * sizeof(double));
+        }
+        if (std::fwrite(line.data(), 1, line.size(), file) != line.size())
+            throw std::runtime_error("failed to write the probe series");
+        ++n_samples;
+    }
+
+    void ProbeWriter::append(const size_t step, const double time, util::strided_span<const double> field) {
+        probes.sample(field, values.data());
+        write_sample(step, time);
+    }
+
+    void ProbeWriter::append(const size_t step, const double time, util::strided_span<const float> field) {
+        probes.sample(field, values.data());
+        write_sample(step, time);
+    }
+
+    void ProbeWriter::flush() {
+        if (std::fflush(file) != 0) throw std::runtime_error("failed to write the probe series");
+    }
+}
@@ -0,0 +1,117 @@
+#include "profile.hpp"
+
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+namespace prof {
+#ifdef FDM_PROFILE
+    constexpr const char * PHASE_NAMES[N_PHASES] = {
+        "step", "factorize", "assemble x", "assemble y", "solve x", "solve y",
+        "scatter x", "scatter y", "format", "pipe", "render", "encode", "snapshot",
+        "smooth", "transfer", "coarse solve", "exchange"};
+    constexpr const char * COUNTER_NAMES[N_COUNTERS] = {
+        "steps", "lines solved", "equations solved", "nodes updated",
+        "frames written", "frames dropped", "bytes written", "cycles"};
+
+    // the slots outlive their threads so that
+    // the report may be made after the pools are gone
+    static std::mutex registry_lock;
+    static std::vector<std::unique_ptr<ThreadStats>> registry;
+
+    ThreadStats & register_thread() {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        registry.push_back(std::make_unique<ThreadStats>());
+        slot = registry.back().get();
+        return *slot;
+    }
+
+    bool enabled() { return true; }
+
+    static ThreadStats total() {
+        ThreadStats sum;
+        std::lock_guard<std::mutex> guard(registry_lock);
+        for (const auto & s: registry) {
+            for (size_t p = 0; p < N_PHASES; ++p) {
+                sum.ns[p] += s->ns[p];
+                sum.calls[p] += s->calls[p];
+            }
+            for (size_t c = 0; c < N_COUNTERS; ++c) sum.counters[c] += s->counters[c];
+        }
+        return sum;
+    }
+
+    static void print_phase(
+        std::ostream & os, const std::string & name,
+        const uint64_t ns, const uint64_t calls, const uint64_t step_ns
+    ) {
+        os  << std::left << std::setw(18) << name << std::right
+            << std::fixed << std::setprecision(3)
+            << std::setw(14) << ns * 1e-6
+            << std::setw(12) << calls
+            << std::setw(14) << (calls ? static_cast<double>(ns) / calls * 1e-3 : 0.0)
+            << std::setprecision(1)
+            << std::setw(10) << (step_ns ? 100.0 * ns / step_ns : 0.0)
+            << std::defaultfloat << '\n';
+    }
+
+    void report(std::ostream & os, const bool per_thread) {
+        const ThreadStats sum = total();
+        // the share is relative to the wall time of the steps; the solver phases
+        // are summed over the threads and the output phases lie outside
+        // of the steps, so the shares do not add up to 100%
+        const uint64_t step_ns = sum.ns[STEP];
+
+        os  << std::left << std::setw(18) << "phase" << std::right
+            << std::setw(14) << "total ms"
+            << std::setw(12) << "calls"
+            << std::setw(14) << "us/call"
+            << std::setw(10) << "% step" << '\n';
+        for (size_t p = 0; p < N_PHASES; ++p) {
+            if (sum.calls[p] == 0) continue;
+            print_phase(os, PHASE_NAMES[p], sum.ns[p], sum.calls[p], step_ns);
+            if (not per_thread) continue;
+            std::lock_guard<std::mutex> guard(registry_lock);
+            for (size_t t = 0; t < registry.size(); ++t) {
+                const ThreadStats & s = *registry[t];
+                if (s.calls[p] == 0) continue;
+                print_phase(os, "  thread " + std::to_string(t), s.ns[p], s.calls[p], step_ns);
+            }
+        }
+        for (size_t c = 0; c < N_COUNTERS; ++c) {
+            if (sum.counters[c] == 0) continue;
+            os << std::left << std::setw(18) << COUNTER_NAMES[c] << std::right
+               << std::setw(14) << sum.counters[c] << '\n';
+        }
+    }
+
+    void report_json(std::ostream & os) {
+        const ThreadStats sum = total();
+        os << "{\n  \"phases\": {";
+        for (size_t p = 0; p < N_PHASES; ++p) {
+            os  << (p ? "," : "") << "\n    \"" << PHASE_NAMES[p] << "\": {\"ns\": " << sum.ns[p]
+                << ", \"calls\": " << sum.calls[p] << ", \"threads_ns\": [";
+            std::lock_guard<std::mutex> guard(registry_lock);
+            for (size_t t = 0; t < registry.size(); ++t) {
+                os << (t ? ", " : "") << registry[t]->ns[p];
+            }
+            os << "]}";
+        }
+        os << "\n  },\n  \"counters\": {";
+        for (size_t c = 0; c < N_COUNTERS; ++c) {
+            os << (c ? "," : "") << "\n    \"" << COUNTER_NAMES[c] << "\": " << sum.counters[c];
+        }
+        os << "\n  }\n}\n";
+    }
+#else
+    bool enabled() { return false; }
+
+    void report(std::ostream & os, const bool) {
+        os << "instrumentation is disabled, configure with -DFDM_PROFILE=ON\n";
+    }
+
+    void report_json(std::ostream & os) {
+        os << "{\"enabled\": false}\n";
+    }
+#endif
+}
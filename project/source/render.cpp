@@ -0,0 +1,351 @@
+#include "render.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// the default scale fits the larger side of the mesh into this many pixels
+constexpr size_t FIT_PIXELS = 800;
+constexpr double PI = 3.14159265358979323846;
+// LZW of the GIF: 8-bit indices, codes of 12 bits at most
+constexpr unsigned LZW_MIN_CODE_SIZE = 8;
+constexpr unsigned LZW_CLEAR = 1 << LZW_MIN_CODE_SIZE;
+constexpr unsigned LZW_END = LZW_CLEAR + 1;
+constexpr unsigned LZW_MAX_CODE = 4095;
+// slots of the string table, twice the codes
+constexpr size_t LZW_TABLE_SIZE = 8192;
+// largest stored deflate block
+constexpr size_t DEFLATE_BLOCK = 65535;
+
+namespace plt {
+    namespace {
+        void put16le(std::vector<uint8_t> & out, const size_t v) {
+            out.push_back(static_cast<uint8_t>(v & 0xff));
+            out.push_back(static_cast<uint8_t>((v >> 8) & 0xff));
+        }
+
+        void put32be(std::vector<uint8_t> & out, const uint32_t v) {
+            for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>((v >> shift) & 0xff));
+        }
+
+        void write_bytes(FILE * file, const std::vector<uint8_t> & bytes) {
+            if (std::fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size())
+                throw std::runtime_error("failed to write the image");
+        }
+
+        uint32_t crc32(const uint8_t * data, const size_t n, uint32_t crc = 0) {
+            static const std::array<uint32_t, 256> table = [] {
+                std::array<uint32_t, 256> t{};
+                for (uint32_t i = 0; i < 256; ++i) {
+                    uint32_t c = i;
+                    for (int k = 0; k < 8; ++k) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                    t[i] = c;
+                }
+                return t;
+            }();
+            crc = ~crc;
+            for (size_t i = 0; i < n; ++i) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+            return ~crc;
+        }
+
+        uint32_t adler32(const uint8_t * data, const size_t n, uint32_t adler) {
+            // 5552 bytes is the most that fits the sums into 32 bits between the reductions
+            uint32_t a = adler & 0xffff, b = adler >> 16;
+            for (size_t done = 0; done < n;) {
+                const size_t chunk = std::min<size_t>(n - done, 5552);
+                for (size_t i = 0; i < chunk; ++i) {
+                    a += data[done + i];
+                    b += a;
+                }
+                a %= 65521;
+                b %= 65521;
+                done += chunk;
+            }
+            return (b << 16) | a;
+        }
+
+        // appends a PNG chunk: length, type, data and the CRC of the type and the data
+        void put_chunk(std::vector<uint8_t> & out, const char * type, const std::vector<uint8_t> & data) {
+            put32be(out, static_cast<uint32_t>(data.size()));
+            const size_t start = out.size();
+            out.insert(out.end(), type, type + 4);
+            out.insert(out.end(), data.begin(), data.end());
+            put32be(out, crc32(out.data() + start, out.size() - start));
+        }
+    }
+
+    // r = sqrt(x), g = x^3, b = sin(2 pi x), clipped to [0, 1]
+    Palette default_palette() {
+        Palette p;
+        for (size_t i = 0; i < PALETTE_SIZE; ++i) {
+            const double x = static_cast<double>(i) / (PALETTE_SIZE - 1);
+            const auto channel = [](const double v) {
+                return static_cast<uint8_t>(std::lround(std::clamp(v, 0.0, 1.0) * 255.0));
+            };
+            p[i] = {channel(std::sqrt(x)), channel(x * x * x), channel(std::sin(2.0 * PI * x))};
+        }
+        return p;
+    }
+
+    ColorRange value_range(util::strided_span<const double> field) {
+        ColorRange r{0.0, 1.0};
+        bool seen = false;
+        for (const double v: field) {
+            if (std::isnan(v)) continue;
+            r.min = seen ? std::min(r.min, v) : v;
+            r.max = seen ? std::max(r.max, v) : v;
+            seen = true;
+        }
+        if (r.empty()) {
+            r.min -= 1.0;
+            r.max += 1.0;
+        }
+        return r;
+    }
+
+    void rasterize(
+        util::strided_span<const double> field, const size_t width,
+        const ColorRange & range, const size_t scale, Framebuffer & out
+    ) {
+        if (width == 0 or field.size() % width != 0)
+            throw std::runtime_error("field size is not a multiple of the row width");
+        if (scale == 0) throw std::runtime_error("image scale must be positive");
+        if (range.empty()) throw std::runtime_error("color range must not be empty");
+        const size_t height = field.size() / width;
+        out.width = width * scale;
+        out.height = height * scale;
+        out.pixels.resize(out.width * out.height);
+
+        const double k = (PALETTE_SIZE - 1) / (range.max - range.min);
+        for (size_t y = 0; y < height; ++y) {
+            uint8_t * row = out.pixels.data() + y * scale * out.width;
+            for (size_t x = 0; x < width; ++x) {
+                // NaN fails both comparisons and takes the low end
+                const double t = (field[y * width + x] - range.min) * k;
+                const uint8_t index = t > 0.0
+                    ? (t < PALETTE_SIZE - 1 ? static_cast<uint8_t>(t + 0.5) : PALETTE_SIZE - 1)
+                    : 0;
+                std::fill_n(row + x * scale, scale, index);
+            }
+            for (size_t r = 1; r < scale; ++r) {
+                std::copy_n(row, out.width, row + r * out.width);
+            }
+        }
+    }
+
+    GifEncoder::GifEncoder(const std::string & path, const Palette & palette, const unsigned delay):
+        palette(palette),
+        delay(delay),
+        keys(LZW_TABLE_SIZE),
+        codes(LZW_TABLE_SIZE) {
+        file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) throw std::runtime_error("failed to open " + path);
+    }
+
+    GifEncoder::~GifEncoder() {
+        try {
+            close();
+        } catch (...) {}
+    }
+
+    void GifEncoder::close() {
+        if (file == nullptr) return;
+        const bool complete = width == 0 or std::fputc(0x3b, file) != EOF;
+        const bool closed = std::fclose(file) == 0;
+        file = nullptr;
+        if (not complete or not closed) throw std::runtime_error("failed to write the image");
+    }
+
+    // the logical screen with the global color table and
+    // the NETSCAPE2.0 extension that loops the animation
+    void GifEncoder::write_header() {
+        std::vector<uint8_t> out = {'G', 'I', 'F', '8', '9', 'a'};
+        put16le(out, width);
+        put16le(out, height);
+        // a global table of 2^(7 + 1) colors of 8 bits
+        out.insert(out.end(), {0xf7, 0, 0});
+        for (const Color & c: palette) out.insert(out.end(), {c.r, c.g, c.b});
+        out.insert(out.end(), {0x21, 0xff, 11});
+        for (const char c: std::string_view("NETSCAPE2.0")) out.push_back(static_cast<uint8_t>(c));
+        out.insert(out.end(), {3, 1, 0, 0, 0});
+        write_bytes(file, out);
+    }
+
+    size_t GifEncoder::append(const Framebuffer & frame) {
+        if (file == nullptr) throw std::runtime_error("GIF encoder is closed");
+        if (frame.width == 0 or frame.height == 0 or frame.width > 0xffff or frame.height > 0xffff)
+            throw std::runtime_error("GIF frames must be 1 to 65535 pixels wide and high");
+        if (width == 0) {
+            width = frame.width;
+            height = frame.height;
+            write_header();
+        } else if (frame.width != width or frame.height != height) {
+            throw std::runtime_error("GIF frames must be of the same size");
+        }
+        compress(frame.pixels);
+
+        // graphic control extension (the delay), image descriptor
+        // and the code stream in sub-blocks of 255 bytes at most
+        std::vector<uint8_t> out = {0x21, 0xf9, 4, 0};
+        put16le(out, delay);
+        out.insert(out.end(), {0, 0, 0x2c, 0, 0, 0, 0});
+        put16le(out, width);
+        put16le(out, height);
+        out.insert(out.end(), {0, LZW_MIN_CODE_SIZE});
+        out.reserve(out.size() + stream.size() + stream.size() / 255 + 2);
+        for (size_t i = 0; i < stream.size(); i += 255) {
+            const size_t n = std::min<size_t>(255, stream.size() - i);
+            out.push_back(static_cast<uint8_t>(n));
+            out.insert(out.end(), stream.begin() + i, stream.begin() + i + n);
+        }
+        out.push_back(0);
+        write_bytes(file, out);
+        return out.size();
+    }
+
+    // the code width grows once the last assigned code needs another bit,
+    // the table is cleared when it is full; this is what decoders expect
+    // (they add the entries one code later than the encoder does)
+    void GifEncoder::compress(const std::vector<uint8_t> & pixels) {
+        stream.clear();
+        uint32_t bits = 0;
+        unsigned n_bits = 0;
+        unsigned code_size = LZW_MIN_CODE_SIZE + 1;
+        unsigned next_code = LZW_END + 1;
+        const auto emit = [&](const unsigned code) {
+            bits |= code << n_bits;
+            n_bits += code_size;
+            while (n_bits >= 8) {
+                stream.push_back(static_cast<uint8_t>(bits & 0xff));
+                bits >>= 8;
+                n_bits -= 8;
+            }
+        };
+        const auto reset = [&] {
+            std::fill(codes.begin(), codes.end(), int16_t(-1));
+            code_size = LZW_MIN_CODE_SIZE + 1;
+            next_code = LZW_END + 1;
+        };
+
+        reset();
+        emit(LZW_CLEAR);
+        unsigned prefix = pixels[0];
+        for (size_t i = 1; i < pixels.size(); ++i) {
+            const uint32_t key = prefix << 8 | pixels[i];
+            size_t slot = (key * 2654435761u) >> 19 & (LZW_TABLE_SIZE - 1);
+            while (codes[slot] >= 0 and keys[slot] != key) slot = (slot + 1) & (LZW_TABLE_SIZE - 1);
+            if (codes[slot] >= 0) {
+                prefix = static_cast<unsigned>(codes[slot]);
+                continue;
+            }
+            emit(prefix);
+            keys[slot] = key;
+            codes[slot] = static_cast<int16_t>(next_code);
+            if (next_code >= 1u << code_size) ++code_size;
+            if (next_code == LZW_MAX_CODE) {
+                emit(LZW_CLEAR);
+                reset();
+            } else {
+                ++next_code;
+            }
+            prefix = pixels[i];
+        }
+        emit(prefix);
+        emit(LZW_END);
+        if (n_bits > 0) stream.push_back(static_cast<uint8_t>(bits & 0xff));
+    }
+
+    // signature, IHDR (8-bit indexed), PLTE, a single IDAT of a zlib
+    // stream of stored blocks over the filtered rows, and IEND
+    size_t write_png(const std::string & path, const Framebuffer & frame, const Palette & palette) {
+        if (frame.width == 0 or frame.height == 0) throw std::runtime_error("PNG image must not be empty");
+        std::vector<uint8_t> out = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        std::vector<uint8_t> data;
+        put32be(data, static_cast<uint32_t>(frame.width));
+        put32be(data, static_cast<uint32_t>(frame.height));
+        data.insert(data.end(), {8, 3, 0, 0, 0});
+        put_chunk(out, "IHDR", data);
+
+        data.clear();
+        for (const Color & c: palette) data.insert(data.end(), {c.r, c.g, c.b});
+        put_chunk(out, "PLTE", data);
+
+        // every row is led by its filter type, 0 (none)
+        std::vector<uint8_t> raw;
+        raw.reserve((frame.width + 1) * frame.height);
+        for (size_t y = 0; y < frame.height; ++y) {
+            raw.push_back(0);
+            const auto row = frame.pixels.begin() + y * frame.width;
+            raw.insert(raw.end(), row, row + frame.width);
+        }
+        data.clear();
+        data.reserve(raw.size() + raw.size() / DEFLATE_BLOCK * 5 + 16);
+        data.insert(data.end(), {0x78, 0x01});
+        for (size_t i = 0; i < raw.size(); i += DEFLATE_BLOCK) {
+            const size_t n = std::min(DEFLATE_BLOCK, raw.size() - i);
+            data.push_back(i + n == raw.size() ? 1 : 0);
+            put16le(data, n);
+            put16le(data, ~n & 0xffff);
+            data.insert(data.end(), raw.begin() + i, raw.begin() + i + n);
+        }
+        put32be(data, adler32(raw.data(), raw.size(), 1));
+        put_chunk(out, "IDAT", data);
+        put_chunk(out, "IEND", {});
+
+        FILE * file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) throw std::runtime_error("failed to open " + path);
+        const bool written = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+        if (std::fclose(file) != 0 or not written) throw std::runtime_error("failed to write " + path);
+        return out.size();
+    }
+
+    static image_format format_of(const std::string & path) {
+        const auto ends_with = [&](const std::string_view suffix) {
+            return path.size() >= suffix.size() and path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+        if (ends_with(".gif")) return GIF_ANIMATION;
+        if (ends_with(".png")) return PNG_STILL;
+        throw std::runtime_error("unknown image format of " + path + " (expected .gif or .png)");
+    }
+
+    ImageWriter::ImageWriter(const std::string & path, const ImageOptions & opts):
+        path(path),
+        format(format_of(path)),
+        opts(opts),
+        palette(default_palette()) {
+        if (format == GIF_ANIMATION) gif = std::make_unique<GifEncoder>(path, palette, opts.delay);
+    }
+
+    ImageWriter::ImageWriter(
+        const std::string & path, const size_t n_buffers, const backpressure policy,
+        const ImageOptions & opts
+    ):
+        FrameWriter(n_buffers, policy),
+        path(path),
+        format(format_of(path)),
+        opts(opts),
+        palette(default_palette()) {
+        if (format == GIF_ANIMATION) gif = std::make_unique<GifEncoder>(path, palette, opts.delay);
+    }
+
+    ImageWriter::~ImageWriter() {
+        try {
+            stop();
+        } catch (const std::exception &) {}
+    }
+
+    void ImageWriter::write_frame(util::strided_span<const double> field, const size_t width) {
+        if (range.empty()) range = opts.range.empty() ? value_range(field) : opts.range;
+        const size_t height = field.size() / width;
+        const size_t scale = opts.scale > 0 ? opts.scale : std::max<size_t>(1, FIT_PIXELS / std::max(width, height));
+        {
+            PROF_SCOPE(RENDER);
+            rasterize(field, width, range, scale, frame);
+        }
+        PROF_SCOPE(ENCODE);
+        const size_t bytes = gif ? gif->append(frame) : write_png(path, frame, palette);
+        PROF_COUNT(FRAMES_WRITTEN, 1);
+        PROF_COUNT(BYTES_WRITTEN, bytes);
+        (void) bytes;
+    }
+}
@@ -0,0 +1,87 @@
+#include "schedule.hpp"
+
+#include <cmath>
+
+namespace io {
+    OutputScheduler::OutputScheduler(const ScheduleOptions & opts): opts(opts) {
+        if (opts.every_time < 0.0 or opts.every_seconds < 0.0 or opts.change_threshold < 0.0)
+            throw std::runtime_error("output schedule intervals must not be negative");
+    }
+
+    bool OutputScheduler::due(const size_t step, const double time, util::strided_span<const double> field) const {
+        if (not any_emitted) return true;
+
+        const bool enabled = opts.every_steps > 0 or opts.every_time > 0.0
+            or opts.every_seconds > 0.0 or opts.change_threshold > 0.0;
+        if (not enabled) return true;
+
+        if (opts.every_steps > 0 and step % opts.every_steps == 0) return true;
+        // tolerate the rounding of time = step * dt
+        if (opts.every_time > 0.0 and time >= next_time - 1e-9 * opts.every_time) return true;
+        if (opts.every_seconds > 0.0
+            and std::chrono::duration<double>(clock::now() - last_wall).count() >= opts.every_seconds)
+            return true;
+        if (opts.change_threshold > 0.0) {
+            for (size_t i = 0; i < field.size(); ++i) {
+                if (std::abs(field[i] - reference[i]) > opts.change_threshold) return true;
+            }
+        }
+        return false;
+    }
+
+    void OutputScheduler::emit(const size_t step, const double time, util::strided_span<const double> field) {
+        for (const auto & s: sinks) s(step, time, field);
+        ++emitted_frames;
+        mark(step, time, field);
+    }
+
+    void OutputScheduler::mark(const size_t step, const double time, util::strided_span<const double> field) {
+        any_emitted = true;
+        last_step = step;
+        if (opts.every_time > 0.0) {
+            // the next multiple of the interval past the current time
+            next_time = (std::floor(time / opts.every_time + 1e-9) + 1.0) * opts.every_time;
+        }
+        if (opts.every_seconds > 0.0) last_wall = clock::now();
+        if (opts.change_threshold > 0.0) reference.assign(field.begin(), field.end());
+    }
+
+    bool OutputScheduler::offer(const size_t step, const double time, util::strided_span<const double> field) {
+        if (not due(step, time, field)) return false;
+        emit(step, time, field);
+        return true;
+    }
+
+    bool OutputScheduler::force(const size_t step, const double time, util::strided_span<const double> field) {
+        if (any_emitted and last_step == step) return false;
+        emit(step, time, field);
+        return true;
+    }
+
+    ProgressPrinter::ProgressPrinter(
+        std::ostream & os, const std::string & prefix, const size_t total, const double interval_seconds
+    ):
+        os(os),
+        prefix(prefix),
+        total(total),
+        interval(interval_seconds) {}
+
+    void ProgressPrinter::update(const size_t iter) {
+        const auto now = OutputScheduler::clock::now();
+        if (printed and now - last_print < interval) return;
+        printed = true;
+        last_print = now;
+        print(iter);
+    }
+
+    void ProgressPrinter::finish(const size_t iter) {
+        print(iter);
+    }
+
+    void ProgressPrinter::print(const size_t iter) {
+        os << '\r' << prefix << "iter [" << iter;
+        if (total > 0) os << '/' << total;
+        os << ']';
+        os.flush();
+    }
+}
@@ -0,0 +1,140 @@
+#include "scheduler.hpp"
+
+namespace solver {
+    // attempts of an idle thread to find a task before it goes to sleep
+    constexpr size_t IDLE_SPINS = 64;
+
+    size_t TaskGraph::add_task() {
+        successors.emplace_back();
+        n_predecessors.push_back(0);
+        return successors.size() - 1;
+    }
+
+    void TaskGraph::add_dependency(const size_t before, const size_t after) {
+        if (before >= size() or after >= size()) throw std::runtime_error("dependency on an unknown task");
+        if (before == after) throw std::runtime_error("task cannot depend on itself");
+        successors[before].push_back(after);
+        ++n_predecessors[after];
+    }
+
+    TaskScheduler::TaskScheduler(const size_t n_threads):
+        n_threads(n_threads) {
+        if (n_threads == 0) throw std::runtime_error("number of threads must be positive");
+        queues = std::make_unique<Queue[]>(n_threads);
+    }
+
+    // the own deque from the back, the others' from the front
+    bool TaskScheduler::pop(const size_t thread_id, size_t & task) {
+        if (queued.load() == 0) return false;
+        for (size_t i = 0; i < n_threads; ++i) {
+            Queue & q = queues[(thread_id + i) % n_threads];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (q.tasks.empty()) continue;
+            if (i == 0) {
+                task = q.tasks.back();
+                q.tasks.pop_back();
+            } else {
+                task = q.tasks.front();
+                q.tasks.pop_front();
+            }
+            --queued;
+            return true;
+        }
+        return false;
+    }
+
+    void TaskScheduler::push(const size_t thread_id, const size_t task) {
+        {
+            Queue & own = queues[thread_id];
+            std::lock_guard<std::mutex> guard(own.lock);
+            own.tasks.push_back(task);
+        }
+        ++queued;
+    }
+
+    // a sleeper either sees the tasks counted in queued or is asleep by
+    // the time park_lock is taken here, so the notification is not lost
+    void TaskScheduler::wake(const size_t n) {
+        if (n == 0 or sleeping.load() == 0) return;
+        { std::lock_guard<std::mutex> guard(park_lock); }
+        for (size_t i = 0; i < n; ++i) ready.notify_one();
+    }
+
+    void TaskScheduler::park() {
+        std::unique_lock<std::mutex> guard(park_lock);
+        ++sleeping;
+        ready.wait(guard, [&] { return queued.load() > 0 or remaining.load() == 0 or failed.load(); });
+        --sleeping;
+    }
+
+    void TaskScheduler::wake_all() {
+        { std::lock_guard<std::mutex> guard(park_lock); }
+        ready.notify_all();
+    }
+
+    void TaskScheduler::work(const TaskGraph & graph, const size_t thread_id, const task & t) {
+        size_t idle = 0;
+        while (remaining.load(std::memory_order_acquire) > 0 and not failed.load(std::memory_order_relaxed)) {
+            size_t next;
+            if (not pop(thread_id, next)) {
+                // the tasks left wait for the ones running on the other threads:
+                // the ones about to finish are waited for here, the thread
+                // sleeps instead of giving up the core over and over
+                if (++idle == IDLE_SPINS) {
+                    park();
+                    idle = 0;
+                }
+                continue;
+            }
+            idle = 0;
+            try {
+                t(thread_id, next);
+            } catch (...) {
+                failed = true;
+                wake_all();
+                throw;
+            }
+            // the last predecessor to finish makes the task ready,
+            // the writes of all of them happen before it runs. The thread
+            // takes one of the tasks it has made ready itself, the sleepers
+            // are only woken for the rest
+            size_t made_ready = 0;
+            for (const size_t s: graph.successors_of(next)) {
+                if (pending[s].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    push(thread_id, s);
+                    ++made_ready;
+                }
+            }
+            if (made_ready > 1) wake(made_ready - 1);
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) wake_all();
+        }
+    }
+
+    void TaskScheduler::run(const TaskGraph & graph, ThreadPool * pool, const task & t) {
+        const size_t n = graph.size();
+        if (pool != nullptr and pool->size() != n_threads)
+            throw std::runtime_error("thread pool does not match the scheduler");
+        if (capacity < n) {
+            pending = std::make_unique<std::atomic<size_t>[]>(n);
+            capacity = n;
+        }
+        for (size_t i = 0; i < n_threads; ++i) queues[i].tasks.clear();
+        // dealt from the last one so that the lowest ids are at the backs
+        const size_t threads = pool != nullptr ? n_threads : 1;
+        size_t dealt = 0;
+        for (size_t i = 0; i < n; ++i) {
+            pending[i].store(graph.predecessors_of(i), std::memory_order_relaxed);
+            if (graph.predecessors_of(i) == 0) ++dealt;
+        }
+        for (size_t i = n, k = dealt; i-- > 0; ) {
+            if (graph.predecessors_of(i) == 0) queues[--k % threads].tasks.push_back(i);
+        }
+        queued = dealt;
+        sleeping = 0;
+        remaining.store(n, std::memory_order_release);
+        failed = false;
+
+        if (pool == nullptr) work(graph, 0, t);
+        else pool->run([&](const size_t thread_id) { work(graph, thread_id, t); });
+    }
+}
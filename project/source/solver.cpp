@@ -1,20 +1,34 @@
 #include "solver.hpp"
+#include "profile.hpp"
 
 #include <algorithm>
 #include <iostream>
 
 constexpr bool VERBOSE = false;
+// number of columns transposed at a time by the transposed y-sweep
+constexpr size_t TILE_WIDTH = 32;
+// SPLIT_AUTO splits a sweep with a segment that long at least, a
+// partition of a split line keeps that many equations at least
+constexpr size_t MIN_SPLIT_LENGTH = 4096;
+constexpr size_t MIN_PARTITION = 256;
+// the wavefront engine tiles the field into bands of rows of about that
+// many bytes (a band is still in L2 when the columns are swept over it)
+// and blocks of that many columns
+constexpr size_t WAVEFRONT_BAND_BYTES = 256 * 1024;
+constexpr size_t WAVEFRONT_BLOCK = 512;
 
 namespace solver {
 
-    TDMA::TDMA(const size_t diagonal_length):
+    template <typename Real>
+    BasicTDMA<Real>::BasicTDMA(const size_t diagonal_length):
     c_star(diagonal_length, 0), d_star(diagonal_length, 0) {}
 
-    void TDMA::solve(
-        const tridiagonal_mx_extended & SLE,
-        diagonal & storage
+    template <typename Real>
+    void BasicTDMA<Real>::solve(
+        const basic_tridiagonal_mx<Real> & SLE,
+        basic_diagonal<Real> & storage
     ) {
-        const diagonal a = SLE[0], b = SLE[1], c = SLE[2], d = SLE[3];
+        const basic_diagonal<Real> & a = SLE[0], & b = SLE[1], & c = SLE[2], & d = SLE[3];
         const size_t N = b.size();
 
         if (N != a.size())
@@ -34,28 +48,125 @@ namespace solver {
             << c_star.size()
             << " now: "
             << N;
-            c_star = diagonal(N, 0);
-            d_star = diagonal(N, 0);
+            c_star = basic_diagonal<Real>(N, 0);
+            d_star = basic_diagonal<Real>(N, 0);
         }
 
+        solve(N, a.data(), b.data(), c.data(), d.data(), storage.data());
+    }
+
+    template <typename Real>
+    void BasicTDMA<Real>::solve(
+        const size_t N,
+        const Real * a,
+        const Real * b,
+        const Real * c,
+        const Real * d,
+        Real * storage
+    ) {
+        solve(a, b, c, {d, N}, {storage, N});
+    }
+
+    template <typename Real>
+    void BasicTDMA<Real>::solve(
+        const Real * a,
+        const Real * b,
+        const Real * c,
+        util::strided_span<const Real> d,
+        util::strided_span<Real> x
+    ) {
+        const size_t N = x.size();
+        if (N == 0 or N > c_star.size())
+            throw std::runtime_error("system does not fit the solver");
+        if (d.size() != N)
+            throw std::runtime_error("dimension mismatch for d");
+
         // update the coefficients in the first row
-        c_star[0] = c[0] / b[0];
-        d_star[0] = d[0] / b[0];
+        const Real w = Real(1) / b[0];
+        c_star[0] = c[0] * w;
+        d_star[0] = d[0] * w;
 
         // update other coefficients iteratively
         for (size_t i = 1; i < N; ++i) {
-            const double w = 1.0 / (b[i] - a[i] * c_star[i-1]);
+            const Real w = Real(1) / (b[i] - a[i] * c_star[i-1]);
             c_star[i] = c[i] * w;
             d_star[i] = (d[i] - a[i] * d_star[i-1]) * w;
         }
 
-        // store the solution in the storage
+        // store the solution in x (back substitution goes
+        // over the solution itself, the last unknown is known right away)
+        x[N - 1] = d_star[N - 1];
         for (size_t i = N - 1; i-- > 0; ) {
-            storage[i] = d_star[i] - c_star[i] * d[i+1];
+            x[i] = d_star[i] - c_star[i] * x[i+1];
+        }
+        PROF_COUNT(EQUATIONS_SOLVED, N);
+    }
+
+    template <typename Real>
+    void BasicTDMA<Real>::factorize(
+        const basic_tridiagonal_mx<Real> & SLE,
+        Real * c_star,
+        Real * inv_pivot
+    ) {
+        const basic_diagonal<Real> & a = SLE[0], & b = SLE[1], & c = SLE[2];
+        const size_t N = b.size();
+
+        if (N != a.size())
+            throw std::runtime_error("dimension mismatch for a");
+        if (N != c.size())
+            throw std::runtime_error("dimension mismatch for c");
+
+        // same recurrence as in solve(), minus the RHS
+        inv_pivot[0] = Real(1) / b[0];
+        c_star[0] = c[0] * inv_pivot[0];
+        for (size_t i = 1; i < N; ++i) {
+            inv_pivot[i] = Real(1) / (b[i] - a[i] * c_star[i-1]);
+            c_star[i] = c[i] * inv_pivot[i];
         }
     }
 
-    static void pprint_tridiag_matrix(const tridiagonal_mx_extended & mx, std::ostream & out) {
+    template <typename Real>
+    void BasicTDMA<Real>::solve_factorized(
+        const size_t N,
+        const Real * a,
+        const Real * c_star,
+        const Real * inv_pivot,
+        const Real * d,
+        Real * storage
+    ) {
+        solve_factorized(a, c_star, inv_pivot, {d, N}, {storage, N});
+    }
+
+    template <typename Real>
+    void BasicTDMA<Real>::solve_factorized(
+        const Real * a,
+        const Real * c_star,
+        const Real * inv_pivot,
+        util::strided_span<const Real> d,
+        util::strided_span<Real> x
+    ) {
+        const size_t N = x.size();
+        if (d.size() != N)
+            throw std::runtime_error("dimension mismatch for d");
+
+        // d^* goes straight to x and is then overwritten
+        // by the back substitution, d[i] is read before x[i]
+        // is written, so the RHS may be solved in place (d == x)
+        x[0] = d[0] * inv_pivot[0];
+        for (size_t i = 1; i < N; ++i) {
+            x[i] = (d[i] - a[i] * x[i-1]) * inv_pivot[i];
+        }
+        for (size_t i = N - 1; i-- > 0; ) {
+            x[i] = x[i] - c_star[i] * x[i+1];
+        }
+        PROF_COUNT(EQUATIONS_SOLVED, N);
+    }
+
+    template class BasicTDMA<double>;
+    template class BasicTDMA<float>;
+
+    template <typename Real>
+    static void pprint_tridiag_matrix(const basic_tridiagonal_mx<Real> & mx, std::ostream & out) {
         const size_t diag_length = mx[0].size();
         if (diag_length == 0) throw std::runtime_error("zero-length matrix");
 
@@ -77,130 +188,786 @@ namespace solver {
 
     }
 
-    static void pprint_solution_row(const diagonal & d, std::ostream & os) {
+    template <typename Line>
+    static void pprint_solution_row(const Line & d, std::ostream & os) {
         os << "solution: ";
         for (const auto & e: d)
             os << e << ' ';
         os << '\n';
     }
 
-    Problem::Problem(model::IModel & model, const size_t n_iters):
-        n_iters(n_iters),
-        m(model),
-        solver_x(model.x_dim()),
-        solver_y(model.y_dim()),
+    template <typename Model, typename Real>
+    BasicProblem<Model, Real>::Workspace::Workspace(const size_t x_dim, const size_t y_dim, const ProblemOptions & opts):
+        solver_x(x_dim),
+        solver_y(y_dim),
         mx_x({
             // SLE contains 3 diagonals (a, b & c) and the RHS (d)
             // see https://quantstart.com/articles/Tridiagonal-Matrix-Solver-via-Thomas-Algorithm/
-            diagonal(model.x_dim(), 0),
-            diagonal(model.x_dim(), 0),
-            diagonal(model.x_dim(), 0),
-            diagonal(model.x_dim(), 0)
+            diagonal(x_dim, 0),
+            diagonal(x_dim, 0),
+            diagonal(x_dim, 0),
+            diagonal(x_dim, 0)
         }),
         mx_y({
-            diagonal(model.y_dim(), 0),
-            diagonal(model.y_dim(), 0),
-            diagonal(model.y_dim(), 0),
-            diagonal(model.y_dim(), 0)
+            diagonal(y_dim, 0),
+            diagonal(y_dim, 0),
+            diagonal(y_dim, 0),
+            diagonal(y_dim, 0)
         }),
-        f_x(model.x_dim()),
-        f_y(model.y_dim()) {}
+        f_x(x_dim),
+        f_y(y_dim) {
+        if (opts.transpose_y) tile.resize(TILE_WIDTH * y_dim);
+        if (opts.mode != BATCHED) return;
 
-    void Problem::step() {
+        // each lane of a batch holds its own row (column),
+        // so the interleaved storage is width times larger
+        const size_t width = BasicBatchedTDMA<Real>::native_width();
+        const size_t x_len = x_dim * width;
+        const size_t y_len = y_dim * width;
+        batched_x = BasicBatchedTDMA<Real>(x_dim, width);
+        batched_y = BasicBatchedTDMA<Real>(y_dim, width);
+        bmx_x = {diagonal(x_len, 0), diagonal(x_len, 0), diagonal(x_len, 0), diagonal(x_len, 0)};
+        bmx_y = {diagonal(y_len, 0), diagonal(y_len, 0), diagonal(y_len, 0), diagonal(y_len, 0)};
+        bf_x = diagonal(x_len, 0);
+        bf_y = diagonal(y_len, 0);
+    }
+
+    // the transposed y-sweep only moves the RHS and the solution through
+    // the column-major tile and the tiles of the wavefront sweep the columns
+    // band by band, the matrices come from the cached factorization in both
+    static ProblemOptions normalized(ProblemOptions opts) {
+        if (opts.mode == BATCHED) {
+            opts.transpose_y = false;
+            opts.wavefront = false;
+        }
+        if (opts.transpose_y or opts.wavefront) opts.prefactorize = true;
+        return opts;
+    }
+
+    template <typename Model, typename Real>
+    BasicProblem<Model, Real>::BasicProblem(Model & model, const size_t n_iters, const ProblemOptions & options):
+        n_iters(n_iters),
+        opts(normalized(options)),
+        m(model) {
+        if (opts.n_threads == 0) throw std::runtime_error("number of threads must be positive");
+        workspaces.reserve(opts.n_threads);
+        for (size_t t = 0; t < opts.n_threads; ++t) {
+            workspaces.emplace_back(model.x_dim(), model.y_dim(), opts);
+        }
+        if (opts.n_threads > 1) pool = std::make_unique<ThreadPool>(opts.n_threads);
+        compile_segments();
+        split_x = should_split(segments_x, model.y_dim());
+        split_y = should_split(segments_y, model.x_dim());
+        if (opts.prefactorize) factorize();
+        if (split_x or split_y) factorize_partitions();
+        if (opts.wavefront) build_wavefront();
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::compile_segments() {
+        const size_t x_dim = m.x_dim(), y_dim = m.y_dim();
+        Workspace & ws = workspaces.front();
+        segments_x = {{}, {0}};
+        segments_y = {{}, {0}};
+        for (size_t y = 0; y < y_dim; ++y) {
+            assemble_row(ws.mx_x, y, {0, x_dim});
+            segments_x.add_line(ws.mx_x, x_dim);
+        }
+        for (size_t x = 0; x < x_dim; ++x) {
+            assemble_col(ws.mx_y, x, {0, y_dim});
+            segments_y.add_line(ws.mx_y, y_dim);
+        }
+    }
+
+    template <typename Model, typename Real>
+    size_t BasicProblem<Model, Real>::active_equations() const {
+        size_t n = 0;
+        for (const Segments * segments: {&segments_x, &segments_y}) {
+            for (const Segment & s: segments->segments) n += s.last - s.first;
+        }
+        return n;
+    }
+
+    template <typename Model, typename Real>
+    template <typename Sweep>
+    void BasicProblem<Model, Real>::for_each_chunk(const size_t n, const size_t grain, const Sweep & sweep) {
+        if (not pool) {
+            sweep(workspaces.front(), 0, n);
+            return;
+        }
+        // static partitioning: the lines are equally costly
+        // and each thread gets a contiguous range of them
+        const size_t n_threads = pool->size();
+        const size_t n_grains = (n + grain - 1) / grain;
+        pool->run([&](const size_t t) {
+            const size_t first = std::min(n, t * n_grains / n_threads * grain);
+            const size_t last = std::min(n, (t + 1) * n_grains / n_threads * grain);
+            if (first < last) sweep(workspaces[t], first, last);
+        });
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::step() {
         if (current_step++ == n_iters) throw std::runtime_error("out of iterations");
+        PROF_SCOPE(STEP);
+        PROF_COUNT(STEPS, 1);
+        // the cached factorizations are stale once
+        // the model parameters have been changed
+        if (opts.prefactorize and factorized_revision != m.revision()) factorize();
+        if (can_pipeline()) {
+            step_wavefront();
+            return;
+        }
         // performs simulation step and stores the
         // result in the grid of the model
         const size_t x_dim = m.x_dim(), y_dim = m.y_dim();
+        const bool batched = opts.mode == BATCHED;
+        const size_t grain = batched ? workspaces.front().batched_x.lanes() : 1;
 
         // first, solve the 1D subproblems in the horizontal direction
         // --> y_dim systems for each grid row
         // and update the current values at each node
-        for (size_t y = 0; y < y_dim; ++y) {
-            // solve SLE for row y
-            // boundary conditions on edge:
-            model::boundary_coefs bc = m.get_x_first_coefs(y);
-            // unpack the duple into diagonals
-            // once again, see https://quantstart.com/articles/Tridiagonal-Matrix-Solver-via-Thomas-Algorithm/
-            mx_x[1][0] = bc[0];
-            mx_x[2][0] = bc[1];
-            mx_x[3][0] = m.get_RHS_coefs_x(0, y);
-
-            for (size_t x = 1; x < x_dim - 1; ++x) {
-                // unpack triples into diagonals + right-hand side into d
-                const model::tridiag_coefs tc = m.get_x_coefs(x, y);
-                mx_x[0][x] = tc[0];
-                mx_x[1][x] = tc[1];
-                mx_x[2][x] = tc[2];
-                mx_x[3][x] = m.get_RHS_coefs_x(x, y);
-            }
-
-            bc = m.get_x_last_coefs(y);
-            mx_x[0][x_dim - 1] = bc[0];
-            mx_x[1][x_dim - 1] = bc[1];
-            mx_x[3][x_dim - 1] = m.get_RHS_coefs_x(x_dim - 1, y);
-
-            // call solver and update current values in the row
-            // std::cout << "matrix " << y << "\n";
-            solver_x.solve(mx_x, f_x);
-            if (VERBOSE) {
-                pprint_tridiag_matrix(mx_x, std::cout);
-                pprint_solution_row(f_x, std::cout);
-            }
-            // std::getchar();
-            update_grid_row(y);
-        }
-
-        // then solve in the vertical direction -->
+        if ((split_x or split_y) and partitioned_revision != m.revision()) factorize_partitions();
+        // the explicit part of an ADI sweep reads the neighbouring lines,
+        // so it is evaluated for all of them before any line is solved
+        const bool adi = m.scheme() == model::PEACEMAN_RACHFORD;
+        if (adi) for_each_chunk(y_dim, 1, [&](Workspace &, const size_t first, const size_t last) {
+            PROF_SCOPE(ASSEMBLE_X);
+            m.prepare_rhs(model::HORIZONTAL, first, last);
+        });
+        if (split_x) solve_rows_split();
+        else for_each_chunk(y_dim, grain, [&](Workspace & ws, const size_t first, const size_t last) {
+            if (batched) solve_rows_batched(ws, first, last);
+            else solve_rows(ws, first, last);
+        });
+
+        // every row is done by now (pool.run() returns only after
+        // all threads have finished), so the columns may be solved:
         // x_dim systems for each grid column
-        // and update the current values at each node
-        for (size_t x = 0; x < x_dim; ++x) {
-            // solve SLE for column x
-            // boundary conditions on edge:
-            model::boundary_coefs bc = m.get_y_first_coefs(x);
-            // unpack the duple into diagonals
-            // once again, see https://quantstart.com/articles/Tridiagonal-Matrix-Solver-via-Thomas-Algorithm/
-            mx_y[1][0] = bc[0];
-            mx_y[2][0] = bc[1];
-            mx_y[3][0] = m.get_RHS_coefs_y(x, 0);
-
-            for (size_t y = 1; y < y_dim - 1; ++y) {
-                const model::tridiag_coefs tc = m.get_y_coefs(x, y);
-                mx_y[0][y] = tc[0];
-                mx_y[1][y] = tc[1];
-                mx_y[2][y] = tc[2];
-                mx_y[3][y] = m.get_RHS_coefs_y(x, y);
-            }
-
-            bc = m.get_y_last_coefs(x);
-            mx_y[0][y_dim - 1] = bc[0];
-            mx_y[1][y_dim - 1] = bc[1];
-            mx_y[3][y_dim - 1] = m.get_RHS_coefs_y(x, y_dim - 1);
-
-            // call solver and update current values in the column
-            // std::cout << "matrix " << x << "\n";
-            // std::getchar();
-            solver_y.solve(mx_y, f_y);
-            if (VERBOSE) {
-                pprint_tridiag_matrix(mx_y, std::cout);
-                pprint_solution_row(f_y, std::cout);
-            }
-            update_grid_col(x);
-        }
-    }
-
-    void Problem::update_grid_row(const size_t y) {
-        size_t i = 0;
-        std::for_each(
-            f_x.cbegin(), f_x.cend(),
-            [&](const double & f) { m.set_current_value(i++, y, f); }
-        );
-    }
-
-    void Problem::update_grid_col(const size_t x) {
-        size_t i = 0;
-        std::for_each(
-            f_y.cbegin(), f_y.cend(),
-            [&](const double & f) { m.set_current_value(x, i++, f); }
-        );
+        if (adi) for_each_chunk(y_dim, 1, [&](Workspace &, const size_t first, const size_t last) {
+            PROF_SCOPE(ASSEMBLE_Y);
+            m.prepare_rhs(model::VERTICAL, first, last);
+        });
+        if (split_y) solve_cols_split();
+        else for_each_chunk(x_dim, grain, [&](Workspace & ws, const size_t first, const size_t last) {
+            if (batched) solve_cols_batched(ws, first, last);
+            else if (opts.transpose_y) solve_cols_transposed(ws, first, last);
+            else solve_cols(ws, first, last);
+        });
+        if (adi) for_each_chunk(y_dim, 1, [&](Workspace &, const size_t first, const size_t last) {
+            PROF_SCOPE(SCATTER_Y);
+            m.restore_conditions(first, last);
+        });
+    }
+
+    // the field is tiled into the bands of rows (two per thread at least,
+    // so that their x-sweeps keep the threads busy) and the blocks of
+    // columns, the tasks over them are:
+    //   X(b)     x-sweep of the rows of band b
+    //   F(b, k)  forward sweep of the columns of block k over the rows
+    //            of band b, after X(b) and F(b - 1, k)
+    //   B(b, k)  back substitution of the same tile, after B(b + 1, k),
+    //            or after F(b, k) for the last band
+    // F(b, k) thus reads the rows X(b) has just solved while they are in
+    // cache, and the columns of a block are substituted from the bottom up
+    // as soon as their forward sweep reaches it, over the tiles it has
+    // just left. The y-sweep does not wait for the x-sweep of the whole
+    // field, the threads only wait for the tiles a task depends on
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::build_wavefront() {
+        const size_t x_dim = m.x_dim(), y_dim = m.y_dim();
+        const size_t most_rows = std::max<size_t>(1, y_dim / (2 * opts.n_threads));
+        const size_t band_rows = std::clamp<size_t>(WAVEFRONT_BAND_BYTES / (x_dim * sizeof(Real)), 1, most_rows);
+        bands.clear();
+        blocks.clear();
+        for (size_t y = 0; y < y_dim; y += band_rows) bands.push_back({y, std::min(y + band_rows, y_dim)});
+        for (size_t x = 0; x < x_dim; x += WAVEFRONT_BLOCK) blocks.push_back({x, std::min(x + WAVEFRONT_BLOCK, x_dim)});
+
+        // X(b) is the task b, F(b, k) and B(b, k) follow band by band
+        const size_t n_bands = bands.size(), n_blocks = blocks.size();
+        const auto forward = [&](const size_t b, const size_t k) { return n_bands + b * n_blocks + k; };
+        const auto backward = [&](const size_t b, const size_t k) { return n_bands * (1 + n_blocks) + b * n_blocks + k; };
+        wavefront = TaskGraph();
+        for (size_t t = 0; t < n_bands * (1 + 2 * n_blocks); ++t) wavefront.add_task();
+        for (size_t b = 0; b < n_bands; ++b) {
+            for (size_t k = 0; k < n_blocks; ++k) {
+                wavefront.add_dependency(b, forward(b, k));
+                if (b > 0) wavefront.add_dependency(forward(b - 1, k), forward(b, k));
+                if (b + 1 < n_bands) wavefront.add_dependency(backward(b + 1, k), backward(b, k));
+                else wavefront.add_dependency(forward(b, k), backward(b, k));
+            }
+        }
+        scheduler = std::make_unique<TaskScheduler>(opts.n_threads);
+    }
+
+    // the x-sweep of a row must not read the other rows and the columns
+    // are swept in place, so the tiles take the LOD steps of the field of
+    // the precision of the elimination only
+    template <typename Model, typename Real>
+    bool BasicProblem<Model, Real>::can_pipeline() const {
+        return IN_PLACE and opts.wavefront and m.scheme() == model::LOCALLY_ONE_DIMENSIONAL and not split_x and not split_y;
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::step_wavefront() {
+        const size_t n_bands = bands.size(), n_tiles = bands.size() * blocks.size();
+        scheduler->run(wavefront, pool.get(), [&](const size_t thread_id, const size_t task) {
+            if (task < n_bands) {
+                solve_rows(workspaces[thread_id], bands[task].first, bands[task].last);
+                return;
+            }
+            const size_t tile = (task - n_bands) % n_tiles;
+            const Segment band = bands[tile / blocks.size()], block = blocks[tile % blocks.size()];
+            if (task < n_bands + n_tiles) eliminate_tile(band, block);
+            else substitute_tile(band, block);
+        });
+    }
+
+    // the tiles sweep the columns of a block together, row after row, with
+    // factors_y laid out row-major (see factorize()): the inner loops go
+    // along the rows of the field. They solve the whole columns, the pinned
+    // equations included (a = c^* = 0 and a unit pivot keep their nodes as
+    // they are), which gives the very same solution as the active segments
+    // alone. The forward sweep leaves d^* in the field, which the back
+    // substitution turns into the solution
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::eliminate_tile(const Segment band, const Segment block) {
+        if constexpr (not IN_PLACE) {
+            throw std::logic_error("tiles are only solved in a field of the precision of the elimination");
+        } else {
+            const size_t x_dim = m.x_dim(), width = block.last - block.first;
+            Real * const field = m.row(0).data();
+            {
+                PROF_SCOPE(ASSEMBLE_Y);
+                m.fill_y_rhs_tile(band.first, band.last, block.first, block.last, field, x_dim);
+            }
+            PROF_SCOPE(SOLVE_Y);
+            for (size_t y = band.first; y < band.last; ++y) {
+                const size_t offset = y * x_dim + block.first;
+                Real * const f = field + offset;
+                const Real * const inv_pivot = &factors_y.inv_pivot[offset];
+                if (y == 0) {
+                    for (size_t i = 0; i < width; ++i) f[i] = f[i] * inv_pivot[i];
+                    continue;
+                }
+                const Real * const a = &factors_y.a[offset];
+                const Real * const above = f - x_dim;
+                for (size_t i = 0; i < width; ++i) f[i] = (f[i] - a[i] * above[i]) * inv_pivot[i];
+            }
+            PROF_COUNT(EQUATIONS_SOLVED, (band.last - band.first) * width);
+            PROF_COUNT(NODES_UPDATED, (band.last - band.first) * width);
+        }
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::substitute_tile(const Segment band, const Segment block) {
+        if constexpr (not IN_PLACE) {
+            throw std::logic_error("tiles are only solved in a field of the precision of the elimination");
+        } else {
+            const size_t x_dim = m.x_dim(), y_dim = m.y_dim(), width = block.last - block.first;
+            Real * const field = m.row(0).data();
+            PROF_SCOPE(SOLVE_Y);
+            // the last row is its d^* already
+            for (size_t y = std::min(band.last, y_dim - 1); y-- > band.first; ) {
+                const size_t offset = y * x_dim + block.first;
+                Real * const f = field + offset;
+                const Real * const c_star = &factors_y.c_star[offset];
+                const Real * const below = f + x_dim;
+                for (size_t i = 0; i < width; ++i) f[i] = f[i] - c_star[i] * below[i];
+            }
+            if (band.first == 0) PROF_COUNT(LINES_SOLVED, width);
+        }
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::resume_at(const size_t step) {
+        if (step > n_iters) throw std::runtime_error("restart step is past the last iteration");
+        current_step = step;
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::assemble_row(
+        tridiagonal_mx_extended & mx,
+        const size_t y,
+        const Segment s,
+        const size_t width,
+        const size_t lane
+    ) const {
+        // SLE contains 3 diagonals (a, b & c) and the RHS (d)
+        // see https://quantstart.com/articles/Tridiagonal-Matrix-Solver-via-Thomas-Algorithm/
+        m.fill_x_line(y, s.first, s.last, &mx[0][lane], &mx[1][lane], &mx[2][lane], &mx[3][lane], width);
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::assemble_col(
+        tridiagonal_mx_extended & mx,
+        const size_t x,
+        const Segment s,
+        const size_t width,
+        const size_t lane
+    ) const {
+        m.fill_y_line(x, s.first, s.last, &mx[0][lane], &mx[1][lane], &mx[2][lane], &mx[3][lane], width);
     }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::assemble_row_rhs(diagonal & d, const size_t y, const Segment s, const size_t width, const size_t lane) const {
+        m.fill_x_rhs(y, s.first, s.last, &d[lane], width);
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::assemble_col_rhs(diagonal & d, const size_t x, const Segment s, const size_t width, const size_t lane) const {
+        m.fill_y_rhs(x, s.first, s.last, &d[lane], width);
+    }
+
+    // lanes of a batch past the last line are padded with x = 0 systems
+    template <typename Real>
+    static void assemble_identity(
+        basic_tridiagonal_mx<Real> & mx,
+        const Segment s,
+        const size_t width,
+        const size_t lane
+    ) {
+        for (size_t i = s.first; i < s.last; ++i) {
+            mx[0][i * width + lane] = 0;
+            mx[1][i * width + lane] = 1.0;
+            mx[2][i * width + lane] = 0;
+            mx[3][i * width + lane] = 0;
+        }
+    }
+
+    // n lines of length l stored line after line turn into l lines of
+    // length n, copied in TILE_WIDTH x TILE_WIDTH squares
+    template <typename Real>
+    static void transpose(basic_diagonal<Real> & lines, const size_t n, const size_t l) {
+        basic_diagonal<Real> t(lines.size(), 0);
+        for (size_t i0 = 0; i0 < n; i0 += TILE_WIDTH) {
+            for (size_t j0 = 0; j0 < l; j0 += TILE_WIDTH) {
+                for (size_t i = i0; i < std::min(i0 + TILE_WIDTH, n); ++i) {
+                    for (size_t j = j0; j < std::min(j0 + TILE_WIDTH, l); ++j) t[j * n + i] = lines[i * l + j];
+                }
+            }
+        }
+        lines = std::move(t);
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::factorize() {
+        PROF_SCOPE(FACTORIZE);
+        const size_t x_dim = m.x_dim(), y_dim = m.y_dim();
+        const bool batched = opts.mode == BATCHED;
+        const size_t W = batched ? workspaces.front().batched_x.lanes() : 1;
+
+        // the last batch is padded up to the full width
+        const size_t x_size = (y_dim + W - 1) / W * W * x_dim;
+        const size_t y_size = (x_dim + W - 1) / W * W * y_dim;
+        factors_x = {diagonal(x_size, 0), diagonal(x_size, 0), diagonal(x_size, 0)};
+        factors_y = {diagonal(y_size, 0), diagonal(y_size, 0), diagonal(y_size, 0)};
+
+        // the line (batch) starting at index first is stored
+        // at offset first * length in the factorization arrays
+        for_each_chunk(y_dim, W, [&](Workspace & ws, const size_t first, const size_t last) {
+            for (size_t y0 = first; y0 < last; y0 += W) {
+                tridiagonal_mx_extended & mx = batched ? ws.bmx_x : ws.mx_x;
+                for (size_t l = 0; l < W; ++l) {
+                    if (y0 + l < last) assemble_row(mx, y0 + l, {0, x_dim}, W, l);
+                    else assemble_identity(mx, {0, x_dim}, W, l);
+                }
+                const size_t offset = y0 * x_dim;
+                std::copy(mx[0].cbegin(), mx[0].cend(), factors_x.a.begin() + offset);
+                if (batched) ws.batched_x.factorize(mx, &factors_x.c_star[offset], &factors_x.inv_pivot[offset]);
+                else BasicTDMA<Real>::factorize(mx, &factors_x.c_star[offset], &factors_x.inv_pivot[offset]);
+            }
+        });
+
+        for_each_chunk(x_dim, W, [&](Workspace & ws, const size_t first, const size_t last) {
+            for (size_t x0 = first; x0 < last; x0 += W) {
+                tridiagonal_mx_extended & mx = batched ? ws.bmx_y : ws.mx_y;
+                for (size_t l = 0; l < W; ++l) {
+                    if (x0 + l < last) assemble_col(mx, x0 + l, {0, y_dim}, W, l);
+                    else assemble_identity(mx, {0, y_dim}, W, l);
+                }
+                const size_t offset = x0 * y_dim;
+                std::copy(mx[0].cbegin(), mx[0].cend(), factors_y.a.begin() + offset);
+                if (batched) ws.batched_y.factorize(mx, &factors_y.c_star[offset], &factors_y.inv_pivot[offset]);
+                else BasicTDMA<Real>::factorize(mx, &factors_y.c_star[offset], &factors_y.inv_pivot[offset]);
+            }
+        });
+        // the tiles of the wavefront read the columns row by row
+        if (can_pipeline()) {
+            transpose(factors_y.a, x_dim, y_dim);
+            transpose(factors_y.c_star, x_dim, y_dim);
+            transpose(factors_y.inv_pivot, x_dim, y_dim);
+        }
+
+        factorized_revision = m.revision();
+    }
+
+    template <typename Model, typename Real>
+    util::strided_span<Real> BasicProblem<Model, Real>::row_storage(Workspace & ws, const size_t y) {
+        if constexpr (IN_PLACE) return m.row(y);
+        else return {ws.f_x.data(), ws.f_x.size()};
+    }
+
+    template <typename Model, typename Real>
+    util::strided_span<Real> BasicProblem<Model, Real>::col_storage(Workspace & ws, const size_t x) {
+        if constexpr (IN_PLACE) return m.col(x);
+        else return {ws.f_y.data(), ws.f_y.size()};
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::solve_rows(Workspace & ws, const size_t y_first, const size_t y_last) {
+        const size_t x_dim = m.x_dim();
+
+        for (size_t y = y_first; y < y_last; ++y) {
+            const util::strided_span<Real> row = row_storage(ws, y);
+            // solve SLE for every segment of row y
+            for (const Segment * s = segments_x.begin(y); s != segments_x.end(y); ++s) {
+                const size_t length = s->last - s->first;
+                const util::strided_span<Real> f(&row[s->first], length, row.stride());
+                if (opts.prefactorize) {
+                    const size_t offset = y * x_dim + s->first;
+                    {
+                        PROF_SCOPE(ASSEMBLE_X);
+                        m.fill_x_rhs(y, s->first, s->last, row.data(), row.stride());
+                    }
+                    PROF_SCOPE(SOLVE_X);
+                    BasicTDMA<Real>::solve_factorized(
+                        &factors_x.a[offset], &factors_x.c_star[offset], &factors_x.inv_pivot[offset], f, f);
+                } else {
+                    {
+                        PROF_SCOPE(ASSEMBLE_X);
+                        assemble_row(ws.mx_x, y, *s);
+                    }
+                    // call solver and update current values in the row
+                    PROF_SCOPE(SOLVE_X);
+                    ws.solver_x.solve(
+                        &ws.mx_x[0][s->first], &ws.mx_x[1][s->first], &ws.mx_x[2][s->first],
+                        {&ws.mx_x[3][s->first], length}, f);
+                    if (VERBOSE) {
+                        pprint_tridiag_matrix(ws.mx_x, std::cout);
+                        pprint_solution_row(f, std::cout);
+                    }
+                }
+                if constexpr (IN_PLACE) PROF_COUNT(NODES_UPDATED, length);
+                else update_grid_row(ws, y, *s);
+            }
+        }
+        PROF_COUNT(LINES_SOLVED, y_last - y_first);
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::solve_cols(Workspace & ws, const size_t x_first, const size_t x_last) {
+        const size_t y_dim = m.y_dim();
+
+        for (size_t x = x_first; x < x_last; ++x) {
+            const util::strided_span<Real> col = col_storage(ws, x);
+            // solve SLE for every segment of column x
+            for (const Segment * s = segments_y.begin(x); s != segments_y.end(x); ++s) {
+                const size_t length = s->last - s->first;
+                const util::strided_span<Real> f(&col[s->first], length, col.stride());
+                if (opts.prefactorize) {
+                    const size_t offset = x * y_dim + s->first;
+                    {
+                        PROF_SCOPE(ASSEMBLE_Y);
+                        m.fill_y_rhs(x, s->first, s->last, col.data(), col.stride());
+                    }
+                    PROF_SCOPE(SOLVE_Y);
+                    BasicTDMA<Real>::solve_factorized(
+                        &factors_y.a[offset], &factors_y.c_star[offset], &factors_y.inv_pivot[offset], f, f);
+                } else {
+                    {
+                        PROF_SCOPE(ASSEMBLE_Y);
+                        assemble_col(ws.mx_y, x, *s);
+                    }
+                    // call solver and update current values in the column
+                    PROF_SCOPE(SOLVE_Y);
+                    ws.solver_y.solve(
+                        &ws.mx_y[0][s->first], &ws.mx_y[1][s->first], &ws.mx_y[2][s->first],
+                        {&ws.mx_y[3][s->first], length}, f);
+                    if (VERBOSE) {
+                        pprint_tridiag_matrix(ws.mx_y, std::cout);
+                        pprint_solution_row(f, std::cout);
+                    }
+                }
+                if constexpr (IN_PLACE) PROF_COUNT(NODES_UPDATED, length);
+                else update_grid_col(ws, x, *s);
+            }
+        }
+        PROF_COUNT(LINES_SOLVED, x_last - x_first);
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::solve_cols_transposed(Workspace & ws, const size_t x_first, const size_t x_last) {
+        const size_t y_dim = m.y_dim();
+        Real * tile = ws.tile.data();
+
+        // the RHS of TILE_WIDTH columns is transposed into the column-major
+        // tile, every column is solved in place there (contiguously)
+        // and the tile is transposed back into the field
+        for (size_t x0 = x_first; x0 < x_last; x0 += TILE_WIDTH) {
+            const size_t x1 = std::min(x0 + TILE_WIDTH, x_last);
+            {
+                PROF_SCOPE(ASSEMBLE_Y);
+                m.fill_y_rhs_block(x0, x1, tile, y_dim);
+            }
+            {
+                PROF_SCOPE(SOLVE_Y);
+                for (size_t x = x0; x < x1; ++x) {
+                    for (const Segment * s = segments_y.begin(x); s != segments_y.end(x); ++s) {
+                        const size_t offset = x * y_dim + s->first;
+                        Real * col = tile + (x - x0) * y_dim + s->first;
+                        BasicTDMA<Real>::solve_factorized(
+                            s->last - s->first, &factors_y.a[offset], &factors_y.c_star[offset], &factors_y.inv_pivot[offset],
+                            col, col);
+                    }
+                }
+            }
+            PROF_SCOPE(SCATTER_Y);
+            m.scatter_y_block(x0, x1, tile, y_dim);
+            PROF_COUNT(NODES_UPDATED, (x1 - x0) * y_dim);
+        }
+        PROF_COUNT(LINES_SOLVED, x_last - x_first);
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::solve_rows_batched(Workspace & ws, const size_t y_first, const size_t y_last) {
+        const size_t x_dim = m.x_dim();
+        const size_t W = ws.batched_x.lanes();
+
+        // rows y0 .. y0 + W - 1 are packed into the lanes
+        // of a single batch, i-th coefficient of the lane l
+        // goes to [i * W + l]. Lanes past the last row
+        // are padded with identity systems. The batch spans
+        // the hull of the segments of its rows, the equations
+        // of a row outside of its segments are pinned
+        for (size_t y0 = y_first; y0 < y_last; y0 += W) {
+            const size_t y1 = std::min(y0 + W, y_last);
+            const Segment h = segments_x.hull(y0, y1);
+            if (opts.prefactorize) {
+                {
+                    PROF_SCOPE(ASSEMBLE_X);
+                    for (size_t l = 0; l < W; ++l) {
+                        if (y0 + l < y_last) assemble_row_rhs(ws.bmx_x[3], y0 + l, h, W, l);
+                    }
+                }
+                const size_t offset = y0 * x_dim;
+                PROF_SCOPE(SOLVE_X);
+                ws.batched_x.solve_factorized(
+                    &factors_x.a[offset], &factors_x.c_star[offset], &factors_x.inv_pivot[offset],
+                    ws.bmx_x[3], ws.bf_x, h.first, h.last);
+            } else {
+                {
+                    PROF_SCOPE(ASSEMBLE_X);
+                    for (size_t l = 0; l < W; ++l) {
+                        if (y0 + l < y_last) assemble_row(ws.bmx_x, y0 + l, h, W, l);
+                        else assemble_identity(ws.bmx_x, h, W, l);
+                    }
+                }
+                PROF_SCOPE(SOLVE_X);
+                ws.batched_x.solve(ws.bmx_x, ws.bf_x, h.first, h.last);
+            }
+
+            PROF_SCOPE(SCATTER_X);
+            for (size_t y = y0; y < y1; ++y) {
+                m.scatter_x_line(y, h.first, h.last, &ws.bf_x[y - y0], W);
+            }
+            PROF_COUNT(NODES_UPDATED, (y1 - y0) * (h.last - h.first));
+        }
+        PROF_COUNT(LINES_SOLVED, y_last - y_first);
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::solve_cols_batched(Workspace & ws, const size_t x_first, const size_t x_last) {
+        const size_t y_dim = m.y_dim();
+        const size_t W = ws.batched_y.lanes();
+
+        // same as for the rows, columns x0 .. x0 + W - 1 share a batch
+        for (size_t x0 = x_first; x0 < x_last; x0 += W) {
+            const size_t x1 = std::min(x0 + W, x_last);
+            const Segment h = segments_y.hull(x0, x1);
+            if (opts.prefactorize) {
+                {
+                    PROF_SCOPE(ASSEMBLE_Y);
+                    for (size_t l = 0; l < W; ++l) {
+                        if (x0 + l < x_last) assemble_col_rhs(ws.bmx_y[3], x0 + l, h, W, l);
+                    }
+                }
+                const size_t offset = x0 * y_dim;
+                PROF_SCOPE(SOLVE_Y);
+                ws.batched_y.solve_factorized(
+                    &factors_y.a[offset], &factors_y.c_star[offset], &factors_y.inv_pivot[offset],
+                    ws.bmx_y[3], ws.bf_y, h.first, h.last);
+            } else {
+                {
+                    PROF_SCOPE(ASSEMBLE_Y);
+                    for (size_t l = 0; l < W; ++l) {
+                        if (x0 + l < x_last) assemble_col(ws.bmx_y, x0 + l, h, W, l);
+                        else assemble_identity(ws.bmx_y, h, W, l);
+                    }
+                }
+                PROF_SCOPE(SOLVE_Y);
+                ws.batched_y.solve(ws.bmx_y, ws.bf_y, h.first, h.last);
+            }
+
+            PROF_SCOPE(SCATTER_Y);
+            for (size_t x = x0; x < x1; ++x) {
+                m.scatter_y_line(x, h.first, h.last, &ws.bf_y[x - x0], W);
+            }
+            PROF_COUNT(NODES_UPDATED, (x1 - x0) * (h.last - h.first));
+        }
+        PROF_COUNT(LINES_SOLVED, x_last - x_first);
+    }
+
+    // a line is split over the threads (a group of partitions each) and over
+    // the lanes of a group; short segments keep fewer (or no) partitions
+    template <typename Model, typename Real>
+    bool BasicProblem<Model, Real>::should_split(const Segments & segments, const size_t n_lines) const {
+        if (opts.split != SPLIT_AUTO) return opts.split == SPLIT_ALWAYS;
+        size_t lines = 0, longest = 0;
+        for (size_t l = 0; l < n_lines; ++l) {
+            if (segments.begin(l) != segments.end(l)) ++lines;
+            for (const Segment * s = segments.begin(l); s != segments.end(l); ++s) {
+                longest = std::max(longest, s->last - s->first);
+            }
+        }
+        return longest >= MIN_SPLIT_LENGTH and lines < opts.n_threads * BasicBatchedTDMA<Real>::native_width();
+    }
+
+    template <typename Model, typename Real>
+    BasicPartitionedTDMA<Real> BasicProblem<Model, Real>::partition(const tridiagonal_mx_extended & mx, const Segment s) const {
+        const size_t length = s.last - s.first;
+        const size_t W = BasicBatchedTDMA<Real>::native_width();
+        const size_t groups = std::min(opts.n_threads, length / (MIN_PARTITION * W));
+        const Real * a = &mx[0][s.first], * b = &mx[1][s.first], * c = &mx[2][s.first];
+        if (groups > 0) return BasicPartitionedTDMA<Real>(length, a, b, c, groups, W);
+        return BasicPartitionedTDMA<Real>(length, a, b, c, 1, length >= 2 * W ? W : 1);
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::factorize_partitions() {
+        PROF_SCOPE(FACTORIZE);
+        Workspace & ws = workspaces.front();
+        partitions_x.clear();
+        partitions_y.clear();
+        if (split_x) {
+            for (size_t y = 0; y < m.y_dim(); ++y) {
+                for (const Segment * s = segments_x.begin(y); s != segments_x.end(y); ++s) {
+                    assemble_row(ws.mx_x, y, *s);
+                    partitions_x.push_back(partition(ws.mx_x, *s));
+                }
+            }
+        }
+        if (split_y) {
+            for (size_t x = 0; x < m.x_dim(); ++x) {
+                for (const Segment * s = segments_y.begin(x); s != segments_y.end(x); ++s) {
+                    assemble_col(ws.mx_y, x, *s);
+                    partitions_y.push_back(partition(ws.mx_y, *s));
+                }
+            }
+        }
+        partitioned_revision = m.revision();
+    }
+
+    template <typename Model, typename Real>
+    template <typename Task>
+    void BasicProblem<Model, Real>::for_each_group(const size_t n, const Task & task) {
+        if (not pool) {
+            for (size_t g = 0; g < n; ++g) task(g);
+            return;
+        }
+        const size_t n_threads = pool->size();
+        pool->run([&](const size_t t) {
+            for (size_t g = t; g < n; g += n_threads) task(g);
+        });
+    }
+
+    // the threads share the buffers of the first workspace, each of
+    // them assembles, solves and scatters the span of its group only;
+    // the reduced system in between is solved by the calling thread
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::solve_rows_split() {
+        Workspace & ws = workspaces.front();
+        for (size_t y = 0; y < m.y_dim(); ++y) {
+            for (const Segment * s = segments_x.begin(y); s != segments_x.end(y); ++s) {
+                BasicPartitionedTDMA<Real> & lines = partitions_x[s - segments_x.segments.data()];
+                const auto equations = [&](const size_t g) {
+                    const Segment span = lines.span(g);
+                    return Segment{s->first + span.first, s->first + span.last};
+                };
+                for_each_group(lines.groups(), [&](const size_t g) {
+                    {
+                        PROF_SCOPE(ASSEMBLE_X);
+                        assemble_row_rhs(ws.mx_x[3], y, equations(g));
+                    }
+                    PROF_SCOPE(SOLVE_X);
+                    lines.eliminate(g, &ws.mx_x[3][s->first]);
+                });
+                {
+                    PROF_SCOPE(SOLVE_X);
+                    lines.reduce(&ws.mx_x[3][s->first]);
+                }
+                for_each_group(lines.groups(), [&](const size_t g) {
+                    {
+                        PROF_SCOPE(SOLVE_X);
+                        lines.substitute(g, &ws.f_x[s->first]);
+                    }
+                    update_grid_row(ws, y, equations(g));
+                });
+            }
+        }
+        PROF_COUNT(LINES_SOLVED, m.y_dim());
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::solve_cols_split() {
+        Workspace & ws = workspaces.front();
+        for (size_t x = 0; x < m.x_dim(); ++x) {
+            for (const Segment * s = segments_y.begin(x); s != segments_y.end(x); ++s) {
+                BasicPartitionedTDMA<Real> & lines = partitions_y[s - segments_y.segments.data()];
+                const auto equations = [&](const size_t g) {
+                    const Segment span = lines.span(g);
+                    return Segment{s->first + span.first, s->first + span.last};
+                };
+                for_each_group(lines.groups(), [&](const size_t g) {
+                    {
+                        PROF_SCOPE(ASSEMBLE_Y);
+                        assemble_col_rhs(ws.mx_y[3], x, equations(g));
+                    }
+                    PROF_SCOPE(SOLVE_Y);
+                    lines.eliminate(g, &ws.mx_y[3][s->first]);
+                });
+                {
+                    PROF_SCOPE(SOLVE_Y);
+                    lines.reduce(&ws.mx_y[3][s->first]);
+                }
+                for_each_group(lines.groups(), [&](const size_t g) {
+                    {
+                        PROF_SCOPE(SOLVE_Y);
+                        lines.substitute(g, &ws.f_y[s->first]);
+                    }
+                    update_grid_col(ws, x, equations(g));
+                });
+            }
+        }
+        PROF_COUNT(LINES_SOLVED, m.x_dim());
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::update_grid_row(const Workspace & ws, const size_t y, const Segment s) {
+        PROF_SCOPE(SCATTER_X);
+        PROF_COUNT(NODES_UPDATED, s.last - s.first);
+        m.scatter_x_line(y, s.first, s.last, ws.f_x.data(), 1);
+    }
+
+    template <typename Model, typename Real>
+    void BasicProblem<Model, Real>::update_grid_col(const Workspace & ws, const size_t x, const Segment s) {
+        PROF_SCOPE(SCATTER_Y);
+        PROF_COUNT(NODES_UPDATED, s.last - s.first);
+        m.scatter_y_line(x, s.first, s.last, ws.f_y.data(), 1);
+    }
+
+    template class BasicProblem<model::IModel>;
+    template class BasicProblem<model::Model79>;
+    template class BasicProblem<model::Model79f, double>;
+    template class BasicProblem<model::Model79f, float>;
 }
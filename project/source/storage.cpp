@@ -0,0 +1,216 @@
+#include "storage.hpp"
+#include "binary.hpp"
+#include "profile.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace io {
+    namespace {
+        constexpr char MAGIC[8] = {'F', 'D', 'M', 'S', 'N', 'A', 'P', '1'};
+        constexpr uint32_t VERSION = 1;
+        constexpr uint64_t PAGE = 4096;
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t byte_order;
+            uint64_t width;
+            uint64_t height;
+            double dt;
+            double dx;
+            double dy;
+            double a;
+            uint64_t data_offset;
+            uint64_t frame_stride;
+        };
+        static_assert(sizeof(Header) == 80, "snapshot header must have no padding");
+
+        struct FrameHeader {
+            uint64_t step;
+            double time;
+        };
+        static_assert(sizeof(FrameHeader) == 16, "frame header must have no padding");
+
+    }
+
+    using binary::throw_errno;
+
+    SnapshotWriter::SnapshotWriter(
+        const std::string & path,
+        const size_t width, const size_t height,
+        const model::Parameters & parameters,
+        util::strided_span<const model::condition> mask
+    ):
+        path(path),
+        width(width),
+        height(height) {
+        if (width == 0 or height == 0)
+            throw std::runtime_error("empty mesh cannot be stored");
+        if (mask.size() != width * height)
+            throw std::runtime_error("condition mask does not match the mesh");
+
+        const size_t nodes = width * height;
+        data_offset = (sizeof(Header) + nodes + PAGE - 1) / PAGE * PAGE;
+        frame_stride = sizeof(FrameHeader) + nodes * sizeof(double);
+
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) throw_errno("failed to create snapshot store", path);
+
+        Header header{};
+        binary::stamp(header, MAGIC, VERSION);
+        header.width = width;
+        header.height = height;
+        header.dt = parameters.dt;
+        header.dx = parameters.dx;
+        header.dy = parameters.dy;
+        header.a = parameters.a;
+        header.data_offset = data_offset;
+        header.frame_stride = frame_stride;
+
+        // the header, the mask and the padding up to the first frame
+        std::vector<unsigned char> preamble(data_offset, 0);
+        std::memcpy(preamble.data(), &header, sizeof(Header));
+        std::copy(mask.begin(), mask.end(), preamble.begin() + sizeof(Header));
+        try {
+            binary::pwrite_fully(fd, preamble.data(), preamble.size(), 0, "failed to write snapshot store", path);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+    }
+
+    SnapshotWriter::~SnapshotWriter() {
+        if (fd >= 0) close(fd);
+    }
+
+    void SnapshotWriter::append(const size_t step, const double time, util::strided_span<const double> field) {
+        if (field.size() != width * height)
+            throw std::runtime_error("field does not match the mesh of the snapshot store");
+        PROF_SCOPE(SNAPSHOT);
+
+        // contiguous fields go to the file straight from the model
+        const double * values = field.data();
+        if (field.stride() != 1) {
+            gather.assign(field.begin(), field.end());
+            values = gather.data();
+        }
+
+        const FrameHeader frame{step, time};
+        iovec parts[2] = {
+            {const_cast<FrameHeader *>(&frame), sizeof(FrameHeader)},
+            {const_cast<double *>(values), field.size() * sizeof(double)}
+        };
+        const off_t offset = static_cast<off_t>(data_offset + n_frames * frame_stride);
+        const ssize_t n = pwritev(fd, parts, 2, offset);
+        if (n < 0 and errno != EINTR) throw_errno("failed to write snapshot store", path);
+        // short writes are rare, finish them the slow way
+        size_t done = n < 0 ? 0 : static_cast<size_t>(n);
+        if (done < sizeof(FrameHeader)) {
+            binary::pwrite_fully(
+                fd, reinterpret_cast<const char *>(&frame) + done, sizeof(FrameHeader) - done, offset + done,
+                "failed to write snapshot store", path);
+            done = sizeof(FrameHeader);
+        }
+        if (done < frame_stride) {
+            const size_t skip = done - sizeof(FrameHeader);
+            binary::pwrite_fully(
+                fd, reinterpret_cast<const char *>(values) + skip, frame_stride - done, offset + done,
+                "failed to write snapshot store", path);
+        }
+        ++n_frames;
+        PROF_COUNT(BYTES_WRITTEN, frame_stride);
+    }
+
+    SnapshotReader::SnapshotReader(const std::string & path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw_errno("failed to open snapshot store", path);
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw_errno("failed to stat snapshot store", path);
+        }
+        mapped_size = static_cast<size_t>(st.st_size);
+        if (mapped_size < sizeof(Header)) {
+            close(fd);
+            throw std::runtime_error("'" + path + "' is too small to be a snapshot store");
+        }
+
+        void * p = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+        // the mapping stays valid after the descriptor is closed
+        close(fd);
+        if (p == MAP_FAILED) throw_errno("failed to map snapshot store", path);
+        base = static_cast<const unsigned char *>(p);
+
+        Header header;
+        std::memcpy(&header, base, sizeof(Header));
+        const auto fail = [&](const std::string & why) {
+            munmap(const_cast<unsigned char *>(base), mapped_size);
+            throw std::runtime_error("'" + path + "': " + why);
+        };
+        const std::string why = binary::mismatch(header, MAGIC, VERSION, "snapshot store");
+        if (not why.empty()) fail(why);
+        if (header.width == 0 or header.height == 0
+            or header.frame_stride != sizeof(FrameHeader) + header.width * header.height * sizeof(double)
+            or header.data_offset < sizeof(Header) + header.width * header.height
+            or header.data_offset % sizeof(double) != 0
+            or header.data_offset > mapped_size)
+            fail("corrupted snapshot store header");
+
+        width = header.width;
+        height = header.height;
+        params = {header.dt, header.dx, header.dy, header.a};
+        data_offset = header.data_offset;
+        frame_stride = header.frame_stride;
+        n_frames = (mapped_size - data_offset) / frame_stride;
+
+        index.reserve(n_frames);
+        for (size_t i = 0; i < n_frames; ++i) {
+            // a step written twice resolves to the latest frame
+            index[step(i)] = i;
+        }
+    }
+
+    SnapshotReader::~SnapshotReader() {
+        munmap(const_cast<unsigned char *>(base), mapped_size);
+    }
+
+    const unsigned char * SnapshotReader::frame_at(const size_t i) const {
+        if (i >= n_frames) throw std::out_of_range("frame " + std::to_string(i) + " is out of range");
+        return base + data_offset + i * frame_stride;
+    }
+
+    util::strided_span<const model::condition> SnapshotReader::mask() const {
+        return {reinterpret_cast<const model::condition *>(base + sizeof(Header)), width * height};
+    }
+
+    util::strided_span<const double> SnapshotReader::frame(const size_t i) const {
+        // frames are 8-byte aligned since both data_offset and frame_stride are
+        return {reinterpret_cast<const double *>(frame_at(i) + sizeof(FrameHeader)), width * height};
+    }
+
+    size_t SnapshotReader::step(const size_t i) const {
+        FrameHeader header;
+        std::memcpy(&header, frame_at(i), sizeof(FrameHeader));
+        return header.step;
+    }
+
+    double SnapshotReader::time(const size_t i) const {
+        FrameHeader header;
+        std::memcpy(&header, frame_at(i), sizeof(FrameHeader));
+        return header.time;
+    }
+
+    size_t SnapshotReader::find_step(const size_t step) const {
+        const auto it = index.find(step);
+        if (it == index.end()) throw std::out_of_range("no frame is stored for step " + std::to_string(step));
+        return it->second;
+    }
+}